@@ -1,12 +1,21 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
 from esphome import pins, automation
+import esphome.final_validate as fv
+from esphome.components import uart
+from esphome.components.esp32 import add_idf_sdkconfig_option
+from esphome.core import CORE, ID
 from esphome.const import (
+    CONF_HOST,
     CONF_ID,
-    CONF_TRIGGER_ID
+    CONF_PORT,
+    CONF_SIZE,
+    CONF_TRIGGER_ID,
+    CONF_UART_ID,
 )
 
 CODEOWNERS = ["@Palakis"]
+MULTI_CONF = True
 
 CONF_PIN = "pin"
 CONF_ADDRESS = "address"
@@ -16,16 +25,71 @@ CONF_MONITOR_MODE = "monitor_mode"
 CONF_DECODE_MESSAGES = "decode_messages"
 CONF_OSD_NAME = "osd_name"
 CONF_ON_MESSAGE = "on_message"
+CONF_ON_DECODED_MESSAGE = "on_decoded_message"
 
 CONF_SOURCE = "source"
 CONF_DESTINATION = "destination"
 CONF_OPCODE = "opcode"
 CONF_DATA = "data"
 CONF_PARENT = "parent"
+CONF_PRIORITY = "priority"
+CONF_MAX_DELAY = "max_delay"
+CONF_RX_QUEUE_SIZE = "rx_queue_size"
+CONF_RX_OVERFLOW_POLICY = "rx_overflow_policy"
+CONF_RECEIVER = "receiver"
+CONF_EDGE_TRACE_SIZE = "edge_trace_size"
+CONF_CAPTURE = "capture"
+CONF_DEVICE_TYPE = "device_type"
+CONF_REPLY_OPCODE = "reply_opcode"
+CONF_TIMEOUT = "timeout"
+CONF_ON_RESPONSE = "on_response"
+CONF_ON_FEATURE_ABORT = "on_feature_abort"
+CONF_ON_TIMEOUT = "on_timeout"
+CONF_MESSAGES = "messages"
+CONF_KEY = "key"
+CONF_KEY_EVENTS = "key_events"
+CONF_HOLD_INTERVAL = "hold_interval"
+CONF_RELEASE_TIMEOUT = "release_timeout"
+CONF_ON_KEY_PRESS = "on_key_press"
+CONF_ON_KEY_HOLD = "on_key_hold"
+CONF_ON_KEY_RELEASE = "on_key_release"
+CONF_ON_FAILURE = "on_failure"
+CONF_BRIDGE = "bridge"
+CONF_TARGET = "target"
+CONF_DEFAULT_ACTION = "default_action"
+CONF_RULES = "rules"
+CONF_ACTION = "action"
+CONF_PHYSICAL_ADDRESS_FROM = "physical_address_from"
+CONF_PHYSICAL_ADDRESS_TO = "physical_address_to"
+CONF_DEDICATED_TASK = "dedicated_task"
+CONF_LOOP_BUDGET = "loop_budget"
+MAX_SEQUENCE_LENGTH = 4
+
+# reply opcode of the common requests, so a query only needs the request
+REPLY_OPCODES = {
+    0x08: 0x07,  # "Give Tuner Device Status" -> "Tuner Device Status"
+    0x1A: 0x1B,  # "Give Deck Status" -> "Deck Status"
+    0x46: 0x47,  # "Give OSD Name" -> "Set OSD Name"
+    0x71: 0x7A,  # "Give Audio Status" -> "Report Audio Status"
+    0x7D: 0x7E,  # "Give System Audio Mode Status" -> "System Audio Mode Status"
+    0x83: 0x84,  # "Give Physical Address" -> "Report Physical Address"
+    0x85: 0x82,  # "Request Active Source" -> "Active Source"
+    0x8C: 0x87,  # "Give Device Vendor ID" -> "Device Vendor ID"
+    0x8F: 0x90,  # "Give Device Power Status" -> "Report Power Status"
+    0x91: 0x32,  # "Get Menu Language" -> "Set Menu Language"
+    0x9F: 0x9E,  # "Get CEC Version" -> "CEC Version"
+}
+CONF_SINK = "sink"
+# opcodes with physical address operands, that a bridge rule can rewrite (see BridgeRules)
+PHYSICAL_ADDRESS_OPCODES = [0x70, 0x80, 0x81, 0x82, 0x84, 0x86, 0x9D]
+BRIDGE_ANY_OPCODE = 0x100
 
 def validate_data_array(value):
     if isinstance(value, list):
-        return cv.Schema([cv.hex_uint8_t])(value)
+        value = cv.Schema([cv.hex_uint8_t])(value)
+        if len(value) > 15:
+            raise cv.Invalid("A CEC message holds at most 15 bytes of data (opcode and operands)")
+        return value
     raise cv.Invalid("data must be a list of bytes")
 
 def validate_osd_name(value):
@@ -44,27 +108,294 @@ def validate_osd_name(value):
 
     return value
 
+def validate_address(value):
+    if isinstance(value, str) and value.lower() == "auto":
+        return "auto"
+    return cv.int_range(min=0, max=15)(value)
+
+def validate_address_allocation(config):
+    if config[CONF_ADDRESS] == "auto":
+        if config[CONF_MONITOR_MODE]:
+            raise cv.Invalid("A monitor can't allocate a logical address, set a fixed one", path=[CONF_ADDRESS])
+    elif CONF_DEVICE_TYPE in config:
+        raise cv.Invalid("'device_type' only applies to 'address: auto'", path=[CONF_DEVICE_TYPE])
+    return config
+
+def validate_receiver(config):
+    if config[CONF_RECEIVER] == "rmt":
+        if not CORE.is_esp32:
+            raise cv.Invalid("The RMT receiver is only available on the ESP32", path=[CONF_RECEIVER])
+        if not config[CONF_MONITOR_MODE]:
+            raise cv.Invalid(
+                "The RMT receiver decodes frames after the fact, so it can't acknowledge them: "
+                "it requires 'monitor_mode: true'",
+                path=[CONF_RECEIVER],
+            )
+    return config
+
+def validate_dedicated_task(config):
+    if config[CONF_DEDICATED_TASK] and not (CORE.is_esp32 or CORE.is_host):
+        raise cv.Invalid("The dedicated CEC task is only available on the ESP32", path=[CONF_DEDICATED_TASK])
+    return config
+
+def final_validate_dedicated_task(config):
+    # one task serves all buses of the node: they must agree on it
+    buses = fv.full_config.get()["hdmi_cec"]
+    if any(bus[CONF_DEDICATED_TASK] != config[CONF_DEDICATED_TASK] for bus in buses):
+        raise cv.Invalid(
+            "All buses share the dedicated CEC task, set the same 'dedicated_task' on each of them",
+            path=[CONF_DEDICATED_TASK],
+        )
+    return config
+
+def final_validate_rx_queue_size(config):
+    # the receive queue depth is a compile-time constant (HDMI_CEC_RX_QUEUE_SIZE), the same for all buses
+    buses = fv.full_config.get()["hdmi_cec"]
+    if any(bus[CONF_RX_QUEUE_SIZE] != config[CONF_RX_QUEUE_SIZE] for bus in buses):
+        raise cv.Invalid(
+            "The receive queue size applies to all buses, set the same 'rx_queue_size' on each of them",
+            path=[CONF_RX_QUEUE_SIZE],
+        )
+    return config
+
+def final_validate_decode_messages(config):
+    # the decoder is compiled in or left out for the whole firmware (USE_CEC_DECODER), not per bus
+    buses = fv.full_config.get()["hdmi_cec"]
+    if any(bus[CONF_DECODE_MESSAGES] != config[CONF_DECODE_MESSAGES] for bus in buses):
+        raise cv.Invalid(
+            "The message decoder applies to all buses, set the same 'decode_messages' on each of them",
+            path=[CONF_DECODE_MESSAGES],
+        )
+    return config
+
+FINAL_VALIDATE_SCHEMA = cv.All(
+    final_validate_dedicated_task, final_validate_rx_queue_size, final_validate_decode_messages
+)
+
+def validate_bridge_rule(config):
+    is_rewrite = config[CONF_ACTION] == "rewrite"
+    has_addresses = CONF_PHYSICAL_ADDRESS_FROM in config or CONF_PHYSICAL_ADDRESS_TO in config
+    if is_rewrite and not (CONF_PHYSICAL_ADDRESS_FROM in config and CONF_PHYSICAL_ADDRESS_TO in config):
+        raise cv.Invalid("A 'rewrite' rule requires 'physical_address_from' and 'physical_address_to'")
+    if not is_rewrite and has_addresses:
+        raise cv.Invalid("Physical addresses only apply to 'rewrite' rules")
+    if is_rewrite and CONF_OPCODE in config and config[CONF_OPCODE] not in PHYSICAL_ADDRESS_OPCODES:
+        raise cv.Invalid(
+            f"Opcode 0x{config[CONF_OPCODE]:02X} has no physical address to rewrite", path=[CONF_OPCODE]
+        )
+    return config
+
+def validate_bridge(config):
+    bridge = config.get(CONF_BRIDGE)
+    if bridge is not None and bridge[CONF_TARGET] == config[CONF_ID]:
+        raise cv.Invalid("A bus can't be bridged to itself", path=[CONF_BRIDGE, CONF_TARGET])
+    return config
+
+def validate_query(config):
+    if CONF_REPLY_OPCODE in config:
+        return config
+    data = config[CONF_DATA]
+    if not isinstance(data, list):
+        raise cv.Invalid("'reply_opcode' is required when 'data' is a lambda", path=[CONF_REPLY_OPCODE])
+    if not data or data[0] not in REPLY_OPCODES:
+        raise cv.Invalid("Unknown request opcode, please set 'reply_opcode'", path=[CONF_REPLY_OPCODE])
+    config[CONF_REPLY_OPCODE] = REPLY_OPCODES[data[0]]
+    return config
+
+def dispatch_opcode(conf):
+    """The only opcode an on_message trigger can match, or None if it may match any opcode"""
+    if CONF_OPCODE in conf:
+        return conf[CONF_OPCODE]
+    data = conf.get(CONF_DATA)
+    if data:
+        return data[0]
+    return None
+
+def build_dispatch_tables(trigger_confs):
+    """
+    Group the on_message triggers by opcode, see HDMICEC::set_message_dispatch().
+    Returns the 257 group start offsets (the last group holds the any-opcode triggers)
+    and the trigger positions in group order.
+    """
+    groups = [[] for _ in range(257)]
+    for position, conf in enumerate(trigger_confs):
+        opcode = dispatch_opcode(conf)
+        groups[256 if opcode is None else opcode].append(position)
+    index = []
+    order = []
+    for group in groups:
+        index.append(len(order))
+        order.extend(group)
+    return index, order
+
 hdmi_cec_ns = cg.esphome_ns.namespace("hdmi_cec")
 HDMICEC = hdmi_cec_ns.class_(
     "HDMICEC", cg.Component
 )
+Payload = hdmi_cec_ns.class_("Payload")
 MessageTrigger = hdmi_cec_ns.class_(
-    "MessageTrigger", automation.Trigger.template(cg.uint8, cg.uint8, cg.std_vector.template(cg.uint8))
+    "MessageTrigger", automation.Trigger.template(cg.uint8, cg.uint8, Payload)
+)
+DecodedMessage = hdmi_cec_ns.struct("DecodedMessage")
+DecodedMessageTrigger = hdmi_cec_ns.class_(
+    "DecodedMessageTrigger", automation.Trigger.template(DecodedMessage)
+)
+KeyPressTrigger = hdmi_cec_ns.class_(
+    "KeyPressTrigger", automation.Trigger.template(cg.uint8, cg.uint8)
+)
+KeyHoldTrigger = hdmi_cec_ns.class_(
+    "KeyHoldTrigger", automation.Trigger.template(cg.uint8, cg.uint8, cg.uint32, cg.uint32)
+)
+KeyReleaseTrigger = hdmi_cec_ns.class_(
+    "KeyReleaseTrigger", automation.Trigger.template(cg.uint8, cg.uint8, cg.uint32)
 )
 SendAction = hdmi_cec_ns.class_(
     "SendAction", automation.Action
 )
+SendSequenceAction = hdmi_cec_ns.class_(
+    "SendSequenceAction", automation.Action
+)
+SendSequenceFailureTrigger = hdmi_cec_ns.class_(
+    "SendSequenceFailureTrigger", automation.Trigger.template(cg.uint8)
+)
+QueryAction = hdmi_cec_ns.class_(
+    "QueryAction", automation.Action
+)
+QueryResponseTrigger = hdmi_cec_ns.class_(
+    "QueryResponseTrigger", automation.Trigger.template(Payload)
+)
+QueryFeatureAbortTrigger = hdmi_cec_ns.class_(
+    "QueryFeatureAbortTrigger", automation.Trigger.template(cg.uint8)
+)
+QueryTimeoutTrigger = hdmi_cec_ns.class_(
+    "QueryTimeoutTrigger", automation.Trigger.template()
+)
+DumpEdgeTraceAction = hdmi_cec_ns.class_(
+    "DumpEdgeTraceAction", automation.Action
+)
+CaptureSink = hdmi_cec_ns.class_("CaptureSink")
+LogCaptureSink = hdmi_cec_ns.class_("LogCaptureSink", CaptureSink)
+UARTCaptureSink = hdmi_cec_ns.class_("UARTCaptureSink", CaptureSink, uart.UARTDevice)
+TCPCaptureSink = hdmi_cec_ns.class_("TCPCaptureSink", CaptureSink)
+RxOverflowPolicy = hdmi_cec_ns.enum("RxOverflowPolicy", is_class=True)
+RX_OVERFLOW_POLICIES = {
+    "nak": RxOverflowPolicy.Nak,
+    "drop_newest": RxOverflowPolicy.DropNewest,
+    "drop_oldest_non_addressed": RxOverflowPolicy.DropOldestNonAddressed,
+}
+DeviceType = hdmi_cec_ns.enum("DeviceType", is_class=True)
+DEVICE_TYPES = {
+    "tv": DeviceType.TV,
+    "recording": DeviceType.Recording,
+    "tuner": DeviceType.Tuner,
+    "playback": DeviceType.Playback,
+    "audio_system": DeviceType.AudioSystem,
+}
+BridgeAction = hdmi_cec_ns.enum("BridgeAction", is_class=True)
+BRIDGE_ACTIONS = {
+    "allow": BridgeAction.Allow,
+    "deny": BridgeAction.Deny,
+    "rewrite": BridgeAction.Rewrite,
+}
+TxPriority = hdmi_cec_ns.enum("TxPriority", is_class=True)
+TX_PRIORITIES = {
+    "normal": TxPriority.Normal,
+    "high": TxPriority.High,
+}
+
+def key_trigger_schema(trigger_class):
+    return {
+        cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(trigger_class),
+        cv.Optional(CONF_SOURCE): cv.int_range(min=0, max=15),
+        cv.Optional(CONF_KEY): cv.uint8_t,
+    }
+
+CAPTURE_SCHEMA = cv.typed_schema(
+    {
+        "logger": cv.Schema(
+            {
+                cv.GenerateID(): cv.declare_id(LogCaptureSink),
+                cv.Optional(CONF_SIZE, 32): cv.int_range(min=4, max=1024),
+            }
+        ),
+        "uart": cv.Schema(
+            {
+                cv.GenerateID(): cv.declare_id(UARTCaptureSink),
+                cv.Optional(CONF_SIZE, 32): cv.int_range(min=4, max=1024),
+                cv.Required(CONF_UART_ID): cv.use_id(uart.UARTComponent),
+            }
+        ),
+        "tcp": cv.All(
+            cv.Schema(
+                {
+                    cv.GenerateID(): cv.declare_id(TCPCaptureSink),
+                    cv.Optional(CONF_SIZE, 32): cv.int_range(min=4, max=1024),
+                    cv.Required(CONF_HOST): cv.ipv4address,
+                    cv.Required(CONF_PORT): cv.port,
+                }
+            ),
+            cv.requires_component("socket"),
+        ),
+    },
+    key=CONF_SINK,
+    lower=True,
+    default_type="logger",
+)
 
 CONFIG_SCHEMA = cv.COMPONENT_SCHEMA.extend(
     {
         cv.GenerateID(): cv.declare_id(HDMICEC),
         cv.Required(CONF_PIN): pins.internal_gpio_output_pin_schema,
-        cv.Required(CONF_ADDRESS): cv.int_range(min=0, max=15),
+        cv.Required(CONF_ADDRESS): validate_address,
+        cv.Optional(CONF_DEVICE_TYPE): cv.enum(DEVICE_TYPES, lower=True),
         cv.Required(CONF_PHYSICAL_ADDRESS): cv.uint16_t,
         cv.Optional(CONF_PROMISCUOUS_MODE, False): cv.boolean,
         cv.Optional(CONF_MONITOR_MODE, False): cv.boolean,
         cv.Optional(CONF_DECODE_MESSAGES, True): cv.boolean,
         cv.Optional(CONF_OSD_NAME, "esphome"): validate_osd_name,
+        cv.Optional(CONF_RX_QUEUE_SIZE, 4): cv.int_range(min=1, max=64),
+        cv.Optional(CONF_RX_OVERFLOW_POLICY, "nak"): cv.enum(RX_OVERFLOW_POLICIES, lower=True),
+        cv.Optional(CONF_LOOP_BUDGET, "5ms"): cv.positive_time_period_microseconds,
+        cv.Optional(CONF_RECEIVER, "gpio"): cv.one_of("gpio", "rmt", lower=True),
+        cv.Optional(CONF_EDGE_TRACE_SIZE): cv.int_range(min=16, max=16384),
+        cv.Optional(CONF_CAPTURE): CAPTURE_SCHEMA,
+        cv.Optional(CONF_DEDICATED_TASK, False): cv.boolean,
+        cv.Optional(CONF_BRIDGE): cv.Schema(
+            {
+                cv.Required(CONF_TARGET): cv.use_id(HDMICEC),
+                cv.Optional(CONF_DEFAULT_ACTION, "allow"): cv.enum(
+                    {k: v for k, v in BRIDGE_ACTIONS.items() if k != "rewrite"}, lower=True
+                ),
+                cv.Optional(CONF_RULES, []): cv.ensure_list(
+                    cv.All(
+                        cv.Schema(
+                            {
+                                cv.Optional(CONF_OPCODE): cv.uint8_t,
+                                cv.Required(CONF_ACTION): cv.enum(BRIDGE_ACTIONS, lower=True),
+                                cv.Optional(CONF_PHYSICAL_ADDRESS_FROM): cv.uint16_t,
+                                cv.Optional(CONF_PHYSICAL_ADDRESS_TO): cv.uint16_t,
+                            }
+                        ),
+                        validate_bridge_rule,
+                    )
+                ),
+            }
+        ),
+        cv.Optional(CONF_KEY_EVENTS, {}): cv.Schema(
+            {
+                cv.Optional(CONF_HOLD_INTERVAL, "500ms"): cv.positive_time_period_milliseconds,
+                cv.Optional(CONF_RELEASE_TIMEOUT, "550ms"): cv.positive_time_period_milliseconds,
+            }
+        ),
+        cv.Optional(CONF_ON_KEY_PRESS): automation.validate_automation(
+            key_trigger_schema(KeyPressTrigger)
+        ),
+        cv.Optional(CONF_ON_KEY_HOLD): automation.validate_automation(
+            key_trigger_schema(KeyHoldTrigger)
+        ),
+        cv.Optional(CONF_ON_KEY_RELEASE): automation.validate_automation(
+            key_trigger_schema(KeyReleaseTrigger)
+        ),
         cv.Optional(CONF_ON_MESSAGE): automation.validate_automation(
             {
                 cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(MessageTrigger),
@@ -73,11 +404,22 @@ CONFIG_SCHEMA = cv.COMPONENT_SCHEMA.extend(
                 cv.Optional(CONF_OPCODE): cv.uint8_t,
                 cv.Optional(CONF_DATA): validate_data_array
             }
+        ),
+        cv.Optional(CONF_ON_DECODED_MESSAGE): automation.validate_automation(
+            {
+                cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(DecodedMessageTrigger),
+                cv.Optional(CONF_SOURCE): cv.int_range(min=0, max=15),
+                cv.Optional(CONF_DESTINATION): cv.int_range(min=0, max=15),
+                cv.Optional(CONF_OPCODE): cv.uint8_t,
+            }
         )
     }
-)
+).add_extra(validate_receiver).add_extra(validate_address_allocation).add_extra(validate_bridge).add_extra(validate_dedicated_task)
 
 async def to_code(config):
+    if CORE.is_esp32:
+        # the timer callbacks release the ACK bit: they must run in the timer interrupt, see cec_timer.h
+        add_idf_sdkconfig_option("CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD", True)
     if config[CONF_DECODE_MESSAGES] == True:
         cg.add_define('USE_CEC_DECODER')
 
@@ -87,10 +429,52 @@ async def to_code(config):
     cec_pin_ = await cg.gpio_pin_expression(config[CONF_PIN])
     cg.add(var.set_pin(cec_pin_))
 
-    cg.add(var.set_address(config[CONF_ADDRESS]))
+    if config[CONF_ADDRESS] == "auto":
+        cg.add(var.set_address(0xF))
+        cg.add(var.set_device_type(config.get(CONF_DEVICE_TYPE, DEVICE_TYPES["playback"])))
+    else:
+        cg.add(var.set_address(config[CONF_ADDRESS]))
     cg.add(var.set_physical_address(config[CONF_PHYSICAL_ADDRESS]))
     cg.add(var.set_promiscuous_mode(config[CONF_PROMISCUOUS_MODE]))
     cg.add(var.set_monitor_mode(config[CONF_MONITOR_MODE]))
+    cg.add_define("HDMI_CEC_RX_QUEUE_SIZE", config[CONF_RX_QUEUE_SIZE])
+    cg.add(var.set_rx_overflow_policy(config[CONF_RX_OVERFLOW_POLICY]))
+    cg.add(var.set_loop_budget(config[CONF_LOOP_BUDGET].total_microseconds))
+    # the defines compile the features in, for the buses that enable them at runtime
+    if config[CONF_RECEIVER] == "rmt":
+        cg.add_define("USE_HDMI_CEC_RMT")
+        cg.add(var.set_rmt_receiver(True))
+    edge_trace_size = config.get(CONF_EDGE_TRACE_SIZE)
+    if edge_trace_size is not None:
+        cg.add_define("USE_HDMI_CEC_EDGE_TRACE")
+        cg.add(var.set_edge_trace_size(edge_trace_size))
+    capture = config.get(CONF_CAPTURE)
+    if capture is not None:
+        cg.add_define("USE_HDMI_CEC_CAPTURE")
+        if capture[CONF_SINK] == "uart":
+            parent = await cg.get_variable(capture[CONF_UART_ID])
+            sink = cg.new_Pvariable(capture[CONF_ID], parent)
+        elif capture[CONF_SINK] == "tcp":
+            cg.add_define("USE_HDMI_CEC_CAPTURE_TCP")
+            sink = cg.new_Pvariable(capture[CONF_ID], str(capture[CONF_HOST]), capture[CONF_PORT])
+        else:
+            sink = cg.new_Pvariable(capture[CONF_ID])
+        cg.add(var.set_capture(sink, capture[CONF_SIZE]))
+
+    if config[CONF_DEDICATED_TASK]:
+        cg.add_define("USE_HDMI_CEC_TASK")
+
+    bridge = config.get(CONF_BRIDGE)
+    if bridge is not None:
+        target = await cg.get_variable(bridge[CONF_TARGET])
+        cg.add(var.set_bridge(target, bridge[CONF_DEFAULT_ACTION]))
+        for rule in bridge[CONF_RULES]:
+            cg.add(var.add_bridge_rule(
+                rule.get(CONF_OPCODE, BRIDGE_ANY_OPCODE),
+                rule[CONF_ACTION],
+                rule.get(CONF_PHYSICAL_ADDRESS_FROM, 0),
+                rule.get(CONF_PHYSICAL_ADDRESS_TO, 0),
+            ))
 
     osd_name_bytes = bytes(config[CONF_OSD_NAME], 'ascii', 'ignore') # convert string to ascii bytes
     osd_name_bytes = [x for x in osd_name_bytes] # convert byte array to int array
@@ -121,11 +505,58 @@ async def to_code(config):
             [
                 (cg.uint8, "source"),
                 (cg.uint8, "destination"),
-                (cg.std_vector.template(cg.uint8), "data")
+                (Payload, "data")
             ],
             conf
         )
 
+    for conf in config.get(CONF_ON_DECODED_MESSAGE, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+        source = conf.get(CONF_SOURCE)
+        if source is not None:
+            cg.add(trigger.set_source(source))
+        destination = conf.get(CONF_DESTINATION)
+        if destination is not None:
+            cg.add(trigger.set_destination(destination))
+        opcode = conf.get(CONF_OPCODE)
+        if opcode is not None:
+            cg.add(trigger.set_opcode(opcode))
+        await automation.build_automation(trigger, [(DecodedMessage, "message")], conf)
+
+    key_triggers = [
+        (CONF_ON_KEY_PRESS, []),
+        (CONF_ON_KEY_HOLD, [(cg.uint32, "repeat_count"), (cg.uint32, "held_ms")]),
+        (CONF_ON_KEY_RELEASE, [(cg.uint32, "held_ms")]),
+    ]
+    if any(conf in config for conf, _ in key_triggers):
+        # the key event stage only runs when someone listens to it
+        key_events = config[CONF_KEY_EVENTS]
+        cg.add(var.set_key_events(
+            key_events[CONF_HOLD_INTERVAL].total_milliseconds,
+            key_events[CONF_RELEASE_TIMEOUT].total_milliseconds,
+        ))
+    for conf_key, extra_args in key_triggers:
+        for conf in config.get(conf_key, []):
+            trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+            source = conf.get(CONF_SOURCE)
+            if source is not None:
+                cg.add(trigger.set_source(source))
+            key = conf.get(CONF_KEY)
+            if key is not None:
+                cg.add(trigger.set_key(key))
+            await automation.build_automation(
+                trigger, [(cg.uint8, "source"), (cg.uint8, "key")] + extra_args, conf
+            )
+
+    trigger_confs = config.get(CONF_ON_MESSAGE, [])
+    if trigger_confs:
+        index, order = build_dispatch_tables(trigger_confs)
+        index_id = ID(f"{config[CONF_ID].id}_dispatch_index", is_declaration=True, type=cg.uint16)
+        order_id = ID(f"{config[CONF_ID].id}_dispatch_order", is_declaration=True, type=cg.uint16)
+        index_array = cg.progmem_array(index_id, index)
+        order_array = cg.progmem_array(order_id, order)
+        cg.add(var.set_message_dispatch(index_array, order_array, len(order)))
+
 @automation.register_action(
     "hdmi_cec.send",
     SendAction,
@@ -133,7 +564,9 @@ async def to_code(config):
         cv.GenerateID(CONF_PARENT): cv.use_id(HDMICEC),
         cv.Optional(CONF_SOURCE): cv.templatable(cv.int_range(min=0, max=15)),
         cv.Required(CONF_DESTINATION): cv.templatable(cv.int_range(min=0, max=15)),
-        cv.Required(CONF_DATA): cv.templatable(validate_data_array)
+        cv.Required(CONF_DATA): cv.templatable(validate_data_array),
+        cv.Optional(CONF_PRIORITY, "normal"): cv.enum(TX_PRIORITIES, lower=True),
+        cv.Optional(CONF_MAX_DELAY): cv.positive_time_period_milliseconds,
     }
 )
 async def send_action_to_code(config, action_id, template_args, args):
@@ -148,8 +581,130 @@ async def send_action_to_code(config, action_id, template_args, args):
     destination_template_ = await cg.templatable(config.get(CONF_DESTINATION), args, cg.uint8)
     cg.add(var.set_destination(destination_template_))
 
+    data_ = config[CONF_DATA]
+    if isinstance(data_, list) and data_:
+        # constant data: stored in flash, and sent from there
+        data_id = ID(f"{action_id.id}_data", is_declaration=True, type=cg.uint8)
+        data_array = cg.progmem_array(data_id, data_)
+        cg.add(var.set_static_data(data_array, len(data_)))
+    else:
+        data_vec_ = cg.std_vector.template(cg.uint8)
+        data_template_ = await cg.templatable(data_, args, data_vec_, data_vec_)
+        cg.add(var.set_data(data_template_))
+
+    cg.add(var.set_priority(config[CONF_PRIORITY]))
+    max_delay_ = config.get(CONF_MAX_DELAY)
+    if max_delay_ is not None:
+        cg.add(var.set_max_delay(max_delay_.total_milliseconds))
+
+    return var
+
+@automation.register_action(
+    "hdmi_cec.send_sequence",
+    SendSequenceAction,
+    {
+        cv.GenerateID(CONF_PARENT): cv.use_id(HDMICEC),
+        cv.Optional(CONF_SOURCE): cv.templatable(cv.int_range(min=0, max=15)),
+        cv.Required(CONF_MESSAGES): cv.All(
+            cv.ensure_list(
+                cv.Schema(
+                    {
+                        cv.Required(CONF_DESTINATION): cv.int_range(min=0, max=15),
+                        cv.Required(CONF_DATA): validate_data_array,
+                    }
+                )
+            ),
+            cv.Length(min=1, max=MAX_SEQUENCE_LENGTH),
+        ),
+        cv.Optional(CONF_PRIORITY, "normal"): cv.enum(TX_PRIORITIES, lower=True),
+        cv.Optional(CONF_ON_FAILURE): automation.validate_automation(
+            {cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(SendSequenceFailureTrigger)}
+        ),
+    }
+)
+async def send_sequence_action_to_code(config, action_id, template_args, args):
+    parent = await cg.get_variable(config[CONF_PARENT])
+    var = cg.new_Pvariable(action_id, template_args, parent)
+
+    source_ = config.get(CONF_SOURCE)
+    if source_ is not None:
+        source_template_ = await cg.templatable(source_, args, cg.uint8)
+        cg.add(var.set_source(source_template_))
+
+    for message in config[CONF_MESSAGES]:
+        cg.add(var.add_message(message[CONF_DESTINATION], message[CONF_DATA]))
+    cg.add(var.set_priority(config[CONF_PRIORITY]))
+
+    for conf in config.get(CONF_ON_FAILURE, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID])
+        cg.add(var.add_failure_trigger(trigger))
+        await automation.build_automation(trigger, [(cg.uint8, "index")], conf)
+
+    return var
+
+@automation.register_action(
+    "hdmi_cec.query",
+    QueryAction,
+    cv.All(
+        cv.Schema(
+            {
+                cv.GenerateID(CONF_PARENT): cv.use_id(HDMICEC),
+                cv.Required(CONF_DESTINATION): cv.templatable(cv.int_range(min=0, max=15)),
+                cv.Required(CONF_DATA): cv.templatable(validate_data_array),
+                cv.Optional(CONF_REPLY_OPCODE): cv.uint8_t,
+                cv.Optional(CONF_TIMEOUT, "1s"): cv.positive_time_period_milliseconds,
+                cv.Optional(CONF_ON_RESPONSE): automation.validate_automation(
+                    {cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(QueryResponseTrigger)}
+                ),
+                cv.Optional(CONF_ON_FEATURE_ABORT): automation.validate_automation(
+                    {cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(QueryFeatureAbortTrigger)}
+                ),
+                cv.Optional(CONF_ON_TIMEOUT): automation.validate_automation(
+                    {cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(QueryTimeoutTrigger)}
+                ),
+            }
+        ),
+        validate_query,
+    ),
+)
+async def query_action_to_code(config, action_id, template_args, args):
+    parent = await cg.get_variable(config[CONF_PARENT])
+    var = cg.new_Pvariable(action_id, template_args, parent)
+
+    destination_template_ = await cg.templatable(config[CONF_DESTINATION], args, cg.uint8)
+    cg.add(var.set_destination(destination_template_))
+
     data_vec_ = cg.std_vector.template(cg.uint8)
-    data_template_ = await cg.templatable(config.get(CONF_DATA), args, data_vec_, data_vec_)
+    data_template_ = await cg.templatable(config[CONF_DATA], args, data_vec_, data_vec_)
     cg.add(var.set_data(data_template_))
 
+    cg.add(var.set_reply_opcode(config[CONF_REPLY_OPCODE]))
+    cg.add(var.set_timeout(config[CONF_TIMEOUT].total_milliseconds))
+
+    for conf in config.get(CONF_ON_RESPONSE, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID])
+        cg.add(var.add_response_trigger(trigger))
+        await automation.build_automation(trigger, [(Payload, "data")], conf)
+    for conf in config.get(CONF_ON_FEATURE_ABORT, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID])
+        cg.add(var.add_feature_abort_trigger(trigger))
+        await automation.build_automation(trigger, [(cg.uint8, "reason")], conf)
+    for conf in config.get(CONF_ON_TIMEOUT, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID])
+        cg.add(var.add_timeout_trigger(trigger))
+        await automation.build_automation(trigger, [], conf)
+
     return var
+
+@automation.register_action(
+    "hdmi_cec.dump_edge_trace",
+    DumpEdgeTraceAction,
+    cv.Schema(
+        {
+            cv.GenerateID(CONF_PARENT): cv.use_id(HDMICEC),
+        }
+    ),
+)
+async def dump_edge_trace_action_to_code(config, action_id, template_args, args):
+    parent = await cg.get_variable(config[CONF_PARENT])
+    return cg.new_Pvariable(action_id, template_args, parent)
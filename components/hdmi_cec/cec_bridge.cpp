@@ -0,0 +1,85 @@
+#include "cec_bridge.h"
+
+namespace esphome {
+namespace hdmi_cec {
+
+size_t BridgeRules::physical_address_offset(uint8_t opcode) {
+  switch (opcode) {
+    case 0x70:  // "System Audio Mode Request"
+    case 0x80:  // "Routing Change": original address, then new address
+    case 0x81:  // "Routing Information"
+    case 0x82:  // "Active Source"
+    case 0x84:  // "Report Physical Address"
+    case 0x86:  // "Set Stream Path"
+    case 0x9D:  // "Inactive Source"
+      return 2;
+    default:
+      return 0;
+  }
+}
+
+// number of leading nibbles that identify the subtree of a physical address (0.0.0.0: the whole tree)
+static uint8_t physical_address_depth(uint16_t physical_address) {
+  uint8_t depth = 4;
+  while (depth > 0 && (physical_address & (0xF << (16 - 4 * depth))) == 0) {
+    depth--;
+  }
+  return depth;
+}
+
+uint16_t BridgeRules::map_physical_address(uint16_t physical_address, uint16_t from, uint16_t to) {
+  const uint8_t from_depth = physical_address_depth(from);
+  const uint8_t to_depth = physical_address_depth(to);
+  const uint16_t from_mask = (from_depth == 0) ? 0 : (uint16_t) (0xFFFF << (16 - 4 * from_depth));
+  if ((physical_address & from_mask) != from) {
+    return physical_address;
+  }
+  // keep the part below the subtree root, moved to the depth of the new root
+  uint16_t below = physical_address & ~from_mask;
+  if (to_depth > from_depth) {
+    below >>= 4 * (to_depth - from_depth);
+  } else {
+    below <<= 4 * (from_depth - to_depth);
+  }
+  return to | below;
+}
+
+void BridgeRules::rewrite_(Frame &frame, const BridgeRule &rule) {
+  size_t offset = physical_address_offset(frame.opcode());
+  if (offset == 0) {
+    return;
+  }
+  // "Routing Change" carries two physical addresses
+  const size_t count = (frame.opcode() == 0x80) ? 2 : 1;
+  for (size_t i = 0; i < count; i++, offset += 2) {
+    if (offset + 2 > frame.size()) {
+      return;
+    }
+    uint16_t physical_address = (frame[offset] << 8) | frame[offset + 1];
+    physical_address = map_physical_address(physical_address, rule.physical_address_from, rule.physical_address_to);
+    frame[offset] = physical_address >> 8;
+    frame[offset + 1] = physical_address & 0xFF;
+  }
+}
+
+bool BridgeRules::apply(Frame &frame) const {
+  const uint8_t opcode = frame.opcode();
+  for (const auto &rule : rules_) {
+    if (rule.opcode != BridgeRule::ANY_OPCODE && rule.opcode != opcode) {
+      continue;
+    }
+    switch (rule.action) {
+      case BridgeAction::Allow:
+        return true;
+      case BridgeAction::Deny:
+        return false;
+      case BridgeAction::Rewrite:
+        rewrite_(frame, rule);
+        break;
+    }
+  }
+  return default_action_ != BridgeAction::Deny;
+}
+
+}  // namespace hdmi_cec
+}  // namespace esphome
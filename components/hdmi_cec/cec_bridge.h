@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "cec_frame.h"
+
+namespace esphome {
+namespace hdmi_cec {
+
+enum class BridgeAction : uint8_t {
+  Allow = 0,    // forward the frame
+  Deny = 1,     // drop the frame
+  Rewrite = 2,  // map the physical address operands of the frame, and go on with the next rules
+};
+
+struct BridgeRule {
+  constexpr static uint16_t ANY_OPCODE = 0x100;
+
+  uint16_t opcode;  // opcode the rule applies to, or ANY_OPCODE
+  BridgeAction action;
+  // Rewrite: the physical addresses within the 'from' subtree are moved to the 'to' subtree (e.g. 1.2.0.0 with
+  // 'from' 1.0.0.0 and 'to' 2.1.0.0 becomes 2.1.2.0)
+  uint16_t physical_address_from;
+  uint16_t physical_address_to;
+};
+
+/**
+ * Counters of a bridge between two buses, see HDMICEC::set_bridge().
+ * The latency is the time from the end of a frame on the source bus to the start of the forwarded frame on the
+ * target bus: it includes the wait for the signal free time of the target bus.
+ */
+struct BridgeStats {
+  uint32_t forwarded = 0;  // frames sent on the target bus
+  uint32_t filtered = 0;   // frames dropped by a rule
+  uint32_t failed = 0;     // frames the target bus could not queue, or whose transmission failed
+  uint32_t latency_last_us = 0;
+  uint32_t latency_max_us = 0;
+
+  void record_latency(uint32_t latency_us) {
+    latency_last_us = latency_us;
+    if (latency_us > latency_max_us) {
+      latency_max_us = latency_us;
+    }
+  }
+};
+
+/**
+ * The filtering rules of a bridge. They are checked in order: the first 'Allow' or 'Deny' rule for the opcode of
+ * a frame decides whether it is forwarded, the 'Rewrite' rules met on the way modify it in place.
+ * Frames no 'Allow' or 'Deny' rule applies to get the default action.
+ */
+class BridgeRules {
+ public:
+  void set_default_action(BridgeAction action) { default_action_ = action; }
+  void add_rule(const BridgeRule &rule) { rules_.push_back(rule); }
+
+  // @return true if 'frame' is to be forwarded, 'frame' is rewritten as required
+  bool apply(Frame &frame) const;
+
+  // Position of the first physical address operand of the frame (after the header and the opcode), if any
+  static size_t physical_address_offset(uint8_t opcode);
+  static uint16_t map_physical_address(uint16_t physical_address, uint16_t from, uint16_t to);
+
+ protected:
+  static void rewrite_(Frame &frame, const BridgeRule &rule);
+
+  BridgeAction default_action_ = BridgeAction::Allow;
+  std::vector<BridgeRule> rules_;
+};
+
+}  // namespace hdmi_cec
+}  // namespace esphome
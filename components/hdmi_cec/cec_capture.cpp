@@ -0,0 +1,96 @@
+#include "cec_capture.h"
+
+#ifdef USE_HDMI_CEC_CAPTURE
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace hdmi_cec {
+
+static const char *const TAG = "hdmi_cec.capture";
+
+size_t CaptureRecord::serialize(uint8_t *buffer) const {
+  const size_t length = frame.size();
+  buffer[0] = capture::SYNC;
+  buffer[1] = flags;
+  buffer[2] = result;
+  buffer[3] = (uint8_t) length;
+  for (size_t i = 0; i < 4; i++) {
+    buffer[4 + i] = (time_us >> (8 * i)) & 0xFF;
+  }
+  buffer[8] = ack_bits & 0xFF;
+  buffer[9] = ack_bits >> 8;
+  for (size_t i = 0; i < length; i++) {
+    buffer[capture::HEADER_SIZE + i] = frame[i];
+  }
+  return capture::HEADER_SIZE + length;
+}
+
+void LogCaptureSink::write(const uint8_t *data, size_t length) {
+  // about 4 records per line: short enough for the logger's buffer
+  constexpr size_t CHUNK = 96;
+  char line[2 * CHUNK + 1];
+  for (size_t offset = 0; offset < length; offset += CHUNK) {
+    size_t chunk = std::min(CHUNK, length - offset);
+    for (size_t i = 0; i < chunk; i++) {
+      snprintf(line + 2 * i, 3, "%02X", data[offset + i]);
+    }
+    line[2 * chunk] = '\0';
+    ESP_LOGI(TAG, "capture: %s", line);
+  }
+}
+
+#ifdef USE_HDMI_CEC_CAPTURE_TCP
+bool TCPCaptureSink::connect_() {
+  last_connect_ms_ = millis();
+  connect_attempted_ = true;
+  socket_ = socket::socket_ip(SOCK_STREAM, 0);
+  if (socket_ == nullptr) {
+    ESP_LOGW(TAG, "could not create socket: errno %d", errno);
+    return false;
+  }
+  socket_->setblocking(false);
+  struct sockaddr_storage address;
+  socklen_t address_length =
+      socket::set_sockaddr((struct sockaddr *) &address, sizeof(address), host_, port_);
+  if (address_length == 0 ||
+      (socket_->connect((struct sockaddr *) &address, address_length) != 0 && errno != EINPROGRESS)) {
+    ESP_LOGW(TAG, "could not connect to %s:%u: errno %d", host_.c_str(), port_, errno);
+    socket_ = nullptr;
+    return false;
+  }
+  ESP_LOGD(TAG, "connecting to %s:%u", host_.c_str(), port_);
+  return true;
+}
+
+void TCPCaptureSink::write(const uint8_t *data, size_t length) {
+  if (socket_ == nullptr) {
+    if (connect_attempted_ && millis() - last_connect_ms_ < RECONNECT_INTERVAL_MS) {
+      return;
+    }
+    if (!connect_()) {
+      return;
+    }
+  }
+  ssize_t written = socket_->write(data, length);
+  if (written >= 0) {
+    // a partial write leaves a truncated record, the decoder skips it
+    return;
+  }
+  if (errno == EWOULDBLOCK || errno == EAGAIN || errno == ENOTCONN) {
+    // still connecting, or the socket buffer is full: drop these records
+    return;
+  }
+  ESP_LOGW(TAG, "connection to %s:%u lost: errno %d", host_.c_str(), port_, errno);
+  socket_ = nullptr;
+}
+#endif
+
+}  // namespace hdmi_cec
+}  // namespace esphome
+
+#endif  // USE_HDMI_CEC_CAPTURE
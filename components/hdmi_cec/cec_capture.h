@@ -0,0 +1,171 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+#ifdef USE_HDMI_CEC_CAPTURE
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "esphome/core/hal.h"
+#include "cec_frame.h"
+#include "cec_timer.h"
+#include "cec_transmitter.h"
+
+#ifdef USE_UART
+#include "esphome/components/uart/uart.h"
+#endif
+#ifdef USE_HDMI_CEC_CAPTURE_TCP
+#include "esphome/components/socket/socket.h"
+#endif
+
+namespace esphome {
+namespace hdmi_cec {
+
+/**
+ * Binary capture record format, one record per frame seen on the bus, all words little endian:
+ *  - uint8 sync byte 0xCE, to find the next record again after lost bytes
+ *  - uint8 flags: bit 0 set for frames we sent, clear for received frames
+ *  - uint8 send result (see SendResult), 0 for received frames
+ *  - uint8 frame length N (1..16)
+ *  - uint32 timestamp in microseconds ('micros()'), at the end of the frame
+ *  - uint16 ACK bits: bit i set if the ACK bit of byte i was '0' (line held low)
+ *  - N frame bytes
+ */
+namespace capture {
+constexpr static uint8_t SYNC = 0xCE;
+constexpr static uint8_t FLAG_TX = 0x01;
+constexpr static size_t HEADER_SIZE = 10;
+constexpr static size_t MAX_RECORD_SIZE = HEADER_SIZE + Frame::MAX_LENGTH;
+}  // namespace capture
+
+struct CaptureRecord {
+  uint32_t time_us;
+  uint8_t flags;
+  uint8_t result;
+  uint16_t ack_bits;
+  Frame frame;
+
+  // Write the record in the binary format into 'buffer', which holds at least capture::MAX_RECORD_SIZE bytes.
+  // @return the number of bytes written
+  size_t serialize(uint8_t *buffer) const;
+};
+
+/**
+ * Preallocated ring of capture records, filled by the GPIO interrupt handler (received frames) and the timer
+ * callback (sent frames), and drained by the loop. When it is full, new records are dropped and counted.
+ * It records nothing until it is allocated, which only the buses with a 'capture' sink do.
+ * The interrupt handler and the timer callback may run on different cores: push() and pop() take a CrossCoreLock.
+ */
+class CaptureRing {
+ public:
+  // keep up to 'size' records until the loop drains them, from now on
+  void allocate(size_t size) {
+    records_.reset(new CaptureRecord[size]());  // NOLINT(cppcoreguidelines-owning-memory)
+    size_ = size;
+    first_ = 0;
+    count_ = 0;
+  }
+
+  bool IRAM_ATTR push(uint32_t time_us, uint8_t flags, SendResult result, uint16_t ack_bits, const Frame &frame) {
+    if (size_ == 0) {
+      return false;
+    }
+    CrossCoreLockGuard guard(lock_);
+    if (count_ == size_) {
+      dropped_ = dropped_ + 1;
+      return false;
+    }
+    CaptureRecord &record = records_[(first_ + count_) % size_];
+    record.time_us = time_us;
+    record.flags = flags;
+    record.result = (uint8_t) result;
+    record.ack_bits = ack_bits;
+    record.frame = frame;
+    count_ = count_ + 1;
+    return true;
+  }
+  // take the oldest record
+  bool pop(CaptureRecord &record) {
+    CrossCoreLockGuard guard(lock_);
+    if (count_ == 0) {
+      return false;
+    }
+    record = records_[first_];
+    first_ = (first_ + 1) % size_;
+    count_ = count_ - 1;
+    return true;
+  }
+  bool is_empty() const { return count_ == 0; }
+  size_t size() const { return size_; }
+  // records lost because the ring was full
+  uint32_t dropped() const { return dropped_; }
+
+ protected:
+  std::unique_ptr<CaptureRecord[]> records_;
+  size_t size_{0};
+  CrossCoreLock lock_;
+  volatile size_t first_{0};
+  volatile size_t count_{0};
+  volatile uint32_t dropped_{0};
+};
+
+/**
+ * Destination of the capture stream. The loop passes it batches of whole records.
+ * A sink must not block: if it can't keep up, it drops data (the sync bytes let the decoder recover).
+ */
+class CaptureSink {
+ public:
+  virtual ~CaptureSink() = default;
+  virtual void write(const uint8_t *data, size_t length) = 0;
+  virtual const char *name() const = 0;
+};
+
+// Writes the records to the log as hex lines "capture: <hex>", see tools/cec_capture.py
+class LogCaptureSink : public CaptureSink {
+ public:
+  void write(const uint8_t *data, size_t length) override;
+  const char *name() const override { return "logger"; }
+};
+
+#ifdef USE_UART
+// Writes the raw records to a UART
+class UARTCaptureSink : public CaptureSink, public uart::UARTDevice {
+ public:
+  explicit UARTCaptureSink(uart::UARTComponent *parent) : uart::UARTDevice(parent) {}
+  void write(const uint8_t *data, size_t length) override { write_array(data, length); }
+  const char *name() const override { return "uart"; }
+};
+#endif
+
+#ifdef USE_HDMI_CEC_CAPTURE_TCP
+/**
+ * Streams the raw records to a TCP server, e.g. 'nc -l 6000 > capture.bin'.
+ * It connects on the first write, and tries to reconnect every few seconds after a failure.
+ * Records written while it is not connected, or while the socket buffer is full, are dropped.
+ */
+class TCPCaptureSink : public CaptureSink {
+ public:
+  TCPCaptureSink(std::string host, uint16_t port) : host_(std::move(host)), port_(port) {}
+  void write(const uint8_t *data, size_t length) override;
+  const char *name() const override { return "tcp"; }
+
+ protected:
+  constexpr static uint32_t RECONNECT_INTERVAL_MS = 5000;
+
+  bool connect_();
+
+  std::string host_;
+  uint16_t port_;
+  std::unique_ptr<socket::Socket> socket_;
+  uint32_t last_connect_ms_{0};
+  bool connect_attempted_{false};
+};
+#endif
+
+}  // namespace hdmi_cec
+}  // namespace esphome
+
+#endif  // USE_HDMI_CEC_CAPTURE
@@ -1,17 +1,26 @@
+#include <algorithm>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
-#include <map>
 #include <array>
-#include <cstdio>
 
-#include "hdmi_cec.h"
 #include "cec_decoder.h"
 
 namespace esphome {
 namespace hdmi_cec {
 
-const std::array<const char *, 0x77> Decoder::UI_Commands = {
+/**
+ * Without 'decode_messages', the names of the opcodes and operand values, and the formatting of the text are left
+ * out of the firmware: the structured decode stays, for the device cache and the on_decoded_message triggers.
+ */
+#ifdef USE_CEC_DECODER
+#define CEC_NAME(name) name
+#else
+#define CEC_NAME(name) ""
+#endif
+
+#ifdef USE_CEC_DECODER
+constexpr std::array<const char *, 0x77> Decoder::UI_Commands PROGMEM = {
     /* 0x00 = */ "Select",
     "Up",
     "Down",
@@ -133,148 +142,65 @@ const std::array<const char *, 0x77> Decoder::UI_Commands = {
     "Data"};
 
 // See 'short audio descriptor' in https://en.wikipedia.org/wiki/Extended_Display_Identification_Data
-const std::array<const char *, 0x11> Decoder::audio_formats = {
+constexpr std::array<const char *, 0x11> Decoder::audio_formats PROGMEM = {
     "reserved", "LPCM", "AC3",    "MPEG-1",           "MP3",       "MPEG-2",  "AAC",       "DTS", "ATRAC",
     "DSD",      "DD+",  "DTS-HD", "MAT/Dolby TrueHD", "DST Audio", "WMA Pro", "Extension?"};
-const std::array<const char *, 8> Decoder::audio_samplerates = {"32", "44.1", "48",  "88",
+constexpr std::array<const char *, 8> Decoder::audio_samplerates PROGMEM = {"32", "44.1", "48",  "88",
                                                                 "96", "176",  "192", "Reserved"};
+#endif
 
 template<uint32_t OPERANDS> bool Decoder::do_operand() {
   if (OPERANDS <= 0xFF) {
     // generic function called for single operand of unkown type and length
-    return append_operand(".");
+    return add_operand((Operand) OPERANDS, 1);
   } else {
     return do_operand<OPERANDS & 0xFF>() && do_operand<(OPERANDS >> 8u)>();
   }
 }
 
 /**
- * List of specialised operand decode functions, one function per operand type.
+ * List of specialised operand decode functions, for the operand types that don't take exactly one byte.
  * (Not fully complete, might be extended later)
  */
-template<> bool Decoder::do_operand<Decoder::None>() { return append_operand(""); }
-
-template<> bool Decoder::do_operand<Decoder::AbortReason>() {
-  const static std::array<const char *, 6> names = {"Unrecognized opcode",
-                                                    "Not in correct mode to respond",
-                                                    "Cannot provide source",
-                                                    "Invalid operand",
-                                                    "Refused",
-                                                    "Unable to determine"};
-  return append_operand<names.size()>(names);
-}
+template<> bool Decoder::do_operand<Decoder::None>() { return add_operand(None, 0); }
 
 template<> bool Decoder::do_operand<Decoder::AudioFormat>() {
   // this type of operand comes in a sequence, until exhausted
   bool ok = true;
   while (ok && (offset_ < frame_.size())) {
-    ok = append_operand<audio_formats.size()>(audio_formats);
+    ok = add_operand(AudioFormat, 1);
   }
   return ok;
 }
 
-template<> bool Decoder::do_operand<Decoder::AudioStatus>() {
-  char line[20];
-  if (offset_ < frame_.size()) {
-    uint8_t field = frame_[offset_];
-    std::sprintf(line, "Mute=%d,Vol=%02X", (field >> 7), (field & 0x7f));
-    return append_operand(line);
-  } else {
-    return append_operand("?");
-  }
-}
-
-template<> bool Decoder::do_operand<Decoder::DeviceType>() {
-  const static std::array<const char *, 8> names = {"TV",           "Recording Device", "Reserved",
-                                                    "Tuner",       "Playback Device", "Audio System",
-                                                    "Pure CEC Switch", "Video Processor"};
-  return append_operand<names.size()>(names);
-}
-
-template<> bool Decoder::do_operand<Decoder::DisplayControl>() {
-  const static std::array<const char *, 4> names = {"Default Time", "Until cleared", "Clear previous",
-                                                    "Reserved"};
-  return append_operand<names.size()>(names);
-}
-
 template<> bool Decoder::do_operand<Decoder::FeatureOpcode>() {
   if (offset_ >= frame_.size()) {
     return false;
   }
-  uint8_t opcode = frame_[offset_];
-  return append_operand(find_opcode_name(opcode));
+  return add_operand(FeatureOpcode, 1);
 }
 
 template<> bool Decoder::do_operand<Decoder::OsdString>() {
-  char line[20];  // frame size() is at most 16
-  // copy with typecast and append '\0' char to terminate string
-  std::snprintf(line, frame_.size() - offset_ + 1, "%s", reinterpret_cast<const char *>(frame_.data() + offset_));
-  offset_ = frame_.size();
-  return append_operand(line);
+  // the rest of the frame
+  add_operand(OsdString, (offset_ < frame_.size()) ? frame_.size() - offset_ : 0);
+  return false;
 }
 
-template<> bool Decoder::do_operand<Decoder::PhysicalAddress>() {
-  // Exception: if this is an operand of <System Audio Mode Request> 0x70, then this operand is
-  // merely optional, and its absence means 'Off'
-  if (frame_.at(1) == 0x70 && offset_ >= frame_.size()) {
-    return append_operand("Off");
-  }
-  if (offset_ + 1 >= frame_.size()) {
-    return append_operand("?", 2);
-  }
-  char line[12];
-  std::sprintf(line, "%1x.%1x.%1x.%1x", (frame_[offset_] >> 4) & 0xF, frame_[offset_] & 0xF,
-    (frame_[offset_ + 1] >> 4) & 0xF, frame_[offset_ + 1] & 0xF);
-  return append_operand(line, 2);
-}
-
-template<> bool Decoder::do_operand<Decoder::PowerStatus>() {
-  const static std::array<const char *, 4> names = {"On", "Standby", "Standby->On", "On->Standby"};
-  return append_operand<names.size()>(names);
-}
+template<> bool Decoder::do_operand<Decoder::PhysicalAddress>() { return add_operand(PhysicalAddress, 2); }
 
 template<> bool Decoder::do_operand<Decoder::ShortAudioDescriptor>() {
   // the frame can have a sequence of these operands, count is not fixed;
   // each such operand takes 3 bytes in the frame
-  std::array<char, 100> line;
-  uint32_t pos = 0;
   bool ok = true;
   while (ok && (offset_ + 2 < frame_.size())) {
-    const uint8_t *descriptor = frame_.data() + offset_;
-    uint8_t format = (descriptor[0] >> 3) & 0x0F;
-    pos = std::sprintf(&line[0], "%s", audio_formats[format]);
-    pos += std::sprintf(&line[pos], ",num_channels=%d", (descriptor[0] & 0x07));
-    uint8_t rates = descriptor[1];
-    for (int bit = 0; rates; bit++, rates >>= 1) {
-      if (rates & 0x1) {
-        // show support of various audio sample rates
-        pos += std::sprintf(&line[pos], ",%skHz", audio_samplerates[bit]);
-      }
-    }
-    if (format == 1) {
-      // for LPCM format
-      uint8_t widths = descriptor[2] & 0x7;
-      for (int i = 0; widths; i++, widths >>= 1) {
-        if (widths & 0x1) {
-          // show support of audio samble bit widths of 16, 20, and/or 24
-          pos += std::sprintf(&line[pos], ",%dbits", (16 + 4 * i));
-        }
-      }
-    }
-    ok = append_operand(&line[0], 3);
+    ok = add_operand(ShortAudioDescriptor, 3);
   }
-  // TODO: Further descriptor 'extensions' not yet decoded
   return ok;
 }
 
-template<> bool Decoder::do_operand<Decoder::SystemAudioStatus>() {
-  const static std::array<const char *, 2> names = {"Off", "On"};
-  return append_operand<names.size()>(names);
-}
-
 template<> bool Decoder::do_operand<Decoder::UICommand>() {
-  uint8_t command = frame_[offset_];
-  bool ok = append_operand<UI_Commands.size()>(UI_Commands);
+  uint8_t command = frame_.at(offset_);  // 0 ("Select") if the frame is truncated, takes no extra parameter
+  bool ok = add_operand(UICommand, 1);
   if (!ok) {
     return false;
   }
@@ -299,103 +225,293 @@ template<> bool Decoder::do_operand<Decoder::UICommand>() {
   }
 }
 
-template<> bool Decoder::do_operand<Decoder::VendorId>() {
-  if (offset_ + 2 >= frame_.size()) {
-    return append_operand("?", 3);
-  }
-  uint32_t id = (uint32_t) (frame_[offset_]) << 16 | (uint32_t) (frame_[offset_ + 1]) << 8 | frame_[offset_ + 2];
-  auto it = vendor_ids.find(id);
-  if (it == vendor_ids.end()) {
-    // if the hdmi-cec vendor id is not in our list, the id value itself is printed.
-    char line[12];
-    sprintf(line, "ID=%06x", id);
-    return append_operand(line, 3);
+template<> bool Decoder::do_operand<Decoder::VendorId>() { return add_operand(VendorId, 3); }
+
+bool Decoder::add_operand(Operand type, uint8_t size) {
+  // an operand cut short by the end of the frame is recorded as missing, for the text to show it
+  const bool present = offset_ + size <= frame_.size();
+  if (message_->num_operands < DecodedMessage::MAX_OPERANDS) {
+    DecodedOperand &operand = message_->operands[message_->num_operands++];
+    operand.type = type;
+    operand.offset = offset_;
+    operand.size = present ? size : 0;
+    operand.value = 0;
+    for (uint8_t i = 0; i < operand.size && i < 4; i++) {
+      operand.value = (operand.value << 8) | frame_[offset_ + i];
+    }
   }
-  return append_operand(it->second, 3);
+  offset_ += size;
+  return offset_ < frame_.size();
+}
+
+#ifdef USE_CEC_DECODER
+/**
+ * Helper function to implement 'format_operand': the name of the operand value in 'strings', or "?"
+ */
+template<uint32_t N_STRINGS>
+void Decoder::append_operand(const std::array<const char *, N_STRINGS> &strings, const DecodedOperand &operand) {
+  const char *s = (operand.is_present() && operand.value < N_STRINGS) ? progmem_read_ptr(&strings[operand.value])
+                                                                      : nullptr;
+  append_operand(s ? s : "?");  // null-guard: nullptr entry in array -> "?"
 }
 
-template<> bool Decoder::do_operand<Decoder::CecVersion>() {
-  const static std::array<const char *, 9> names = {"?", "1.2", "1.2a", "1.3", "1.3a", "1.4", "2.0", "2.x", "2.x"};
-  return append_operand<names.size()>(names);
+/**
+ * Text of each operand type. The ones not listed here are shown as "[.]"
+ */
+void Decoder::format_operand(const DecodedMessage &message, const DecodedOperand &operand) {
+  switch (operand.type) {
+    case None:
+      append_operand("");
+      break;
+
+    case AbortReason: {
+      static constexpr std::array<const char *, 6> names PROGMEM = {"Unrecognized opcode",
+                                                        "Not in correct mode to respond",
+                                                        "Cannot provide source",
+                                                        "Invalid operand",
+                                                        "Refused",
+                                                        "Unable to determine"};
+      append_operand<names.size()>(names, operand);
+      break;
+    }
+
+    case AudioFormat:
+      append_operand<audio_formats.size()>(audio_formats, operand);
+      break;
+
+    case AudioStatus: {
+      if (!operand.is_present()) {
+        append_operand("?");
+        break;
+      }
+      char line[24];
+      std::snprintf(line, sizeof(line), "Mute=%d,Vol=%02X", (int) (operand.value >> 7), (int) (operand.value & 0x7f));
+      append_operand(line);
+      break;
+    }
+
+    case CecVersion: {
+      static constexpr std::array<const char *, 9> names PROGMEM = {"?", "1.2", "1.2a", "1.3", "1.3a", "1.4", "2.0", "2.x", "2.x"};
+      append_operand<names.size()>(names, operand);
+      break;
+    }
+
+    case DeviceType: {
+      static constexpr std::array<const char *, 8> names PROGMEM = {"TV",           "Recording Device", "Reserved",
+                                                        "Tuner",       "Playback Device", "Audio System",
+                                                        "Pure CEC Switch", "Video Processor"};
+      append_operand<names.size()>(names, operand);
+      break;
+    }
+
+    case DisplayControl: {
+      static constexpr std::array<const char *, 4> names PROGMEM = {"Default Time", "Until cleared", "Clear previous",
+                                                        "Reserved"};
+      append_operand<names.size()>(names, operand);
+      break;
+    }
+
+    case FeatureOpcode:
+      append_operand(find_opcode_name(operand.value));
+      break;
+
+    case OsdString: {
+      char line[Frame::MAX_LENGTH + 1];
+      message.osd_text(line, sizeof(line));
+      append_operand(line);
+      break;
+    }
+
+    case PhysicalAddress: {
+      if (!operand.is_present()) {
+        // Exception: if this is an operand of <System Audio Mode Request> 0x70, then this operand is
+        // merely optional, and its absence means 'Off'
+        append_operand((message.frame.opcode() == 0x70 && operand.offset >= message.frame.size()) ? "Off" : "?");
+        break;
+      }
+      char line[12];
+      std::sprintf(line, "%1x.%1x.%1x.%1x", (unsigned) (operand.value >> 12) & 0xF,
+                   (unsigned) (operand.value >> 8) & 0xF, (unsigned) (operand.value >> 4) & 0xF,
+                   (unsigned) operand.value & 0xF);
+      append_operand(line);
+      break;
+    }
+
+    case PowerStatus: {
+      static constexpr std::array<const char *, 4> names PROGMEM = {"On", "Standby", "Standby->On", "On->Standby"};
+      append_operand<names.size()>(names, operand);
+      break;
+    }
+
+    case ShortAudioDescriptor: {
+      std::array<char, 100> line;
+      const uint8_t descriptor[3] = {(uint8_t) (operand.value >> 16), (uint8_t) (operand.value >> 8),
+                                     (uint8_t) operand.value};
+      uint8_t format = (descriptor[0] >> 3) & 0x0F;
+      uint32_t pos = std::sprintf(&line[0], "%s", progmem_read_ptr(&audio_formats[format]));
+      pos += std::sprintf(&line[pos], ",num_channels=%d", (descriptor[0] & 0x07));
+      uint8_t rates = descriptor[1];
+      for (int bit = 0; rates; bit++, rates >>= 1) {
+        if (rates & 0x1) {
+          // show support of various audio sample rates
+          pos += std::sprintf(&line[pos], ",%skHz", progmem_read_ptr(&audio_samplerates[bit]));
+        }
+      }
+      if (format == 1) {
+        // for LPCM format
+        uint8_t widths = descriptor[2] & 0x7;
+        for (int i = 0; widths; i++, widths >>= 1) {
+          if (widths & 0x1) {
+            // show support of audio samble bit widths of 16, 20, and/or 24
+            pos += std::sprintf(&line[pos], ",%dbits", (16 + 4 * i));
+          }
+        }
+      }
+      // TODO: Further descriptor 'extensions' not yet decoded
+      append_operand(&line[0]);
+      break;
+    }
+
+    case SystemAudioStatus: {
+      static constexpr std::array<const char *, 2> names PROGMEM = {"Off", "On"};
+      append_operand<names.size()>(names, operand);
+      break;
+    }
+
+    case UICommand:
+      append_operand<UI_Commands.size()>(UI_Commands, operand);
+      break;
+
+    case VendorId: {
+      if (!operand.is_present()) {
+        append_operand("?");
+        break;
+      }
+      const char *name = find_vendor_name(operand.value);
+      if (name == nullptr) {
+        // if the hdmi-cec vendor id is not in our list, the id value itself is printed.
+        char line[12];
+        sprintf(line, "ID=%06x", (unsigned) operand.value);
+        append_operand(line);
+        break;
+      }
+      append_operand(name);
+      break;
+    }
+
+    default:
+      append_operand(".");
+      break;
+  }
 }
+#endif
 
-const Decoder::CecOpcodeTable Decoder::cec_opcode_table = {
+constexpr Decoder::FrameType Decoder::cec_opcode_table[] PROGMEM = {
     // opcode,   name,       operands
-    {0x04, {"Image View On", &Decoder::do_operand<None>}},
-    {0x00, {"Feature Abort", &Decoder::do_operand<Two(FeatureOpcode, AbortReason)>}},
-    {0x0D, {"Text View On", &Decoder::do_operand<None>}},
-    {0x82, {"Active Source", &Decoder::do_operand<PhysicalAddress>}},
-    {0x9D, {"Inactive Source", &Decoder::do_operand<PhysicalAddress>}},
-    {0x85, {"Request Active Source", &Decoder::do_operand<None>}},
-    {0x80, {"Routing Change", &Decoder::do_operand<Two(PhysicalAddress, PhysicalAddress)>}},
-    {0x81, {"Routing Information", &Decoder::do_operand<PhysicalAddress>}},
-    {0x86, {"Set Stream Path", &Decoder::do_operand<PhysicalAddress>}},
-    {0x36, {"Standby", &Decoder::do_operand<None>}},
-    {0x0B, {"Record Off", &Decoder::do_operand<None>}},
-    {0x09, {"Record On", &Decoder::do_operand<RecordSource>}},
-    {0x0A, {"Record Status", &Decoder::do_operand<RecordStatusInfo>}},
-    {0x0F, {"Record TV Screen", &Decoder::do_operand<None>}},
-    {0x33, {"Clear Analogue Timer", &Decoder::do_operand<Two(StartDateTime, Duration)>}},
-    {0x99, {"Clear Digital Timer", &Decoder::do_operand<Two(StartDateTime, Duration)>}},
-    {0xA1, {"Clear External Timer", &Decoder::do_operand<Two(StartDateTime, Duration)>}},
-    {0x34, {"Set Analogue Timer", &Decoder::do_operand<Two(StartDateTime, Duration)>}},
-    {0x97, {"Set Digital Timer", &Decoder::do_operand<Two(StartDateTime, Duration)>}},
-    {0xA2, {"Set External Timer", &Decoder::do_operand<Two(StartDateTime, Duration)>}},
-    {0x67, {"Set Timer Program Title", &Decoder::do_operand<ProgramTitleString>}},
-    {0x43, {"Timer Cleared Status", &Decoder::do_operand<TimerClearedStatusData>}},
-    {0x35, {"Timer Status", &Decoder::do_operand<TimerStatusData>}},
-    {0x9E, {"CEC Version", &Decoder::do_operand<CecVersion>}},
-    {0x9F, {"Get CEC Version", &Decoder::do_operand<None>}},
-    {0x83, {"Give Physical Address", &Decoder::do_operand<None>}},
-    {0x91, {"Get Menu Language", &Decoder::do_operand<None>}},
-    {0x84, {"Report Physical Address", &Decoder::do_operand<Two(PhysicalAddress, DeviceType)>}},
-    {0x32, {"Set Menu Language", &Decoder::do_operand<Language>}},
-    {0x42, {"Deck Control", &Decoder::do_operand<DeckControlMode>}},
-    {0x1B, {"Deck Status", &Decoder::do_operand<DeckInfo>}},
-    {0x1A, {"Give Deck Status", &Decoder::do_operand<StatusRequest>}},
-    {0x41, {"Play", &Decoder::do_operand<PlayMode>}},
-    {0x08, {"Give Tuner Device Status", &Decoder::do_operand<StatusRequest>}},
-    {0x92,
-     {"Select Analogue Service", &Decoder::do_operand<Three(AnalogBroadcastType, AnalogFrequency, BroadcastSystem)>}},
-    {0x93, {"Select Digital Service", &Decoder::do_operand<DigitalServiceIdentification>}},
-    {0x07, {"Tuner Device Status", &Decoder::do_operand<TunerDeviceInfo>}},
-    {0x06, {"Tuner Step Decrement", &Decoder::do_operand<None>}},
-    {0x05, {"Tuner Step Increment", &Decoder::do_operand<None>}},
-    {0x87, {"Device Vendor ID", &Decoder::do_operand<VendorId>}},
-    {0x8C, {"Give Device Vendor ID", &Decoder::do_operand<None>}},
-    {0x89, {"Vendor Command", &Decoder::do_operand<VendorSpecificData>}},
-    {0xA0, {"Vendor Command With ID", &Decoder::do_operand<Two(VendorId, VendorSpecificData)>}},
-    {0x8A, {"Vendor Remote Button Down", &Decoder::do_operand<VendorSpecificRCCode>}},
-    {0x8B, {"Vendor Remote Button Up", &Decoder::do_operand<None>}},
-    {0x64, {"Set OSD String", &Decoder::do_operand<Two(DisplayControl, OsdString)>}},
-    {0x46, {"Give OSD Name", &Decoder::do_operand<None>}},
-    {0x47, {"Set OSD Name", &Decoder::do_operand<OsdName>}},
-    {0x8D, {"Menu Request", &Decoder::do_operand<MenuRequestType>}},
-    {0x8E, {"Menu Status", &Decoder::do_operand<MenuState>}},
-    {0x44, {"User Control Pressed", &Decoder::do_operand<UICommand>}},
-    {0x45, {"User Control Released", &Decoder::do_operand<None>}},
-    {0x8F, {"Give Device Power Status", &Decoder::do_operand<None>}},
-    {0x90, {"Report Power Status", &Decoder::do_operand<PowerStatus>}},
-    {0x00, {"Feature Abort", &Decoder::do_operand<Two(FeatureOpcode, AbortReason)>}},
-    {0xFF, {"Abort", &Decoder::do_operand<None>}},
-    {0x71, {"Give Audio Status", &Decoder::do_operand<None>}},
-    {0x7D, {"Give System Audio Mode Status", &Decoder::do_operand<None>}},
-    {0x7A, {"Report Audio Status", &Decoder::do_operand<AudioStatus>}},
-    {0xA3, {"Report Short Audio Descriptor", &Decoder::do_operand<ShortAudioDescriptor>}},
-    {0xA4, {"Request Short Audio Descriptor", &Decoder::do_operand<AudioFormat>}},
-    {0x72, {"Set System Audio Mode", &Decoder::do_operand<SystemAudioStatus>}},
-    {0x70, {"System Audio Mode Request", &Decoder::do_operand<PhysicalAddress>}},
-    {0x7E, {"System Audio Mode Status", &Decoder::do_operand<SystemAudioStatus>}},
-    {0x9A, {"Set Audio Rate", &Decoder::do_operand<AudioRate>}},
-    {0xC0, {"Initiate ARC", &Decoder::do_operand<None>}},
-    {0xC1, {"Report ARC Initiated", &Decoder::do_operand<None>}},
-    {0xC2, {"Report ARC Terminated", &Decoder::do_operand<None>}},
-    {0xC3, {"Request ARC Initiation", &Decoder::do_operand<None>}},
-    {0xC4, {"Request ARC Termination", &Decoder::do_operand<None>}},
-    {0xC5, {"Terminate ARC", &Decoder::do_operand<None>}},
-    {0xF8, {"CDC Message", &Decoder::do_operand<None>}}};
-
-const std::map<uint32_t, const char *> Decoder::vendor_ids = {
+    {0x04, CEC_NAME("Image View On"), &Decoder::do_operand<None>},
+    {0x0D, CEC_NAME("Text View On"), &Decoder::do_operand<None>},
+    {0x82, CEC_NAME("Active Source"), &Decoder::do_operand<PhysicalAddress>},
+    {0x9D, CEC_NAME("Inactive Source"), &Decoder::do_operand<PhysicalAddress>},
+    {0x85, CEC_NAME("Request Active Source"), &Decoder::do_operand<None>},
+    {0x80, CEC_NAME("Routing Change"), &Decoder::do_operand<Two(PhysicalAddress, PhysicalAddress)>},
+    {0x81, CEC_NAME("Routing Information"), &Decoder::do_operand<PhysicalAddress>},
+    {0x86, CEC_NAME("Set Stream Path"), &Decoder::do_operand<PhysicalAddress>},
+    {0x36, CEC_NAME("Standby"), &Decoder::do_operand<None>},
+    {0x0B, CEC_NAME("Record Off"), &Decoder::do_operand<None>},
+    {0x09, CEC_NAME("Record On"), &Decoder::do_operand<RecordSource>},
+    {0x0A, CEC_NAME("Record Status"), &Decoder::do_operand<RecordStatusInfo>},
+    {0x0F, CEC_NAME("Record TV Screen"), &Decoder::do_operand<None>},
+    {0x33, CEC_NAME("Clear Analogue Timer"), &Decoder::do_operand<Two(StartDateTime, Duration)>},
+    {0x99, CEC_NAME("Clear Digital Timer"), &Decoder::do_operand<Two(StartDateTime, Duration)>},
+    {0xA1, CEC_NAME("Clear External Timer"), &Decoder::do_operand<Two(StartDateTime, Duration)>},
+    {0x34, CEC_NAME("Set Analogue Timer"), &Decoder::do_operand<Two(StartDateTime, Duration)>},
+    {0x97, CEC_NAME("Set Digital Timer"), &Decoder::do_operand<Two(StartDateTime, Duration)>},
+    {0xA2, CEC_NAME("Set External Timer"), &Decoder::do_operand<Two(StartDateTime, Duration)>},
+    {0x67, CEC_NAME("Set Timer Program Title"), &Decoder::do_operand<ProgramTitleString>},
+    {0x43, CEC_NAME("Timer Cleared Status"), &Decoder::do_operand<TimerClearedStatusData>},
+    {0x35, CEC_NAME("Timer Status"), &Decoder::do_operand<TimerStatusData>},
+    {0x9E, CEC_NAME("CEC Version"), &Decoder::do_operand<CecVersion>},
+    {0x9F, CEC_NAME("Get CEC Version"), &Decoder::do_operand<None>},
+    {0x83, CEC_NAME("Give Physical Address"), &Decoder::do_operand<None>},
+    {0x91, CEC_NAME("Get Menu Language"), &Decoder::do_operand<None>},
+    {0x84, CEC_NAME("Report Physical Address"), &Decoder::do_operand<Two(PhysicalAddress, DeviceType)>},
+    {0x32, CEC_NAME("Set Menu Language"), &Decoder::do_operand<Language>},
+    {0x42, CEC_NAME("Deck Control"), &Decoder::do_operand<DeckControlMode>},
+    {0x1B, CEC_NAME("Deck Status"), &Decoder::do_operand<DeckInfo>},
+    {0x1A, CEC_NAME("Give Deck Status"), &Decoder::do_operand<StatusRequest>},
+    {0x41, CEC_NAME("Play"), &Decoder::do_operand<PlayMode>},
+    {0x08, CEC_NAME("Give Tuner Device Status"), &Decoder::do_operand<StatusRequest>},
+    {0x92, CEC_NAME("Select Analogue Service"),
+     &Decoder::do_operand<Three(AnalogBroadcastType, AnalogFrequency, BroadcastSystem)>},
+    {0x93, CEC_NAME("Select Digital Service"), &Decoder::do_operand<DigitalServiceIdentification>},
+    {0x07, CEC_NAME("Tuner Device Status"), &Decoder::do_operand<TunerDeviceInfo>},
+    {0x06, CEC_NAME("Tuner Step Decrement"), &Decoder::do_operand<None>},
+    {0x05, CEC_NAME("Tuner Step Increment"), &Decoder::do_operand<None>},
+    {0x87, CEC_NAME("Device Vendor ID"), &Decoder::do_operand<VendorId>},
+    {0x8C, CEC_NAME("Give Device Vendor ID"), &Decoder::do_operand<None>},
+    {0x89, CEC_NAME("Vendor Command"), &Decoder::do_operand<VendorSpecificData>},
+    {0xA0, CEC_NAME("Vendor Command With ID"), &Decoder::do_operand<Two(VendorId, VendorSpecificData)>},
+    {0x8A, CEC_NAME("Vendor Remote Button Down"), &Decoder::do_operand<VendorSpecificRCCode>},
+    {0x8B, CEC_NAME("Vendor Remote Button Up"), &Decoder::do_operand<None>},
+    {0x64, CEC_NAME("Set OSD String"), &Decoder::do_operand<Two(DisplayControl, OsdString)>},
+    {0x46, CEC_NAME("Give OSD Name"), &Decoder::do_operand<None>},
+    {0x47, CEC_NAME("Set OSD Name"), &Decoder::do_operand<OsdName>},
+    {0x8D, CEC_NAME("Menu Request"), &Decoder::do_operand<MenuRequestType>},
+    {0x8E, CEC_NAME("Menu Status"), &Decoder::do_operand<MenuState>},
+    {0x44, CEC_NAME("User Control Pressed"), &Decoder::do_operand<UICommand>},
+    {0x45, CEC_NAME("User Control Released"), &Decoder::do_operand<None>},
+    {0x8F, CEC_NAME("Give Device Power Status"), &Decoder::do_operand<None>},
+    {0x90, CEC_NAME("Report Power Status"), &Decoder::do_operand<PowerStatus>},
+    {0x00, CEC_NAME("Feature Abort"), &Decoder::do_operand<Two(FeatureOpcode, AbortReason)>},
+    {0xFF, CEC_NAME("Abort"), &Decoder::do_operand<None>},
+    {0x71, CEC_NAME("Give Audio Status"), &Decoder::do_operand<None>},
+    {0x7D, CEC_NAME("Give System Audio Mode Status"), &Decoder::do_operand<None>},
+    {0x7A, CEC_NAME("Report Audio Status"), &Decoder::do_operand<AudioStatus>},
+    {0xA3, CEC_NAME("Report Short Audio Descriptor"), &Decoder::do_operand<ShortAudioDescriptor>},
+    {0xA4, CEC_NAME("Request Short Audio Descriptor"), &Decoder::do_operand<AudioFormat>},
+    {0x72, CEC_NAME("Set System Audio Mode"), &Decoder::do_operand<SystemAudioStatus>},
+    {0x70, CEC_NAME("System Audio Mode Request"), &Decoder::do_operand<PhysicalAddress>},
+    {0x7E, CEC_NAME("System Audio Mode Status"), &Decoder::do_operand<SystemAudioStatus>},
+    {0x9A, CEC_NAME("Set Audio Rate"), &Decoder::do_operand<AudioRate>},
+    {0xC0, CEC_NAME("Initiate ARC"), &Decoder::do_operand<None>},
+    {0xC1, CEC_NAME("Report ARC Initiated"), &Decoder::do_operand<None>},
+    {0xC2, CEC_NAME("Report ARC Terminated"), &Decoder::do_operand<None>},
+    {0xC3, CEC_NAME("Request ARC Initiation"), &Decoder::do_operand<None>},
+    {0xC4, CEC_NAME("Request ARC Termination"), &Decoder::do_operand<None>},
+    {0xC5, CEC_NAME("Terminate ARC"), &Decoder::do_operand<None>},
+    {0xF8, CEC_NAME("CDC Message"), &Decoder::do_operand<None>}};
+
+constexpr size_t Decoder::cec_opcode_table_size = sizeof(cec_opcode_table) / sizeof(cec_opcode_table[0]);
+
+constexpr std::array<uint8_t, 256> Decoder::make_opcode_index() {
+  std::array<uint8_t, 256> index{};
+  for (size_t i = 0; i < cec_opcode_table_size; i++) {
+    index[cec_opcode_table[i].opcode] = (uint8_t) (i + 1);
+  }
+  return index;
+}
+
+constexpr bool Decoder::has_unique_opcodes() {
+  for (size_t i = 0; i < cec_opcode_table_size; i++) {
+    for (size_t j = i + 1; j < cec_opcode_table_size; j++) {
+      if (cec_opcode_table[i].opcode == cec_opcode_table[j].opcode)
+        return false;
+    }
+  }
+  return true;
+}
+static_assert(Decoder::has_unique_opcodes(), "duplicate opcode in cec_opcode_table");
+
+constexpr std::array<uint8_t, 256> Decoder::cec_opcode_index PROGMEM = Decoder::make_opcode_index();
+
+const Decoder::FrameType *Decoder::find_frame_type(uint8_t opcode) {
+  // O(1) lookup through the opcode index, 0 means "unknown opcode"
+  uint8_t position = progmem_read_byte(&cec_opcode_index[opcode]);
+  return (position == 0) ? nullptr : &cec_opcode_table[position - 1];
+}
+
+#ifdef USE_CEC_DECODER
+constexpr Decoder::VendorName Decoder::vendor_ids[] PROGMEM = {
     {0x000039, "Toshiba"}, {0x0000F0, "Samsung"},     {0x0005CD, "Denon"},         {0x000678, "Maranz"},
     {0x000982, "Loewe"},   {0x0009B0, "Onkyo"},       {0x000CB8, "Medion"},        {0x000CE7, "Toshiba"},
     {0x0010FA, "Apple"},   {0x001582, "Pulse Eight"}, {0x001950, "Harman Kardon"}, {0x001A11, "Google"},
@@ -404,66 +520,198 @@ const std::map<uint32_t, const char *> Decoder::vendor_ids = {
     {0x00E091, "LG"},      {0x08001F, "Sharp"},       {0x080046, "Sony"},          {0x18C086, "Broadcom"},
     {0x534850, "Sharp"},   {0x6B746D, "Vizio"},       {0x8065E9, "Benq"},          {0x9C645E, "Harman Kardon"}};
 
-std::string Decoder::address_decode() const {
-  const static std::array<const char *, 16> names = { "TV", "RecordingDev1", "RecordingDev2", "Tuner1",
+constexpr size_t Decoder::vendor_ids_size = sizeof(vendor_ids) / sizeof(vendor_ids[0]);
+
+constexpr bool Decoder::has_sorted_vendor_ids() {
+  for (size_t i = 1; i < vendor_ids_size; i++) {
+    if (vendor_ids[i - 1].id >= vendor_ids[i].id)
+      return false;
+  }
+  return true;
+}
+static_assert(Decoder::has_sorted_vendor_ids(), "vendor_ids must be sorted for binary search");
+
+void Decoder::address_decode() {
+  static constexpr std::array<const char *, 16> names PROGMEM = { "TV", "RecordingDev1", "RecordingDev2", "Tuner1",
     "PlaybackDev1", "AudioSystem", "Tuner2", "Tuner3", "PlaybackDev2", "RecordingDev3",
     "Tuner4", "PlaybackDev3", "Reserved", "Reserved", "SpecificUse", "Unregistered"};
-  const char* dest = (frame_.is_broadcast()) ? "All" : names[frame_.destination_addr()];
-  return std::string(names[frame_.initiator_addr()]) + " to " + dest + ": ";
+  const char* dest = (frame_.is_broadcast()) ? "All" : progmem_read_ptr(&names[frame_.destination_addr()]);
+  append("%s to ", progmem_read_ptr(&names[frame_.initiator_addr()]));
+  append("%s: ", dest);
 }
 
 const char *Decoder::find_opcode_name(uint32_t opcode) const {
-  auto it = cec_opcode_table.find(opcode);
-  if (it == cec_opcode_table.end()) {
-    return "?";
-  }
-  return it->second.name;
+  const FrameType *type = find_frame_type(opcode);
+  return (type == nullptr) ? "?" : type->name;
 }
 
-  /**
-   * Helper function to implement the 'do_operand' methods, to gather a textual representation.
-   * @return true if a further operand can be decoded, false otherwise
-   */
-  bool Decoder::append_operand(const char *word, uint8_t offset_incr /* default 1 */) {
-    if (length_ < line_.size()) {
-      int written = snprintf(&line_[length_], (line_.size() - length_), "[%s]", word);
-      if (written > 0) {
-        length_ += (unsigned int) written;
-        if (length_ > line_.size())
-          length_ = line_.size();  // clamp: snprintf returns desired length, not actual written
-      }
+const char *Decoder::find_vendor_name(uint32_t id) {
+  // binary search in the sorted vendor_ids table
+  size_t low = 0;
+  size_t high = vendor_ids_size;
+  while (low < high) {
+    size_t mid = (low + high) / 2;
+    if (vendor_ids[mid].id < id) {
+      low = mid + 1;
+    } else {
+      high = mid;
     }
-    offset_ += offset_incr;
-    return (length_ < line_.size()) && (offset_ < frame_.size());
   }
+  return (low < vendor_ids_size && vendor_ids[low].id == id) ? vendor_ids[low].name : nullptr;
+}
 
 /**
- * Entry function 'decode' to call for full decode of a CEC frame
+ * Append formatted text to the output buffer, as far as it fits
  */
-std::string Decoder::decode() {
-  // src and dest fields
-  std::string result = address_decode();
-  // opcode field
+void Decoder::append(const char *format, const char *text) {
+  if (is_full()) {
+    return;
+  }
+  int written = snprintf(out_ + length_, out_size_ - length_, format, text);
+  if (written > 0) {
+    length_ += (size_t) written;
+    if (length_ >= out_size_)
+      length_ = out_size_ - 1;  // clamp: snprintf returns desired length, not actual written
+  }
+}
 
+void Decoder::append_operand(const char *word) { append("[%s]", word); }
+#endif
+
+/**
+ * Entry function 'decode' to call for the structured decode of a CEC frame
+ */
+void Decoder::decode(DecodedMessage &message) {
+  message.frame = frame_;
+  message.name = nullptr;
+  message.num_operands = 0;
   if (frame_.size() <= 1) {
-    // Missing frame operation field?
-    return result + "Ping";
+    // ping
+    return;
   }
-
-  auto it = cec_opcode_table.find(frame_.opcode());
-  if (it == cec_opcode_table.end()) {
-    return result + std::string("<?>");
+  const FrameType *type = find_frame_type(frame_.opcode());
+  if (type == nullptr) {
+    return;
   }
+  message.name = type->name;
 
-  result += std::string("<") + it->second.name + ">";
   // operand fields
-  length_ = 0;  // currently accumulated length of text of operands
-  line_[length_] = 0;  // initialise operand text to empty string
+  message_ = &message;
   offset_ = 2;  // location in frame of first operand to decode
-  OperandDecode_f f = it->second.decode_f;
+  OperandDecode_f f = type->decode_f;
   (this->*f)();
-  result += &line_[0];
-  return result;
+  message_ = nullptr;
+}
+
+/**
+ * Entry function 'format' to call for the text of a decoded CEC frame
+ */
+size_t Decoder::format(const DecodedMessage &message, char *buffer, size_t size) {
+#ifndef USE_CEC_DECODER
+  // no text to decode into: the frame bytes
+  return message.frame.format(buffer, size, true);
+#else
+  out_ = buffer;
+  out_size_ = size;
+  length_ = 0;
+  if (size == 0) {
+    return 0;
+  }
+  out_[0] = '\0';
+
+  // src and dest fields
+  address_decode();
+
+  // opcode field
+  if (message.is_ping()) {
+    // Missing frame operation field?
+    append("%s", "Ping");
+    return length_;
+  }
+  if (!message.is_known()) {
+    append("%s", "<?>");
+    return length_;
+  }
+  append("<%s>", message.name);
+
+  // operand fields
+  for (size_t i = 0; i < message.num_operands && !is_full(); i++) {
+    format_operand(message, message.operands[i]);
+  }
+  return length_;
+#endif
+}
+
+size_t Decoder::decode(char *buffer, size_t size) {
+  DecodedMessage message;
+  decode(message);
+  return format(message, buffer, size);
+}
+
+std::string Decoder::decode() {
+  char buffer[Frame::MAX_TEXT_LENGTH];
+  decode(buffer, sizeof(buffer));
+  return std::string(buffer);
+}
+
+const DecodedOperand *DecodedMessage::find(Decoder::Operand type, size_t index) const {
+  for (size_t i = 0; i < num_operands; i++) {
+    const DecodedOperand &operand = operands[i];
+    if (operand.type == type && operand.is_present() && index-- == 0) {
+      return &operand;
+    }
+  }
+  return nullptr;
+}
+
+optional<uint16_t> DecodedMessage::physical_address(size_t index) const {
+  auto address = value(Decoder::PhysicalAddress, index);
+  return address.has_value() ? optional<uint16_t>(*address) : optional<uint16_t>();
+}
+
+// the value of a single byte operand
+static optional<uint8_t> byte_value(const DecodedMessage &message, Decoder::Operand type) {
+  auto value = message.value(type);
+  return value.has_value() ? optional<uint8_t>(*value) : optional<uint8_t>();
+}
+
+optional<uint8_t> DecodedMessage::device_type() const { return byte_value(*this, Decoder::DeviceType); }
+optional<uint32_t> DecodedMessage::vendor_id() const { return value(Decoder::VendorId); }
+optional<uint8_t> DecodedMessage::ui_command() const { return byte_value(*this, Decoder::UICommand); }
+optional<uint8_t> DecodedMessage::power_status() const { return byte_value(*this, Decoder::PowerStatus); }
+optional<uint8_t> DecodedMessage::cec_version() const { return byte_value(*this, Decoder::CecVersion); }
+optional<uint8_t> DecodedMessage::feature_opcode() const { return byte_value(*this, Decoder::FeatureOpcode); }
+optional<uint8_t> DecodedMessage::abort_reason() const { return byte_value(*this, Decoder::AbortReason); }
+
+optional<uint8_t> DecodedMessage::volume() const {
+  auto status = value(Decoder::AudioStatus);
+  return status.has_value() ? optional<uint8_t>(*status & 0x7F) : optional<uint8_t>();
+}
+
+optional<bool> DecodedMessage::muted() const {
+  auto status = value(Decoder::AudioStatus);
+  return status.has_value() ? optional<bool>((*status & 0x80) != 0) : optional<bool>();
+}
+
+size_t DecodedMessage::osd_text(char *buffer, size_t size) const {
+  if (size == 0) {
+    return 0;
+  }
+  size_t length = 0;
+  const DecodedOperand *operand = find(Decoder::OsdString);
+  if (operand != nullptr) {
+    // the frame bytes are not null-terminated: copy them, and append '\0' char to terminate string
+    length = std::min((size_t) operand->size, size - 1);
+    std::memcpy(buffer, frame.data() + operand->offset, length);
+  }
+  buffer[length] = '\0';
+  return length;
+}
+
+std::string DecodedMessage::to_string() const {
+  char buffer[Frame::MAX_TEXT_LENGTH];
+  format(buffer, sizeof(buffer));
+  return std::string(buffer);
 }
 
 }  // namespace hdmi_cec
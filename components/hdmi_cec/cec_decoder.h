@@ -3,16 +3,96 @@
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
-#include <map>
 #include <array>
 
-#include "hdmi_cec.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/optional.h"
+#include "cec_frame.h"
 
 namespace esphome {
 namespace hdmi_cec {
 
+// The opcodes known to the Decoder
+enum class Opcode : uint8_t {
+  FeatureAbort = 0x00,
+  ImageViewOn = 0x04,
+  TunerStepIncrement = 0x05,
+  TunerStepDecrement = 0x06,
+  TunerDeviceStatus = 0x07,
+  GiveTunerDeviceStatus = 0x08,
+  RecordOn = 0x09,
+  RecordStatus = 0x0A,
+  RecordOff = 0x0B,
+  TextViewOn = 0x0D,
+  RecordTvScreen = 0x0F,
+  GiveDeckStatus = 0x1A,
+  DeckStatus = 0x1B,
+  SetMenuLanguage = 0x32,
+  ClearAnalogueTimer = 0x33,
+  SetAnalogueTimer = 0x34,
+  TimerStatus = 0x35,
+  Standby = 0x36,
+  Play = 0x41,
+  DeckControl = 0x42,
+  TimerClearedStatus = 0x43,
+  UserControlPressed = 0x44,
+  UserControlReleased = 0x45,
+  GiveOsdName = 0x46,
+  SetOsdName = 0x47,
+  SetOsdString = 0x64,
+  SetTimerProgramTitle = 0x67,
+  SystemAudioModeRequest = 0x70,
+  GiveAudioStatus = 0x71,
+  SetSystemAudioMode = 0x72,
+  ReportAudioStatus = 0x7A,
+  GiveSystemAudioModeStatus = 0x7D,
+  SystemAudioModeStatus = 0x7E,
+  RoutingChange = 0x80,
+  RoutingInformation = 0x81,
+  ActiveSource = 0x82,
+  GivePhysicalAddress = 0x83,
+  ReportPhysicalAddress = 0x84,
+  RequestActiveSource = 0x85,
+  SetStreamPath = 0x86,
+  DeviceVendorId = 0x87,
+  VendorCommand = 0x89,
+  VendorRemoteButtonDown = 0x8A,
+  VendorRemoteButtonUp = 0x8B,
+  GiveDeviceVendorId = 0x8C,
+  MenuRequest = 0x8D,
+  MenuStatus = 0x8E,
+  GiveDevicePowerStatus = 0x8F,
+  ReportPowerStatus = 0x90,
+  GetMenuLanguage = 0x91,
+  SelectAnalogueService = 0x92,
+  SelectDigitalService = 0x93,
+  SetDigitalTimer = 0x97,
+  ClearDigitalTimer = 0x99,
+  SetAudioRate = 0x9A,
+  InactiveSource = 0x9D,
+  CecVersion = 0x9E,
+  GetCecVersion = 0x9F,
+  VendorCommandWithId = 0xA0,
+  ClearExternalTimer = 0xA1,
+  SetExternalTimer = 0xA2,
+  ReportShortAudioDescriptor = 0xA3,
+  RequestShortAudioDescriptor = 0xA4,
+  InitiateArc = 0xC0,
+  ReportArcInitiated = 0xC1,
+  ReportArcTerminated = 0xC2,
+  RequestArcInitiation = 0xC3,
+  RequestArcTermination = 0xC4,
+  TerminateArc = 0xC5,
+  CdcMessage = 0xF8,
+  Abort = 0xFF,
+};
+
+struct DecodedOperand;
+struct DecodedMessage;
+
 /**
- * This Decoder class interprets a binary CEC Frame to create a textual representation.
+ * This Decoder class interprets a binary CEC Frame, into a DecodedMessage (opcode and typed operands), and
+ * from there into a textual representation.
  * The information to create this decoder is mostly extracted from the HDMI 1.3a standard document,
  * from its section "Supplement 1 Consumer Electronics Control (CEC)".
  * Some further details were found in the Linux kernel source code of the "v4l-utils" repository,
@@ -22,40 +102,23 @@ namespace hdmi_cec {
  */
 class Decoder {
  public:
-  Decoder(const Frame &frame) : frame_(frame), length_(0), offset_(2) {}
-  std::string decode();
-
- protected:
-  const char *find_opcode_name(uint32_t opcode) const;
-  std::string address_decode() const;
-
+  Decoder(const Frame &frame) : frame_(frame), message_(nullptr), out_(nullptr), out_size_(0), length_(0), offset_(2) {}
+  // Split the frame into its opcode and operands, without any heap allocation
+  void decode(DecodedMessage &message);
   /**
-   * Generic operand decode method, later specialised with operand-type-specific methods
-   * @return true if further conversions can continue, false when to stop.
+   * Write the textual representation of the frame into 'buffer', without any heap allocation.
+   * The text is truncated to fit, and always null-terminated.
+   * @return the length of the text
    */
-  template<uint32_t OPERANDS> bool do_operand();
-
-  /**
-   * The CecOpcodeTable is extracted from the HDMI CEC standard (1.4):
-   * It lists all Frame opcodes with their <name> and their expected [operand argument type(s)]
-   */
-  using OperandDecode_f = bool (Decoder::*)();
-  struct FrameType {
-    const char *name;                // name of the operation (of the op_code)
-    const OperandDecode_f decode_f;  // a pointer to the corresponding 'do_operand()' method
-  };
-  using CecOpcodeTable = const std::map<uint8_t, FrameType>;
-  const static CecOpcodeTable cec_opcode_table;
-
-  const Frame &frame_;
-  std::array<char, 256> line_;  // to hold the text of the decoded frame
-  unsigned int length_;         // currently accumulated length of output text in 'line'
-  unsigned int offset_;  // current offset in frame to process next operand byte(s) (frame[0] and [1] are skipped)
+  size_t decode(char *buffer, size_t size);
+  std::string decode();
+  // Same as above, for a message decoded already
+  size_t format(const DecodedMessage &message, char *buffer, size_t size);
 
   /**
    * The HDMI CEC standard specifies a set of distinct operand (parameter) types,
    * used across the frame opcodes, denoted with "[operand type name]".
-   * These specified operand types are enumerated here for later type-specific decoding to text
+   * These specified operand types are enumerated here for later type-specific decoding
    */
   enum Operand : uint8_t {
     None,
@@ -117,6 +180,50 @@ class Decoder {
     VendorSpecificData,
     VendorSpecificRCCode,
   };
+
+ protected:
+  const char *find_opcode_name(uint32_t opcode) const;
+  void address_decode();
+  void append(const char *format, const char *text);
+  bool is_full() const { return length_ + 1 >= out_size_; }
+
+  /**
+   * Generic operand decode method, later specialised with operand-type-specific methods
+   * @return true if further conversions can continue, false when to stop.
+   */
+  template<uint32_t OPERANDS> bool do_operand();
+  // Record the operand at the current offset, and move past it. @return true if more operands may follow
+  bool add_operand(Operand type, uint8_t size);
+  void format_operand(const DecodedMessage &message, const DecodedOperand &operand);
+
+  /**
+   * The cec_opcode_table is extracted from the HDMI CEC standard (1.4):
+   * It lists all Frame opcodes with their <name> and their expected [operand argument type(s)].
+   * All tables are constexpr and stored in flash (PROGMEM on the esp8266): they take no RAM and need no
+   * initialization at startup. The name strings they point to are plain literals, in .rodata: flash on the esp32
+   * and the rp2040, but RAM on the esp8266, because 'name' is handed out to the automations as a normal string.
+   * The 256-entry cec_opcode_index maps each opcode to its table entry.
+   * Table entries only have 32-bit fields, so they can be read from flash directly.
+   */
+  using OperandDecode_f = bool (Decoder::*)();
+  struct FrameType {
+    uint32_t opcode;                 // the op_code
+    const char *name;                // name of the operation (of the op_code)
+    OperandDecode_f decode_f;        // a pointer to the corresponding 'do_operand()' method
+  };
+  const static FrameType cec_opcode_table[];
+  const static size_t cec_opcode_table_size;
+  const static std::array<uint8_t, 256> cec_opcode_index;  // opcode -> position in cec_opcode_table + 1, or 0
+  static constexpr std::array<uint8_t, 256> make_opcode_index();
+  static const FrameType *find_frame_type(uint8_t opcode);
+
+  const Frame &frame_;
+  DecodedMessage *message_;  // result of the decode in progress
+  char *out_;            // caller's buffer to hold the text of the decoded frame
+  size_t out_size_;      // size of that buffer
+  size_t length_;        // currently accumulated length of output text in 'out_'
+  unsigned int offset_;  // current offset in frame to process next operand byte(s) (frame[0] and [1] are skipped)
+
   /**
    * The plain 'operand types' are uint8.
    * Further uint32 'operand type' values are used to encode a sequence of upto 4 (potentially different) operands
@@ -128,18 +235,12 @@ class Decoder {
   }
 
   /**
-   * Helper function to implement the 'do_operand' methods
+   * Helper functions to implement 'format_operand'
    */
-  bool append_operand(const char *word, uint8_t offset_incr = 1);
-
-  template<uint32_t N_STRINGS> bool append_operand(const std::array<const char *, N_STRINGS> &strings) {
-    if (offset_ >= frame_.size()) {
-      return append_operand("?");
-    }
-    uint32_t operand_value = frame_[offset_];
-    const char *s = (operand_value < N_STRINGS) ? strings[operand_value] : nullptr;
-    return append_operand(s ? s : "?");  // null-guard: nullptr entry in array -> "?"
-  }
+  void append_operand(const char *word);
+
+  template<uint32_t N_STRINGS>
+  void append_operand(const std::array<const char *, N_STRINGS> &strings, const DecodedOperand &operand);
 
   /**
    * String tables used in the subsequent 'do_operand' decode functions
@@ -147,7 +248,81 @@ class Decoder {
   const static std::array<const char *, 0x77> UI_Commands;
   const static std::array<const char *, 0x11> audio_formats;
   const static std::array<const char *, 8> audio_samplerates;
-  const static std::map<uint32_t, const char *> vendor_ids;
+  struct VendorName {
+    uint32_t id;
+    const char *name;
+  };
+  const static VendorName vendor_ids[];  // sorted by id
+  const static size_t vendor_ids_size;
+  static const char *find_vendor_name(uint32_t id);
+
+  friend struct DecodedMessage;
+
+ public:
+  // compile-time checks on the tables
+  static constexpr bool has_unique_opcodes();
+  static constexpr bool has_sorted_vendor_ids();
 };  // class Decoder
+
+struct DecodedOperand {
+  Decoder::Operand type;
+  uint8_t offset;  // position of its first byte in the frame
+  uint8_t size;    // number of bytes, 0 if the frame ends before the operand
+  uint32_t value;  // the bytes as a big endian number (the first 4 for longer operands)
+
+  bool is_present() const { return size > 0; }
+};
+
+/**
+ * A frame split into its opcode and typed operands, see Decoder::decode(). It takes no heap memory, so it can
+ * be passed around by value: one decode serves the log, the triggers and the device cache.
+ */
+struct DecodedMessage {
+  // an operand takes at least one byte, except for an empty one ('None')
+  constexpr static size_t MAX_OPERANDS = Frame::MAX_LENGTH - 1;
+
+  Frame frame;
+  const char *name = nullptr;  // name of the opcode, nullptr for pings and unknown opcodes; "" without decode_messages
+  uint8_t num_operands = 0;
+  std::array<DecodedOperand, MAX_OPERANDS> operands{};
+
+  DecodedMessage() = default;
+  explicit DecodedMessage(const Frame &frame) { Decoder(frame).decode(*this); }
+
+  uint8_t initiator() const { return frame.initiator_addr(); }
+  uint8_t destination() const { return frame.destination_addr(); }
+  bool is_ping() const { return frame.size() <= 1; }
+  bool is_known() const { return name != nullptr; }
+  Opcode opcode() const { return static_cast<Opcode>(frame.opcode()); }
+
+  // The 'index'-th operand of 'type' that is present in the frame, or nullptr
+  const DecodedOperand *find(Decoder::Operand type, size_t index = 0) const;
+  optional<uint32_t> value(Decoder::Operand type, size_t index = 0) const {
+    const DecodedOperand *operand = find(type, index);
+    return (operand == nullptr) ? optional<uint32_t>() : optional<uint32_t>(operand->value);
+  }
+
+  // "Active Source", "Report Physical Address", ...; "Routing Change": 0 the original address, 1 the new one
+  optional<uint16_t> physical_address(size_t index = 0) const;
+  optional<uint8_t> device_type() const;
+  optional<uint32_t> vendor_id() const;
+  // "User Control Pressed"
+  optional<uint8_t> ui_command() const;
+  optional<uint8_t> power_status() const;
+  optional<uint8_t> cec_version() const;
+  // "Report Audio Status": volume 0..100 (0x7F: unknown), and mute
+  optional<uint8_t> volume() const;
+  optional<bool> muted() const;
+  // "Feature Abort": the refused opcode, and the reason
+  optional<uint8_t> feature_opcode() const;
+  optional<uint8_t> abort_reason() const;
+  // "Set OSD Name", "Set OSD String": the text, null-terminated and truncated to fit. @return its length
+  size_t osd_text(char *buffer, size_t size) const;
+
+  // Text of the message, as in the log (without the frame bytes), see Decoder; the frame bytes without decode_messages
+  size_t format(char *buffer, size_t size) const { return Decoder(frame).format(*this, buffer, size); }
+  std::string to_string() const;
+};
+
 }  // namespace hdmi_cec
 }  // namespace esphome
@@ -0,0 +1,152 @@
+#include "cec_device_cache.h"
+
+namespace esphome {
+namespace hdmi_cec {
+
+bool DeviceCache::learns_from(const Frame &frame) {
+  if (frame.size() < 2) {
+    return false;
+  }
+  switch (static_cast<Opcode>(frame.opcode())) {
+    case Opcode::ReportPhysicalAddress:
+    case Opcode::DeviceVendorId:
+    case Opcode::SetOsdName:
+    case Opcode::ReportPowerStatus:
+    case Opcode::CecVersion:
+    case Opcode::ActiveSource:
+    case Opcode::InactiveSource:
+    case Opcode::RoutingChange:
+    case Opcode::RoutingInformation:
+    case Opcode::SetStreamPath:
+      return true;
+    default:
+      return false;
+  }
+}
+
+void DeviceCache::saw_(const Frame &frame, uint32_t now_ms) {
+  if (!frame.empty() && frame.initiator_addr() != 0xF) {
+    devices_[frame.initiator_addr()].seen.set(true, now_ms);
+  }
+}
+
+void DeviceCache::update(const Frame &frame, uint32_t now_ms) {
+  if (learns_from(frame)) {
+    update(DecodedMessage(frame), now_ms);
+  } else {
+    saw_(frame, now_ms);
+  }
+}
+
+void DeviceCache::update(const DecodedMessage &message, uint32_t now_ms) {
+  saw_(message.frame, now_ms);
+  if (!learns_from(message.frame)) {
+    return;
+  }
+  const uint8_t source = message.initiator();
+  DeviceInfo &device = devices_[source];
+
+  switch (message.opcode()) {
+    case Opcode::ReportPhysicalAddress: {
+      auto physical_address = message.physical_address();
+      auto device_type = message.device_type();
+      if (physical_address.has_value() && device_type.has_value()) {
+        device.physical_address.set(*physical_address, now_ms);
+        device.device_type.set(*device_type, now_ms);
+      }
+      break;
+    }
+
+    case Opcode::DeviceVendorId: {
+      auto vendor_id = message.vendor_id();
+      if (vendor_id.has_value()) {
+        device.vendor_id.set(*vendor_id, now_ms);
+      }
+      break;
+    }
+
+    case Opcode::SetOsdName: {
+      OsdName name{};
+      message.osd_text(name.data(), name.size());
+      device.osd_name.set(name, now_ms);
+      break;
+    }
+
+    case Opcode::ReportPowerStatus: {
+      auto power_status = message.power_status();
+      if (power_status.has_value()) {
+        device.power_status.set(*power_status, now_ms);
+      }
+      break;
+    }
+
+    case Opcode::CecVersion: {
+      auto cec_version = message.cec_version();
+      if (cec_version.has_value()) {
+        device.cec_version.set(*cec_version, now_ms);
+      }
+      break;
+    }
+
+    case Opcode::ActiveSource: {
+      auto physical_address = message.physical_address();
+      if (physical_address.has_value()) {
+        active_source_.set(*physical_address, now_ms);
+        active_source_address_ = source;
+        device.physical_address.set(*physical_address, now_ms);
+      }
+      break;
+    }
+
+    case Opcode::InactiveSource:
+      if (active_source_.known && active_source_address_ == source) {
+        active_source_.forget();
+        active_source_address_ = 0xF;
+      }
+      break;
+
+    // original address, new address
+    case Opcode::RoutingChange: {
+      auto new_address = message.physical_address(1);
+      if (new_address.has_value()) {
+        active_route_.set(*new_address, now_ms);
+      }
+      break;
+    }
+
+    case Opcode::RoutingInformation:
+    case Opcode::SetStreamPath: {
+      auto physical_address = message.physical_address();
+      if (physical_address.has_value()) {
+        active_route_.set(*physical_address, now_ms);
+      }
+      break;
+    }
+
+    default:
+      break;
+  }
+}
+
+bool DeviceCache::is_fresh(uint8_t logical_address, CacheField field, uint32_t now_ms, uint32_t max_age_ms) const {
+  const DeviceInfo &info = device(logical_address);
+  switch (field) {
+    case CacheField::PhysicalAddress:
+      return info.physical_address.is_fresh(now_ms, max_age_ms);
+    case CacheField::VendorId:
+      return info.vendor_id.is_fresh(now_ms, max_age_ms);
+    case CacheField::OsdName:
+      return info.osd_name.is_fresh(now_ms, max_age_ms);
+    case CacheField::PowerStatus:
+      return info.power_status.is_fresh(now_ms, max_age_ms);
+    case CacheField::CecVersion:
+      return info.cec_version.is_fresh(now_ms, max_age_ms);
+    case CacheField::ActiveSource:
+      return active_source_.is_fresh(now_ms, max_age_ms);
+    default:
+      return false;
+  }
+}
+
+}  // namespace hdmi_cec
+}  // namespace esphome
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "cec_decoder.h"
+#include "cec_frame.h"
+
+namespace esphome {
+namespace hdmi_cec {
+
+/**
+ * A value learned from the bus, and when it was last reported.
+ * Times are in 'millis()' units, passed in by the caller.
+ */
+template<typename T> struct CachedValue {
+  T value{};
+  bool known = false;
+  uint32_t updated_ms = 0;
+
+  void set(const T &new_value, uint32_t now_ms) {
+    value = new_value;
+    known = true;
+    updated_ms = now_ms;
+  }
+  void forget() { known = false; }
+  uint32_t age_ms(uint32_t now_ms) const { return now_ms - updated_ms; }
+  bool is_fresh(uint32_t now_ms, uint32_t max_age_ms) const { return known && age_ms(now_ms) <= max_age_ms; }
+};
+
+// OSD name of up to 14 characters, null-terminated
+using OsdName = std::array<char, 15>;
+
+// What the cache knows about the device at one logical address
+struct DeviceInfo {
+  CachedValue<uint16_t> physical_address;  // "Report Physical Address", "Active Source"
+  CachedValue<uint8_t> device_type;        // "Report Physical Address"
+  CachedValue<uint32_t> vendor_id;         // "Device Vendor ID", 24 bits
+  CachedValue<OsdName> osd_name;           // "Set OSD Name"
+  CachedValue<uint8_t> power_status;       // "Report Power Status": 0 on, 1 standby, 2 turning on, 3 turning off
+  CachedValue<uint8_t> cec_version;        // "CEC Version"
+  CachedValue<bool> seen;                  // any frame sent by this device, pings included
+};
+
+// The cached values that can be refreshed with a query, see HDMICEC::refresh_cached()
+enum class CacheField : uint8_t {
+  PhysicalAddress = 0,
+  VendorId = 1,
+  OsdName = 2,
+  PowerStatus = 3,
+  CecVersion = 4,
+  ActiveSource = 5,
+};
+
+/**
+ * Passive picture of the bus, built from the state reports devices send anyway: each frame is looked at,
+ * whoever it is addressed to. This way, state can be read right away instead of querying it (and waiting
+ * for the reply) on a slow bus. Every value carries its age, so callers decide what is recent enough.
+ */
+class DeviceCache {
+ public:
+  // Learn from a frame seen on the bus, at time 'now_ms'. Only the frames 'learns_from()' are decoded
+  void update(const Frame &frame, uint32_t now_ms);
+  // Same, with the frame already decoded
+  void update(const DecodedMessage &message, uint32_t now_ms);
+  // Whether the frame carries a value the cache keeps; for the others, the cache only notes the initiator was seen
+  static bool learns_from(const Frame &frame);
+
+  const DeviceInfo &device(uint8_t logical_address) const { return devices_[logical_address & 0xF]; }
+  // physical address of the current active source ("Active Source"), and its logical address
+  const CachedValue<uint16_t> &active_source() const { return active_source_; }
+  uint8_t active_source_address() const { return active_source_address_; }
+  // physical address the switches route to ("Routing Change", "Routing Information", "Set Stream Path")
+  const CachedValue<uint16_t> &active_route() const { return active_route_; }
+  // whether 'field' of a device is known, and at most 'max_age_ms' old
+  bool is_fresh(uint8_t logical_address, CacheField field, uint32_t now_ms, uint32_t max_age_ms) const;
+
+  // last query for 'field' of a device, to not repeat it while the reply is on its way
+  CachedValue<bool> &query(uint8_t logical_address, CacheField field) {
+    return queries_[logical_address & 0xF][(size_t) field];
+  }
+
+ protected:
+  constexpr static size_t NUM_FIELDS = 6;
+
+  void saw_(const Frame &frame, uint32_t now_ms);
+
+  std::array<DeviceInfo, 16> devices_{};
+  CachedValue<uint16_t> active_source_;
+  uint8_t active_source_address_ = 0xF;
+  CachedValue<uint16_t> active_route_;
+  std::array<std::array<CachedValue<bool>, NUM_FIELDS>, 16> queries_{};
+};
+
+}  // namespace hdmi_cec
+}  // namespace esphome
@@ -0,0 +1,28 @@
+#include "cec_edge_trace.h"
+
+namespace esphome {
+namespace hdmi_cec {
+
+size_t EdgeTrace::serialize(size_t offset, uint8_t *buffer, size_t size) const {
+  const size_t total = serialized_size();
+  if (size_ == 0) {
+    return 0;
+  }
+  const size_t oldest = (next_ + size_ - count_) % size_;
+  size_t length = 0;
+  for (; length < size && offset + length < total; length++) {
+    size_t position = offset + length;
+    if (position < sizeof(edge_trace::MAGIC)) {
+      buffer[length] = edge_trace::MAGIC[position];
+      continue;
+    }
+    uint32_t word = (position < edge_trace::HEADER_SIZE)
+                        ? (uint32_t) count_
+                        : records_[(oldest + (position - edge_trace::HEADER_SIZE) / 4) % size_];
+    buffer[length] = (word >> (8 * (position % 4))) & 0xFF;
+  }
+  return length;
+}
+
+}  // namespace hdmi_cec
+}  // namespace esphome
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include "esphome/core/defines.h"
+#include "esphome/core/hal.h"
+#include "cec_receiver.h"
+
+namespace esphome {
+namespace hdmi_cec {
+
+/**
+ * Binary edge trace format, all words little endian:
+ *  - 4 bytes magic "CET1"
+ *  - uint32 number of records
+ *  - one uint32 record per edge, oldest first:
+ *    bits 0..29: timestamp in microseconds, modulo 2^30 (about 17 minutes)
+ *    bit 30: line level after the edge
+ *    bit 31: the edge was caused by our own transmission (ignored by the receiver)
+ */
+namespace edge_trace {
+constexpr static uint8_t MAGIC[4] = {'C', 'E', 'T', '1'};
+constexpr static size_t HEADER_SIZE = 8;
+constexpr static uint32_t TIME_MASK = (1UL << 30) - 1;
+constexpr static uint32_t LEVEL_BIT = 1UL << 30;
+constexpr static uint32_t OWN_BIT = 1UL << 31;
+}  // namespace edge_trace
+
+/**
+ * Ring of the most recent edges seen by the GPIO interrupt handler, to reproduce receive problems offline.
+ * It records nothing until it is allocated, with the 'edge_trace_size' of its bus.
+ * Recording is paused while the trace is written out.
+ */
+class EdgeTrace {
+ public:
+  // keep the 'size' most recent edges, from now on
+  void allocate(size_t size) {
+    records_.reset(new uint32_t[size]());  // NOLINT(cppcoreguidelines-owning-memory)
+    size_ = size;
+    clear();
+  }
+  bool is_enabled() const { return size_ != 0; }
+
+  void IRAM_ATTR record(uint32_t now_us, bool level, bool own) {
+    if (paused_ || size_ == 0) {
+      return;
+    }
+    records_[next_] = (now_us & edge_trace::TIME_MASK) | (level ? edge_trace::LEVEL_BIT : 0) |
+                      (own ? edge_trace::OWN_BIT : 0);
+    next_ = (next_ + 1) % size_;
+    if (count_ < size_) {
+      count_ = count_ + 1;
+    }
+  }
+  void set_paused(bool paused) { paused_ = paused; }
+  size_t size() const { return size_; }
+  size_t count() const { return count_; }
+  // size of the whole trace in the binary format
+  size_t serialized_size() const { return edge_trace::HEADER_SIZE + 4 * count_; }
+  /**
+   * Write the binary trace, starting at byte 'offset' of it, into 'buffer'.
+   * Recording must be paused meanwhile, to get a consistent trace.
+   * @return the number of bytes written
+   */
+  size_t serialize(size_t offset, uint8_t *buffer, size_t size) const;
+  void clear() {
+    count_ = 0;
+    next_ = 0;
+  }
+
+ protected:
+  std::unique_ptr<uint32_t[]> records_;
+  size_t size_{0};
+  volatile size_t next_{0};
+  volatile size_t count_{0};
+  volatile bool paused_{false};
+};
+
+/**
+ * Play a binary edge trace back through 'receiver', like the GPIO interrupt handler does, as fast as possible.
+ * Every event other than None is passed to 'on_event(Event)'.
+ * @return the number of edges replayed, or -1 if 'data' is not an edge trace
+ */
+template<typename F> int replay_edge_trace(const uint8_t *data, size_t size, Receiver &receiver, F &&on_event) {
+  if (size < edge_trace::HEADER_SIZE || std::memcmp(data, edge_trace::MAGIC, sizeof(edge_trace::MAGIC)) != 0) {
+    return -1;
+  }
+  auto read_word = [data](size_t offset) {
+    return (uint32_t) data[offset] | ((uint32_t) data[offset + 1] << 8) | ((uint32_t) data[offset + 2] << 16) |
+           ((uint32_t) data[offset + 3] << 24);
+  };
+  size_t count = read_word(4);
+  if (count > (size - edge_trace::HEADER_SIZE) / 4) {
+    return -1;
+  }
+  // rebuild a continuous clock from the truncated timestamps
+  uint32_t clock_us = 0;
+  uint32_t last_us = 0;
+  for (size_t i = 0; i < count; i++) {
+    uint32_t record = read_word(edge_trace::HEADER_SIZE + 4 * i);
+    uint32_t time_us = record & edge_trace::TIME_MASK;
+    if (i > 0) {
+      clock_us += (time_us - last_us) & edge_trace::TIME_MASK;
+    }
+    last_us = time_us;
+    if (record & edge_trace::OWN_BIT) {
+      // our own frame on the bus: not to be received
+      continue;
+    }
+    Receiver::Event event = receiver.on_edge((record & edge_trace::LEVEL_BIT) != 0, clock_us);
+    if (event != Receiver::Event::None) {
+      on_event(event);
+    }
+  }
+  return (int) count;
+}
+
+}  // namespace hdmi_cec
+}  // namespace esphome
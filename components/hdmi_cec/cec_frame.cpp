@@ -0,0 +1,39 @@
+#include <cstdio>
+
+#include "esphome/core/defines.h"
+#include "cec_frame.h"
+
+#ifdef USE_CEC_DECODER
+#include "cec_decoder.h"
+#endif
+
+namespace esphome {
+namespace hdmi_cec {
+
+size_t Frame::format(char *buffer, size_t size, bool skip_decode) const {
+  if (size == 0) {
+    return 0;
+  }
+  buffer[0] = '\0';
+  size_t length = 0;
+  for (size_t i = 0; i < this->size() && (length + 3) < size; i++) {
+    length += snprintf(buffer + length, size - length, (i == 0) ? "%02X" : ":%02X", (*this)[i]);
+  }
+#ifdef USE_CEC_DECODER
+  if (!skip_decode && (length + 4) < size) {
+    length += snprintf(buffer + length, size - length, " => ");
+    Decoder decoder(*this);
+    length += decoder.decode(buffer + length, size - length);
+  }
+#endif
+  return length;
+}
+
+std::string Frame::to_string(bool skip_decode) const {
+  char buffer[MAX_TEXT_LENGTH];
+  format(buffer, sizeof(buffer), skip_decode);
+  return std::string(buffer);
+}
+
+}  // namespace hdmi_cec
+}  // namespace esphome
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace esphome {
+namespace hdmi_cec {
+
+/**
+ * Byte sequence of a fixed maximum size, stored inline. It offers the parts of the std::vector interface that
+ * are used on CEC frames, but it is trivially copyable: copying it never allocates memory.
+ * Bytes beyond the capacity are dropped.
+ */
+template<size_t CAPACITY> class ByteSequence {
+ public:
+  constexpr ByteSequence() = default;
+  constexpr ByteSequence(const uint8_t *data, size_t length) { assign(data, length); }
+  constexpr ByteSequence(std::initializer_list<uint8_t> data) { assign(data.begin(), data.size()); }
+  ByteSequence(const std::vector<uint8_t> &data) { assign(data.data(), data.size()); }
+
+  constexpr void assign(const uint8_t *data, size_t length) {
+    size_ = (uint8_t) std::min(length, CAPACITY);
+    // a plain loop rather than memcpy, so sequences can be built at compile time
+    for (size_t i = 0; i < size_; i++) {
+      bytes_[i] = data[i];
+    }
+  }
+  constexpr bool push_back(uint8_t value) {
+    if (size_ >= CAPACITY) return false;
+    bytes_[size_++] = value;
+    return true;
+  }
+  constexpr void clear() { size_ = 0; }
+
+  constexpr size_t size() const { return size_; }
+  constexpr bool empty() const { return size_ == 0; }
+  constexpr static size_t capacity() { return CAPACITY; }
+  constexpr uint8_t *data() { return bytes_.data(); }
+  constexpr const uint8_t *data() const { return bytes_.data(); }
+  constexpr const uint8_t *begin() const { return bytes_.data(); }
+  constexpr const uint8_t *end() const { return bytes_.data() + size_; }
+  constexpr const uint8_t *cbegin() const { return begin(); }
+  constexpr const uint8_t *cend() const { return end(); }
+  constexpr uint8_t front() const { return bytes_[0]; }
+  constexpr uint8_t back() const { return bytes_[size_ - 1]; }
+  constexpr uint8_t operator[](size_t i) const { return bytes_[i]; }
+  constexpr uint8_t &operator[](size_t i) { return bytes_[i]; }
+  constexpr uint8_t at(size_t i) const { return (i < size_) ? bytes_[i] : 0; }
+
+  constexpr bool operator==(const ByteSequence &other) const {
+    if (size_ != other.size_) return false;
+    for (size_t i = 0; i < size_; i++) {
+      if (bytes_[i] != other.bytes_[i]) return false;
+    }
+    return true;
+  }
+  constexpr bool operator!=(const ByteSequence &other) const { return !(*this == other); }
+
+  // copy to a std::vector, for code written against the former std::vector based interface
+  std::vector<uint8_t> to_vector() const { return std::vector<uint8_t>(begin(), end()); }
+  operator std::vector<uint8_t>() const { return to_vector(); }
+
+ protected:
+  std::array<uint8_t, CAPACITY> bytes_{};
+  uint8_t size_{0};
+};
+
+// The data of a CEC message: opcode and operands, without the header byte
+using Payload = ByteSequence<15>;
+
+class Frame : public ByteSequence<16> {
+ public:
+  constexpr Frame() = default;
+  constexpr Frame(const uint8_t *data, size_t length) : ByteSequence<16>(data, length) {}
+  constexpr Frame(uint8_t initiator_addr, uint8_t target_addr, const uint8_t *payload, size_t length) {
+    this->push_back(((initiator_addr & 0xf) << 4) | (target_addr & 0xf));
+    length = std::min(length, capacity() - 1);
+    for (size_t i = 0; i < length; i++) {
+      this->push_back(payload[i]);
+    }
+  }
+  constexpr Frame(uint8_t initiator_addr, uint8_t target_addr, const Payload &payload)
+      : Frame(initiator_addr, target_addr, payload.data(), payload.size()) {}
+  Frame(uint8_t initiator_addr, uint8_t target_addr, const std::vector<uint8_t> &payload)
+      : Frame(initiator_addr, target_addr, payload.data(), payload.size()) {}
+  constexpr uint8_t initiator_addr() const { return (this->at(0) >> 4) & 0xf; }
+  constexpr uint8_t destination_addr() const { return this->at(0) & 0xf; }
+  constexpr uint8_t opcode() const { return (this->size() >= 2) ? this->at(1) : 0; }
+  constexpr bool is_broadcast() const { return this->destination_addr() == 0xf; }
+  constexpr Payload payload() const {
+    return this->empty() ? Payload() : Payload(this->data() + 1, this->size() - 1);
+  }
+  /**
+   * Write the frame bytes in hex, followed by the decoded message (if enabled), into 'buffer'.
+   * The text is truncated to fit, and always null-terminated.
+   * @return the length of the text
+   */
+  size_t format(char *buffer, size_t size, bool skip_decode = false) const;
+  std::string to_string(bool skip_decode = 0) const;
+  constexpr static int MAX_LENGTH = 16;  // from HDMI CEC standard 1.4
+  constexpr static size_t MAX_TEXT_LENGTH = 320;  // buffer size that fits any formatted frame
+};
+static_assert(std::is_trivially_copyable<Frame>::value, "Frame must be copyable without allocation");
+
+}  // namespace hdmi_cec
+}  // namespace esphome
@@ -0,0 +1,62 @@
+#include "cec_key_tracker.h"
+
+namespace esphome {
+namespace hdmi_cec {
+
+KeyEvent KeyTracker::release_(uint8_t source, uint32_t held_ms) {
+  KeyState &state = states_[source];
+  state.pressed = false;
+  return {KeyEvent::Type::Release, source, state.key, state.repeat_count, held_ms};
+}
+
+size_t KeyTracker::on_message(uint8_t source, const Payload &data, uint32_t now_ms, KeyEvent *events) {
+  source &= 0xF;
+  KeyState &state = states_[source];
+  size_t count = 0;
+
+  // "User Control Released"
+  if (data[0] == 0x45) {
+    if (state.pressed) {
+      events[count++] = release_(source, now_ms - state.pressed_ms);
+    }
+    return count;
+  }
+
+  // "User Control Pressed"
+  const uint8_t key = data[1];
+  if (state.pressed && state.key == key) {
+    state.repeat_count++;
+    state.last_repeat_ms = now_ms;
+    if (now_ms - state.last_hold_ms >= hold_interval_ms_) {
+      state.last_hold_ms = now_ms;
+      events[count++] = {KeyEvent::Type::Hold, source, key, state.repeat_count, now_ms - state.pressed_ms};
+    }
+    return count;
+  }
+  if (state.pressed) {
+    // another key without a release in between
+    events[count++] = release_(source, now_ms - state.pressed_ms);
+  }
+  state.pressed = true;
+  state.key = key;
+  state.repeat_count = 0;
+  state.pressed_ms = now_ms;
+  state.last_repeat_ms = now_ms;
+  state.last_hold_ms = now_ms;
+  events[count++] = {KeyEvent::Type::Press, source, key, 0, 0};
+  return count;
+}
+
+size_t KeyTracker::expire(uint32_t now_ms, KeyEvent *events, size_t max_events) {
+  size_t count = 0;
+  for (uint8_t source = 0; source < states_.size() && count < max_events; source++) {
+    const KeyState &state = states_[source];
+    if (state.pressed && now_ms - state.last_repeat_ms > release_timeout_ms_) {
+      events[count++] = release_(source, state.last_repeat_ms - state.pressed_ms);
+    }
+  }
+  return count;
+}
+
+}  // namespace hdmi_cec
+}  // namespace esphome
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "cec_frame.h"
+
+namespace esphome {
+namespace hdmi_cec {
+
+struct KeyEvent {
+  enum class Type : uint8_t {
+    Press = 0,    // first "User Control Pressed" of a key
+    Hold = 1,     // the key is still pressed: repeated "User Control Pressed", throttled
+    Release = 2,  // "User Control Released", another key pressed, or no repeat in time
+  };
+  Type type;
+  uint8_t source;
+  uint8_t key;            // UI command
+  uint32_t repeat_count;  // repeated "User Control Pressed" since the press
+  uint32_t held_ms;       // time since the press (for a timed out release: until the last repeat)
+};
+
+/**
+ * Turns the raw "User Control Pressed" (0x44) / "User Control Released" (0x45) stream of each initiator into
+ * press, hold and release events. While a remote button is held, the initiator repeats "User Control Pressed"
+ * every 200 to 500 ms: hold events are emitted at most every 'hold_interval', however fast the repeats come.
+ * Times are in 'millis()' units, passed in by the caller.
+ */
+class KeyTracker {
+ public:
+  constexpr static size_t MAX_EVENTS = 2;  // most events resulting from a single message
+
+  void set_hold_interval(uint32_t hold_interval_ms) { hold_interval_ms_ = hold_interval_ms; }
+  // a key without repeat nor release for this long counts as released (HDMI CEC spec: 550 ms)
+  void set_release_timeout(uint32_t release_timeout_ms) { release_timeout_ms_ = release_timeout_ms; }
+
+  static bool is_key_message(const Payload &data) {
+    return (data.size() >= 2 && data[0] == 0x44) || (data.size() >= 1 && data[0] == 0x45);
+  }
+  // Process a key message from 'source'. Returns the number of events written to 'events' (MAX_EVENTS at most).
+  size_t on_message(uint8_t source, const Payload &data, uint32_t now_ms, KeyEvent *events);
+  // Release the keys whose repeats stopped. Returns the number of events written to 'events'.
+  size_t expire(uint32_t now_ms, KeyEvent *events, size_t max_events);
+  // whether a key is held, waiting for a repeat or a release
+  bool has_pressed_key() const {
+    for (const auto &state : states_) {
+      if (state.pressed) return true;
+    }
+    return false;
+  }
+
+ protected:
+  struct KeyState {
+    bool pressed = false;
+    uint8_t key = 0;
+    uint32_t repeat_count = 0;
+    uint32_t pressed_ms = 0;
+    uint32_t last_repeat_ms = 0;
+    uint32_t last_hold_ms = 0;
+  };
+
+  KeyEvent release_(uint8_t source, uint32_t held_ms);
+
+  uint32_t hold_interval_ms_ = 500;
+  uint32_t release_timeout_ms_ = 550;
+  std::array<KeyState, 16> states_{};
+};
+
+}  // namespace hdmi_cec
+}  // namespace esphome
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "cec_frame.h"
+
+namespace esphome {
+namespace hdmi_cec {
+
+/**
+ * Builders for the frames of common CEC messages. Each one takes exactly the operands of its message, so a
+ * frame can't be built with operands missing or left over. They are constexpr: with constant arguments, the
+ * frame is built at compile time, e.g.
+ *   static constexpr Frame POWER_ON = message::image_view_on(0x4, 0x0);
+ *   id(cec).send(message::user_control_pressed(id(cec).address(), 0x0, 0x6B));
+ * make_frame() builds any other message, its length is checked at compile time.
+ */
+namespace message {
+
+constexpr uint8_t BROADCAST = 0xF;
+
+// Frame with 'opcode' and the byte 'operands'
+template<typename... Operands>
+constexpr Frame make_frame(uint8_t initiator, uint8_t destination, uint8_t opcode, Operands... operands) {
+  static_assert(sizeof...(Operands) <= Frame::MAX_LENGTH - 2, "a CEC frame holds at most 14 operands");
+  const uint8_t data[] = {opcode, static_cast<uint8_t>(operands)...};
+  return Frame(initiator, destination, data, sizeof(data));
+}
+
+// Polling message: the header block alone, see the logical address allocation
+constexpr Frame poll(uint8_t initiator, uint8_t destination) { return Frame(initiator, destination, nullptr, 0); }
+
+constexpr Frame feature_abort(uint8_t initiator, uint8_t destination, uint8_t opcode, uint8_t reason) {
+  return make_frame(initiator, destination, 0x00, opcode, reason);
+}
+
+// One Touch Play
+constexpr Frame image_view_on(uint8_t initiator, uint8_t destination) {
+  return make_frame(initiator, destination, 0x04);
+}
+constexpr Frame text_view_on(uint8_t initiator, uint8_t destination) {
+  return make_frame(initiator, destination, 0x0D);
+}
+constexpr Frame active_source(uint8_t initiator, uint16_t physical_address) {
+  return make_frame(initiator, BROADCAST, 0x82, physical_address >> 8, physical_address & 0xFF);
+}
+constexpr Frame inactive_source(uint8_t initiator, uint16_t physical_address) {
+  return make_frame(initiator, 0x0, 0x9D, physical_address >> 8, physical_address & 0xFF);
+}
+constexpr Frame request_active_source(uint8_t initiator) { return make_frame(initiator, BROADCAST, 0x85); }
+
+// Routing Control
+constexpr Frame routing_change(uint8_t initiator, uint16_t original_address, uint16_t new_address) {
+  return make_frame(initiator, BROADCAST, 0x80, original_address >> 8, original_address & 0xFF, new_address >> 8,
+                    new_address & 0xFF);
+}
+constexpr Frame set_stream_path(uint8_t initiator, uint16_t physical_address) {
+  return make_frame(initiator, BROADCAST, 0x86, physical_address >> 8, physical_address & 0xFF);
+}
+
+// Standby
+constexpr Frame standby(uint8_t initiator, uint8_t destination) { return make_frame(initiator, destination, 0x36); }
+
+// System Information
+constexpr Frame give_physical_address(uint8_t initiator, uint8_t destination) {
+  return make_frame(initiator, destination, 0x83);
+}
+constexpr Frame report_physical_address(uint8_t initiator, uint16_t physical_address, uint8_t device_type) {
+  return make_frame(initiator, BROADCAST, 0x84, physical_address >> 8, physical_address & 0xFF, device_type);
+}
+constexpr Frame get_cec_version(uint8_t initiator, uint8_t destination) {
+  return make_frame(initiator, destination, 0x9F);
+}
+constexpr Frame cec_version(uint8_t initiator, uint8_t destination, uint8_t version) {
+  return make_frame(initiator, destination, 0x9E, version);
+}
+
+// Vendor Specific Commands
+constexpr Frame give_device_vendor_id(uint8_t initiator, uint8_t destination) {
+  return make_frame(initiator, destination, 0x8C);
+}
+constexpr Frame device_vendor_id(uint8_t initiator, uint32_t vendor_id) {
+  return make_frame(initiator, BROADCAST, 0x87, (vendor_id >> 16) & 0xFF, (vendor_id >> 8) & 0xFF,
+                    vendor_id & 0xFF);
+}
+
+// Device OSD Transfer
+constexpr Frame give_osd_name(uint8_t initiator, uint8_t destination) {
+  return make_frame(initiator, destination, 0x46);
+}
+// 'name' is cut to the 14 characters a frame holds
+constexpr Frame set_osd_name(uint8_t initiator, uint8_t destination, const uint8_t *name, size_t length) {
+  Frame frame = make_frame(initiator, destination, 0x47);
+  for (size_t i = 0; i < length; i++) {
+    if (!frame.push_back(name[i])) break;
+  }
+  return frame;
+}
+
+// Remote Control Passthrough
+constexpr Frame user_control_pressed(uint8_t initiator, uint8_t destination, uint8_t key) {
+  return make_frame(initiator, destination, 0x44, key);
+}
+constexpr Frame user_control_released(uint8_t initiator, uint8_t destination) {
+  return make_frame(initiator, destination, 0x45);
+}
+
+// Power Status
+constexpr Frame give_device_power_status(uint8_t initiator, uint8_t destination) {
+  return make_frame(initiator, destination, 0x8F);
+}
+constexpr Frame report_power_status(uint8_t initiator, uint8_t destination, uint8_t power_status) {
+  return make_frame(initiator, destination, 0x90, power_status);
+}
+
+// System Audio Control
+constexpr Frame system_audio_mode_request(uint8_t initiator, uint16_t physical_address) {
+  return make_frame(initiator, 0x5, 0x70, physical_address >> 8, physical_address & 0xFF);
+}
+constexpr Frame give_audio_status(uint8_t initiator) { return make_frame(initiator, 0x5, 0x71); }
+
+}  // namespace message
+
+}  // namespace hdmi_cec
+}  // namespace esphome
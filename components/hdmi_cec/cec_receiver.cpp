@@ -0,0 +1,96 @@
+#include "cec_receiver.h"
+
+namespace esphome {
+namespace hdmi_cec {
+
+void Receiver::reset() {
+  state_ = ReceiverState::Idle;
+  bit_counter_ = 0;
+  byte_buffer_ = 0;
+  ack_queued_ = false;
+  ack_bits_ = 0;
+  frame_.clear();
+}
+
+Receiver::Event IRAM_ATTR Receiver::on_edge(bool level, uint32_t now_us) {
+  if (level) {
+    // rising edge: time to process the pulse length
+    return on_pulse(now_us - last_falling_edge_us_);
+  }
+
+  // on falling edge, store current time as the start of the low pulse
+  last_falling_edge_us_ = now_us;
+  if (ack_queued_) {
+    ack_queued_ = false;
+    return Event::DriveAck;
+  }
+  return Event::None;
+}
+
+Receiver::Event IRAM_ATTR Receiver::on_pulse(uint32_t duration_us) {
+  if (duration_us > START_BIT_MIN_US) {
+    // start bit detected. reset everything and start receiving
+    bool restart = (state_ != ReceiverState::Idle);
+    bit_counter_ = 0;
+    byte_buffer_ = 0;
+    ack_queued_ = false;
+    ack_bits_ = 0;
+    frame_.clear();
+    state_ = ReceiverState::ReceivingByte;
+    return restart ? Event::FrameRestart : Event::FrameStart;
+  } else if (duration_us < (HIGH_BIT_MIN_US / 4)) {
+    // short glitch on the line: ignore
+    return Event::Glitch;
+  }
+
+  bool value = (duration_us >= HIGH_BIT_MIN_US && duration_us <= HIGH_BIT_MAX_US);
+
+  switch (state_) {
+    case ReceiverState::ReceivingByte: {
+      // write bit to the current byte
+      byte_buffer_ = (byte_buffer_ << 1) | (value & 0b1);
+      bit_counter_++;
+      if (bit_counter_ >= 8) {
+        // if we reached eight bits, push the current byte to the frame
+        frame_.push_back(byte_buffer_);  // bytes beyond the maximum length are dropped
+        bit_counter_ = 0;
+        byte_buffer_ = 0;
+        state_ = ReceiverState::WaitingForEOM;
+      }
+      return Event::None;
+    }
+
+    case ReceiverState::WaitingForEOM: {
+      // check if we need to acknowledge this byte on the next bit
+      uint8_t destination_address = frame_.empty() ? 0xF : (frame_.front() & 0x0F);
+      if (ack_enabled_ && destination_address != 0xF &&
+          (destination_address == address_ || ((ack_mask_ >> destination_address) & 1))) {
+        ack_queued_ = true;
+      }
+
+      bool is_eom = value;
+      state_ = is_eom ? ReceiverState::WaitingForEOMAck : ReceiverState::WaitingForAck;
+      return Event::None;
+    }
+
+    case ReceiverState::WaitingForAck: {
+      record_ack_bit_(value);
+      state_ = ReceiverState::ReceivingByte;
+      return Event::None;
+    }
+
+    case ReceiverState::WaitingForEOMAck: {
+      // the frame is complete once its last ACK bit is known
+      record_ack_bit_(value);
+      state_ = ReceiverState::Idle;
+      return frame_.empty() ? Event::None : Event::FrameComplete;
+    }
+
+    default: {
+      return Event::None;
+    }
+  }
+}
+
+}  // namespace hdmi_cec
+}  // namespace esphome
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "esphome/core/hal.h"
+#include "cec_frame.h"
+
+namespace esphome {
+namespace hdmi_cec {
+
+// receiver pulse classification (all values in microseconds)
+static constexpr uint32_t START_BIT_MIN_US = 3500;
+static constexpr uint32_t HIGH_BIT_MIN_US = 400;
+static constexpr uint32_t HIGH_BIT_MAX_US = 800;
+
+/**
+ * A period of constant level on the CEC line, as captured by an edge-capture backend
+ * (e.g. one half of an ESP32 RMT symbol, or an entry of a recorded trace).
+ */
+struct LinePeriod {
+  bool level;
+  uint32_t duration_us;
+};
+
+enum class ReceiverState : uint8_t {
+  Idle = 0,
+  ReceivingByte = 2,
+  WaitingForEOM = 3,
+  WaitingForAck = 4,
+  WaitingForEOMAck = 5,
+};
+
+/**
+ * The Receiver is the state machine that turns the edges seen on the CEC line into frames.
+ * Like the Transmitter, it has no knowledge of pins or clocks: the owner feeds it every edge of
+ * another initiator with its level and time, and acts on the returned event. So the protocol logic
+ * is the same whether the edges come from a GPIO interrupt or from a virtual bus with a simulated clock.
+ */
+class Receiver {
+ public:
+  enum class Event : uint8_t {
+    None = 0,
+    FrameStart = 1,     // start bit received
+    FrameRestart = 2,   // start bit received in the middle of a frame: the partial frame is discarded
+    DriveAck = 3,       // falling edge of an ACK bit that we must acknowledge: hold the line low for a '0'
+    FrameComplete = 4,  // ACK bit after EOM received: 'frame()' holds the complete frame until the next start bit
+    Glitch = 5,         // low pulse too short to be a bit: ignored
+  };
+
+  void set_address(uint8_t address) { address_ = address; }
+  // more logical addresses to acknowledge frames for, besides our own (bit N: address N), e.g. as a bridge
+  void set_ack_mask(uint16_t ack_mask) { ack_mask_ = ack_mask; }
+  // without acknowledging, the receiver only listens (monitor mode)
+  void set_ack_enabled(bool ack_enabled) { ack_enabled_ = ack_enabled; }
+
+  // Process a level change of the CEC line at time 'now_us'. Levels must alternate.
+  Event on_edge(bool level, uint32_t now_us);
+  // Process the rising edge that ends a low pulse of 'duration_us'
+  Event on_pulse(uint32_t duration_us);
+  /**
+   * Process a batch of captured line periods, and pass every resulting event to 'on_event(Event)'.
+   * A batch is decoded after the fact, so the frames in it cannot be acknowledged: there is no DriveAck event.
+   */
+  template<typename F> void on_periods(const LinePeriod *periods, size_t count, F &&on_event) {
+    for (size_t i = 0; i < count; i++) {
+      if (periods[i].level) {
+        // only the low pulses carry information, the high periods fill up the bit periods
+        continue;
+      }
+      Event event = on_pulse(periods[i].duration_us);
+      if (event != Event::None) {
+        on_event(event);
+      }
+    }
+  }
+
+  const Frame &frame() const { return frame_; }
+  // ACK bits of the current frame, bit i set if the ACK bit of byte i was read as '0' (driven low)
+  uint16_t ack_bits() const { return ack_bits_; }
+  ReceiverState state() const { return state_; }
+  void reset();
+
+ protected:
+  void record_ack_bit_(bool value) {
+    if (!value && !frame_.empty()) {
+      ack_bits_ |= 1 << (frame_.size() - 1);
+    }
+  }
+
+  uint8_t address_{0xF};
+  uint16_t ack_mask_{0};
+  bool ack_enabled_{true};
+
+  ReceiverState state_{ReceiverState::Idle};
+  uint32_t last_falling_edge_us_{0};
+  uint8_t bit_counter_{0};
+  uint8_t byte_buffer_{0};
+  bool ack_queued_{false};
+  uint16_t ack_bits_{0};
+  Frame frame_;
+};
+
+}  // namespace hdmi_cec
+}  // namespace esphome
@@ -0,0 +1,108 @@
+#include "cec_rmt_capture.h"
+
+#ifdef USE_HDMI_CEC_RMT
+
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace hdmi_cec {
+
+static const char *const TAG = "hdmi_cec.rmt";
+
+// pulses shorter than this are filtered by the hardware (the filter range is limited to a few microseconds)
+static const uint32_t GLITCH_FILTER_NS = 3000;
+// a capture ends once the line level did not change for this long: longer than any period within a frame
+// (3.7 ms start bit), shorter than the signal free time between frames (at least 3 bit periods, 7.2 ms)
+static const uint32_t IDLE_THRESHOLD_NS = 5000000;
+
+bool RmtCapture::setup(int gpio_num) {
+  rmt_rx_channel_config_t channel_config = {};
+  channel_config.gpio_num = (gpio_num_t) gpio_num;
+  channel_config.clk_src = RMT_CLK_SRC_DEFAULT;
+  channel_config.resolution_hz = 1000000;  // 1 tick = 1 us
+#if SOC_RMT_SUPPORT_DMA
+  channel_config.mem_block_symbols = MAX_SYMBOLS;
+  channel_config.flags.with_dma = true;
+#else
+  // without DMA, a capture is limited by the channel memory: long frames may be truncated on small chips
+  channel_config.mem_block_symbols = std::min<size_t>(
+      MAX_SYMBOLS, SOC_RMT_MEM_WORDS_PER_CHANNEL * SOC_RMT_RX_CANDIDATES_PER_GROUP);
+#endif
+  esp_err_t err = rmt_new_rx_channel(&channel_config, &channel_);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "rmt_new_rx_channel failed: %s", esp_err_to_name(err));
+    return false;
+  }
+
+  rmt_rx_event_callbacks_t callbacks = {};
+  callbacks.on_recv_done = RmtCapture::on_recv_done_;
+  err = rmt_rx_register_event_callbacks(channel_, &callbacks, this);
+  if (err == ESP_OK) {
+    err = rmt_enable(channel_);
+  }
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "RMT channel setup failed: %s", esp_err_to_name(err));
+    return false;
+  }
+
+  receive_config_.signal_range_min_ns = GLITCH_FILTER_NS;
+  receive_config_.signal_range_max_ns = IDLE_THRESHOLD_NS;
+  receiving_ = 0;
+  return start_receive_(0);
+}
+
+bool IRAM_ATTR RmtCapture::start_receive_(size_t buffer) {
+  return rmt_receive(channel_, symbols_[buffer], sizeof(symbols_[buffer]), &receive_config_) == ESP_OK;
+}
+
+bool IRAM_ATTR RmtCapture::on_recv_done_(rmt_channel_handle_t channel, const rmt_rx_done_event_data_t *data,
+                                          void *arg) {
+  auto *self = static_cast<RmtCapture *>(arg);
+  size_t done = self->receiving_;
+  size_t next = (done + 1) % NUM_BUFFERS;
+  if (data->num_symbols == 0) {
+    // nothing captured: receive into the same buffer again
+    next = done;
+  } else if (self->num_symbols_[next] != 0) {
+    // the loop still has to read the next buffer: drop this capture
+    self->overruns_ = self->overruns_ + 1;
+    next = done;
+  } else {
+    self->num_symbols_[done] = data->num_symbols;
+  }
+  // keep capturing right away: the next frame may start after the minimum signal free time
+  self->receiving_ = next;
+  self->start_receive_(next);
+  return false;  // no task woken
+}
+
+size_t RmtCapture::read(LinePeriod *periods, size_t max_periods) {
+  size_t captured = num_symbols_[reading_];
+  size_t num_symbols = std::min(captured, MAX_SYMBOLS);
+  if (num_symbols == 0) {
+    return 0;
+  }
+  size_t count = 0;
+  while (read_position_ < num_symbols && count + 2 <= max_periods) {
+    const rmt_symbol_word_t &symbol = symbols_[reading_][read_position_++];
+    // a zero duration marks the end of the capture
+    if (symbol.duration0 != 0) {
+      periods[count++] = {(bool) symbol.level0, symbol.duration0};
+    }
+    if (symbol.duration1 != 0) {
+      periods[count++] = {(bool) symbol.level1, symbol.duration1};
+    }
+  }
+  if (read_position_ >= num_symbols) {
+    // hand the buffer back to the interrupt handler
+    read_position_ = 0;
+    num_symbols_[reading_] = 0;
+    reading_ = (reading_ + 1) % NUM_BUFFERS;
+  }
+  return count;
+}
+
+}  // namespace hdmi_cec
+}  // namespace esphome
+
+#endif  // USE_HDMI_CEC_RMT
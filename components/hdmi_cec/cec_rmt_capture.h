@@ -0,0 +1,59 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+#ifdef USE_HDMI_CEC_RMT
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include <driver/rmt_rx.h>
+
+#include "esphome/core/hal.h"
+#include "cec_receiver.h"
+
+namespace esphome {
+namespace hdmi_cec {
+
+/**
+ * Edge capture through an ESP32 RMT receive channel (ESP-IDF 5 driver).
+ * The RMT peripheral timestamps every edge of a whole frame in hardware, and raises a single interrupt
+ * once the line has been idle for a while, instead of one GPIO interrupt per edge.
+ * The captured frames are handed to the loop as batches of line periods. Since they are decoded after
+ * the fact, frames cannot be acknowledged: this backend is for monitor mode only.
+ */
+class RmtCapture {
+ public:
+  // every CEC bit is one RMT symbol (low + high period): start bit + 16 bytes of 10 bits, with some margin
+  constexpr static size_t MAX_SYMBOLS = 192;
+
+  bool setup(int gpio_num);
+  /**
+   * Take the next line periods of the oldest completed capture, at most 'max_periods' at a time.
+   * @return the number of periods, 0 if no capture is waiting
+   */
+  size_t read(LinePeriod *periods, size_t max_periods);
+  // captures lost because the loop did not pick up the previous ones in time
+  uint32_t overruns() const { return overruns_; }
+
+ protected:
+  constexpr static size_t NUM_BUFFERS = 2;
+
+  static bool IRAM_ATTR on_recv_done_(rmt_channel_handle_t channel, const rmt_rx_done_event_data_t *data, void *arg);
+  bool start_receive_(size_t buffer);
+
+  rmt_channel_handle_t channel_{nullptr};
+  rmt_receive_config_t receive_config_{};
+  rmt_symbol_word_t symbols_[NUM_BUFFERS][MAX_SYMBOLS];
+  volatile size_t num_symbols_[NUM_BUFFERS] = {};  // 0 while the buffer is free or being filled
+  volatile size_t receiving_{0};                   // buffer the RMT channel currently writes to
+  size_t reading_{0};                              // next buffer for the loop to read
+  size_t read_position_{0};                        // next symbol to read in that buffer
+  volatile uint32_t overruns_{0};
+};
+
+}  // namespace hdmi_cec
+}  // namespace esphome
+
+#endif  // USE_HDMI_CEC_RMT
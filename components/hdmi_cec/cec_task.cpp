@@ -0,0 +1,124 @@
+#include "cec_task.h"
+
+#ifdef USE_HDMI_CEC_TASK
+
+#include <chrono>
+
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace hdmi_cec {
+
+static const char *const TAG = "hdmi_cec.task";
+
+ProtocolTask *ProtocolTask::get() {
+  // a single task serves all buses, so a bridge between them stays on one thread
+  static ProtocolTask *task = new ProtocolTask();  // NOLINT(cppcoreguidelines-owning-memory)
+  return task;
+}
+
+bool ProtocolTask::add(loop_t loop, void *arg) {
+  const size_t count = num_loops_.load();
+  if (count >= MAX_LOOPS) {
+    ESP_LOGE(TAG, "At most %u buses can run on the CEC task", (unsigned) MAX_LOOPS);
+    return false;
+  }
+  // the task only sees the new entry once it is complete
+  loops_[count] = {loop, arg};
+  num_loops_.store(count + 1);
+  if (started_) {
+    return true;
+  }
+
+#ifdef USE_ESP32
+#if CONFIG_FREERTOS_UNICORE
+  const BaseType_t core = tskNO_AFFINITY;
+#else
+  const BaseType_t core = APP_CPU_NUM;
+#endif
+  if (xTaskCreatePinnedToCore(ProtocolTask::task_main_, "hdmi_cec", STACK_SIZE, this, PRIORITY, &handle_, core) !=
+      pdPASS) {
+    ESP_LOGE(TAG, "Could not create the CEC task");
+    return false;
+  }
+#else
+  {
+    // the thread waits until its id is known, for 'is_current()'
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::thread thread([this]() {
+      { std::lock_guard<std::mutex> lock(mutex_); }
+      run_();
+    });
+    thread_id_ = thread.get_id();
+    thread.detach();
+  }
+#endif
+  started_ = true;
+  return true;
+}
+
+void ProtocolTask::run_() {
+  while (true) {
+    wait_();
+    const size_t count = num_loops_.load();
+    for (size_t i = 0; i < count; i++) {
+      loops_[i].loop(loops_[i].arg);
+    }
+  }
+}
+
+#ifdef USE_ESP32
+
+void ProtocolTask::task_main_(void *arg) { static_cast<ProtocolTask *>(arg)->run_(); }
+
+bool ProtocolTask::is_current() const { return handle_ != nullptr && xTaskGetCurrentTaskHandle() == handle_; }
+
+void ProtocolTask::notify() {
+  if (handle_ != nullptr) {
+    xTaskNotifyGive(handle_);
+  }
+}
+
+void IRAM_ATTR ProtocolTask::notify_from_isr() {
+  if (handle_ == nullptr) {
+    return;
+  }
+  // esp_timer callbacks run on the esp_timer task, unless dispatched from the ISR
+  if (!xPortInIsrContext()) {
+    xTaskNotifyGive(handle_);
+    return;
+  }
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(handle_, &woken);
+  portYIELD_FROM_ISR(woken);
+}
+
+void ProtocolTask::wait_() { ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(PERIOD_MS)); }
+
+#else
+
+bool ProtocolTask::is_current() const { return std::this_thread::get_id() == thread_id_; }
+
+void ProtocolTask::notify() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    notified_ = true;
+  }
+  condition_.notify_one();
+}
+
+// there are no interrupts on a host: the simulated edges come from another thread
+void ProtocolTask::notify_from_isr() { notify(); }
+
+void ProtocolTask::wait_() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  condition_.wait_for(lock, std::chrono::milliseconds(PERIOD_MS), [this]() { return notified_; });
+  notified_ = false;
+}
+
+#endif
+
+}  // namespace hdmi_cec
+}  // namespace esphome
+
+#endif  // USE_HDMI_CEC_TASK
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "esphome/core/defines.h"
+#include "esphome/core/hal.h"
+
+#ifdef USE_HDMI_CEC_TASK
+#ifdef USE_ESP32
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+#endif
+
+namespace esphome {
+namespace hdmi_cec {
+
+/**
+ * Lock-free queue between exactly one producer thread and one consumer thread, with the items stored inline.
+ * Each index is only written by one side, and the item is in place before the producer publishes its index.
+ * Several producers (or consumers) must take turns, e.g. with a mutex of their side.
+ */
+template<typename T, size_t SIZE> class SpscQueue {
+ public:
+  // producer side, @return false if the queue is full
+  bool push(T &&item) {
+    const size_t back = back_.load(std::memory_order_relaxed);
+    const size_t next = next_(back);
+    if (next == front_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    store_[back] = std::move(item);
+    back_.store(next, std::memory_order_release);
+    return true;
+  }
+  // consumer side, @return false if the queue is empty
+  bool pop(T &item) {
+    const size_t front = front_.load(std::memory_order_relaxed);
+    if (front == back_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = std::move(store_[front]);
+    front_.store(next_(front), std::memory_order_release);
+    return true;
+  }
+  bool is_empty() const { return front_.load(std::memory_order_acquire) == back_.load(std::memory_order_acquire); }
+
+ protected:
+  static size_t next_(size_t index) { return (index == SIZE) ? 0 : (index + 1); }
+  // one slot stays free, to tell a full queue from an empty one
+  std::array<T, SIZE + 1> store_{};
+  std::atomic<size_t> front_{0};
+  std::atomic<size_t> back_{0};
+};
+
+#ifdef USE_HDMI_CEC_TASK
+
+/**
+ * Runs the protocol side of all CEC buses of the node (receive processing, built-in replies, forwarding and
+ * transmit), away from the main loop: a slow component can't delay the replies past what other devices
+ * tolerate. The task calls the loop function of each bus whenever it is notified (by the interrupt handlers,
+ * the transmit timer, or a new frame to send), and at least every PERIOD_MS.
+ *  - ESP32: FreeRTOS task, pinned to the application core (the Wi-Fi stack runs on the other one)
+ *  - other platforms: std::thread, to run the same code on a host
+ */
+class ProtocolTask {
+ public:
+  using loop_t = void (*)(void *arg);
+  constexpr static size_t MAX_LOOPS = 8;
+  constexpr static uint32_t PERIOD_MS = 10;
+  constexpr static uint32_t STACK_SIZE = 4096;
+  constexpr static uint32_t PRIORITY = 10;  // above the main loop task
+
+  // the task of this node, created on first use
+  static ProtocolTask *get();
+
+  // Add the loop function of a bus, and start the task if it's not running yet. @return false on failure
+  bool add(loop_t loop, void *arg);
+  // whether the caller runs on this task
+  bool is_current() const;
+  void notify();
+  void notify_from_isr();
+
+ protected:
+  void run_();
+  void wait_();
+
+  struct Loop {
+    loop_t loop;
+    void *arg;
+  };
+  std::array<Loop, MAX_LOOPS> loops_{};
+  std::atomic<size_t> num_loops_{0};
+  bool started_{false};
+#ifdef USE_ESP32
+  static void task_main_(void *arg);
+  TaskHandle_t handle_{nullptr};
+#else
+  std::thread::id thread_id_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool notified_{false};
+#endif
+};
+
+#endif  // USE_HDMI_CEC_TASK
+
+}  // namespace hdmi_cec
+}  // namespace esphome
@@ -0,0 +1,223 @@
+#include "cec_timer.h"
+#include "esphome/core/log.h"
+
+#ifdef USE_ESP8266
+#include <Arduino.h>
+#endif
+
+namespace esphome {
+namespace hdmi_cec {
+
+static const char *const TAG = "hdmi_cec.timer";
+
+TimerService *TimerService::instance_ = nullptr;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+TimerService *TimerService::get() {
+  // a single hardware timer serves all buses
+  if (instance_ == nullptr) {
+    instance_ = new TimerService();  // NOLINT(cppcoreguidelines-owning-memory)
+  }
+  return instance_;
+}
+
+int TimerService::add_channel(timer_callback_t callback, void *arg) {
+  if (!hardware_ready_) {
+    hardware_ready_ = setup_hardware_();
+    if (!hardware_ready_) {
+      return -1;
+    }
+  }
+  if (num_channels_ >= MAX_CHANNELS) {
+    ESP_LOGE(TAG, "No timer channel left, at most %u buses are supported", (unsigned) MAX_CHANNELS);
+    return -1;
+  }
+  Channel &channel = channels_[num_channels_];
+  channel.callback = callback;
+  channel.arg = arg;
+  channel.armed = false;
+  return (int) num_channels_++;
+}
+
+void IRAM_ATTR TimerService::start(int channel, uint32_t delay_us) {
+  lock_();
+  channels_[channel].deadline_us = micros() + delay_us;
+  channels_[channel].armed = true;
+  rearm_();
+  unlock_();
+}
+
+void IRAM_ATTR TimerService::stop(int channel) {
+  lock_();
+  channels_[channel].armed = false;
+  rearm_();
+  unlock_();
+}
+
+void IRAM_ATTR TimerService::dispatch_() {
+  lock_();
+  dispatching_ = true;
+  const uint32_t now = micros();
+  uint32_t due = 0;
+  for (size_t i = 0; i < num_channels_; i++) {
+    Channel &channel = channels_[i];
+    if (channel.armed && (int32_t) (now - channel.deadline_us) >= 0) {
+      channel.armed = false;
+      due |= 1u << i;
+    }
+  }
+  unlock_();
+
+  // the callbacks may start their channel again
+  for (size_t i = 0; i < num_channels_; i++) {
+    if (due & (1u << i)) {
+      channels_[i].callback(channels_[i].arg);
+    }
+  }
+
+  lock_();
+  dispatching_ = false;
+  rearm_();
+  unlock_();
+}
+
+void IRAM_ATTR TimerService::rearm_() {
+  if (dispatching_) {
+    // the hardware is armed once all due channels ran
+    return;
+  }
+  bool armed = false;
+  uint32_t next_us = 0;
+  for (size_t i = 0; i < num_channels_; i++) {
+    const Channel &channel = channels_[i];
+    if (channel.armed && (!armed || (int32_t) (channel.deadline_us - next_us) < 0)) {
+      next_us = channel.deadline_us;
+      armed = true;
+    }
+  }
+  if (!armed) {
+    disarm_hardware_();
+    return;
+  }
+  int32_t delay = (int32_t) (next_us - micros());
+  arm_hardware_((delay > 0) ? (uint32_t) delay : 0);
+}
+
+#if defined(USE_ESP32)
+
+bool TimerService::setup_hardware_() {
+  esp_timer_create_args_t args = {};
+  args.callback = TimerService::esp_timer_callback_;
+  args.arg = this;
+  // the callbacks release the ACK bit and time the transmitted bits: they run in the timer interrupt
+  args.dispatch_method = ESP_TIMER_ISR;
+  args.name = "hdmi_cec";
+  esp_err_t err = esp_timer_create(&args, &handle_);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "esp_timer_create failed: %d", err);
+    return false;
+  }
+  return true;
+}
+
+void IRAM_ATTR TimerService::arm_hardware_(uint32_t delay_us) {
+  esp_timer_stop(handle_);  // fails harmlessly if the timer is not running
+  esp_timer_start_once(handle_, (delay_us > 0) ? delay_us : 1);
+}
+
+void IRAM_ATTR TimerService::disarm_hardware_() { esp_timer_stop(handle_); }
+
+void TimerService::poll() {}
+
+void IRAM_ATTR TimerService::esp_timer_callback_(void *arg) { static_cast<TimerService *>(arg)->dispatch_(); }
+
+#elif defined(USE_RP2040)
+
+bool TimerService::setup_hardware_() { return true; }
+
+void TimerService::arm_hardware_(uint32_t delay_us) {
+  disarm_hardware_();
+  alarm_id_ = add_alarm_in_us((delay_us > 0) ? delay_us : 1, TimerService::alarm_callback_, this, true);
+}
+
+void TimerService::disarm_hardware_() {
+  if (alarm_id_ > 0) {
+    cancel_alarm(alarm_id_);
+    alarm_id_ = 0;
+  }
+}
+
+void TimerService::poll() {}
+
+int64_t TimerService::alarm_callback_(alarm_id_t id, void *arg) {
+  auto *self = static_cast<TimerService *>(arg);
+  self->alarm_id_ = 0;
+  self->dispatch_();
+  return 0;  // don't reschedule
+}
+
+#elif defined(USE_ESP8266)
+
+bool TimerService::setup_hardware_() {
+  timer1_attachInterrupt(TimerService::timer1_callback_);
+  return true;
+}
+
+void IRAM_ATTR TimerService::arm_hardware_(uint32_t delay_us) {
+  // TIM_DIV16 runs timer1 at 5 ticks per microsecond; very short delays would be missed by the hardware
+  static const uint32_t MIN_TICKS = 10;
+  uint32_t ticks = delay_us * 5;
+  timer1_enable(TIM_DIV16, TIM_EDGE, TIM_SINGLE);
+  timer1_write((ticks > MIN_TICKS) ? ticks : MIN_TICKS);
+}
+
+void IRAM_ATTR TimerService::disarm_hardware_() { timer1_disable(); }
+
+void TimerService::poll() {}
+
+// timer1 passes no argument: read the instance, set up before the interrupt was attached
+void IRAM_ATTR TimerService::timer1_callback_() { instance_->dispatch_(); }
+
+#elif defined(USE_HDMI_CEC_SIM)
+
+bool TimerService::setup_hardware_() { return true; }
+
+void TimerService::arm_hardware_(uint32_t delay_us) { sim::arm_timer(delay_us, TimerService::sim_alarm_, this); }
+
+void TimerService::disarm_hardware_() { sim::disarm_timer(); }
+
+void TimerService::poll() {}
+
+void TimerService::sim_alarm_(void *arg) { static_cast<TimerService *>(arg)->dispatch_(); }
+
+#else
+
+bool TimerService::setup_hardware_() {
+  ESP_LOGW(TAG, "No hardware timer on this platform, CEC transmit timing depends on the loop rate");
+  return true;
+}
+
+// the deadlines are checked by 'poll()'
+void TimerService::arm_hardware_(uint32_t delay_us) {}
+
+void TimerService::disarm_hardware_() {}
+
+void TimerService::poll() {
+  for (size_t i = 0; i < num_channels_; i++) {
+    const Channel &channel = channels_[i];
+    if (channel.armed && (int32_t) (micros() - channel.deadline_us) >= 0) {
+      dispatch_();
+      return;
+    }
+  }
+}
+
+#endif
+
+bool OneShotTimer::setup(callback_t callback, void *arg) {
+  service_ = TimerService::get();
+  channel_ = service_->add_channel(callback, arg);
+  return channel_ >= 0;
+}
+
+}  // namespace hdmi_cec
+}  // namespace esphome
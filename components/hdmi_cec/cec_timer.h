@@ -0,0 +1,183 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "esphome/core/defines.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+
+#ifdef USE_ESP32
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#endif
+#ifdef USE_RP2040
+#include <hardware/sync.h>
+#include <pico/time.h>
+#endif
+
+namespace esphome {
+namespace hdmi_cec {
+
+using timer_callback_t = void (*)(void *arg);
+
+#ifdef USE_HDMI_CEC_SIM
+// Host tests: the simulated bus plays the hardware timer, on its virtual clock (see tests/sim)
+namespace sim {
+void arm_timer(uint32_t delay_us, timer_callback_t alarm, void *arg);
+void disarm_timer();
+}  // namespace sim
+#endif
+
+/**
+ * Lock for the state shared by the GPIO interrupt handler, the timer callbacks and the component loop (or task).
+ * On the dual-core ESP32 and RP2040 these may run on both cores at the same time, where disabling the interrupts of
+ * one core does not keep the other one out: there it is a spinlock that also disables the interrupts of the current
+ * core. Elsewhere it disables the interrupts. Not recursive; hold it for a few microseconds at most.
+ */
+class CrossCoreLock {
+ public:
+#if defined(USE_ESP32)
+  void lock() { portENTER_CRITICAL_SAFE(&mux_); }
+  void unlock() { portEXIT_CRITICAL_SAFE(&mux_); }
+#elif defined(USE_RP2040)
+  CrossCoreLock() : spin_lock_(spin_lock_instance(spin_lock_claim_unused(true))) {}
+  void lock() { saved_irq_ = spin_lock_blocking(spin_lock_); }
+  void unlock() { spin_unlock(spin_lock_, saved_irq_); }
+#else
+  // single core: disabling the interrupts is enough, which the guard does
+  void lock() {}
+  void unlock() {}
+#endif
+
+ protected:
+#if defined(USE_ESP32)
+  portMUX_TYPE mux_ = portMUX_INITIALIZER_UNLOCKED;
+#elif defined(USE_RP2040)
+  spin_lock_t *spin_lock_;
+  uint32_t saved_irq_{0};
+#endif
+};
+
+class CrossCoreLockGuard {
+ public:
+  explicit CrossCoreLockGuard(CrossCoreLock &lock) : lock_(lock) { lock_.lock(); }
+  ~CrossCoreLockGuard() { lock_.unlock(); }
+  CrossCoreLockGuard(const CrossCoreLockGuard &) = delete;
+  CrossCoreLockGuard &operator=(const CrossCoreLockGuard &) = delete;
+
+ protected:
+  CrossCoreLock &lock_;
+#if !defined(USE_ESP32) && !defined(USE_RP2040)
+  InterruptLock interrupt_lock_;
+#endif
+};
+
+/**
+ * A single hardware timer shared by all CEC buses of the node, so the buses keep their own bit timing and transmit
+ * in parallel without each needing a timer of its own (the ESP8266 only has one). Every bus owns a channel with its
+ * own deadline; the hardware timer is armed for the earliest one, and runs the callbacks of all due channels.
+ * The callbacks run in interrupt (or high-priority timer task) context.
+ *  - ESP32: esp_timer, with ISR dispatch (CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD, set by codegen)
+ *  - ESP8266: timer1
+ *  - RP2040: pico SDK alarm
+ *  - host tests (USE_HDMI_CEC_SIM): alarm of the simulated bus
+ *  - other platforms: software timer that expires from 'poll()', called by the component loop
+ * Channels are started and stopped with interrupts disabled (from interrupt handlers, or under a CrossCoreLock).
+ * On the dual-core ESP32 and RP2040 the timer may fire on another core than the GPIO interrupts, so the channels are
+ * also guarded by a spinlock there.
+ */
+class TimerService {
+ public:
+  constexpr static size_t MAX_CHANNELS = 8;
+
+  // the service of this node, created on first use
+  static TimerService *get();
+
+  // @return the channel number, or -1 if there is none left or the hardware timer could not be set up
+  int add_channel(timer_callback_t callback, void *arg);
+  void start(int channel, uint32_t delay_us);
+  void stop(int channel);
+  void poll();
+
+ protected:
+  struct Channel {
+    timer_callback_t callback;
+    void *arg;
+    volatile bool armed;
+    volatile uint32_t deadline_us;
+  };
+
+  bool setup_hardware_();
+  void arm_hardware_(uint32_t delay_us);
+  void disarm_hardware_();
+  // run the callbacks of the due channels, then arm the hardware for the next deadline
+  void dispatch_();
+  void rearm_();
+  // spinlock on dual-core platforms; nothing on the others, where the callers already disabled the interrupts
+  void lock_() { channels_lock_.lock(); }
+  void unlock_() { channels_lock_.unlock(); }
+
+  // a plain pointer, set before the first channel is added: the interrupt handlers read it without a guard variable
+  static TimerService *instance_;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+  std::array<Channel, MAX_CHANNELS> channels_{};
+  size_t num_channels_{0};
+  bool hardware_ready_{false};
+  volatile bool dispatching_{false};
+  CrossCoreLock channels_lock_;
+#if defined(USE_ESP32)
+  static void IRAM_ATTR esp_timer_callback_(void *arg);
+  esp_timer_handle_t handle_{nullptr};
+#elif defined(USE_RP2040)
+  static int64_t alarm_callback_(alarm_id_t id, void *arg);
+  volatile alarm_id_t alarm_id_{0};
+#elif defined(USE_ESP8266)
+  static void IRAM_ATTR timer1_callback_();
+#elif defined(USE_HDMI_CEC_SIM)
+  static void sim_alarm_(void *arg);
+#endif
+};
+
+/**
+ * Minimal one-shot timer, used to advance the transmitter state machine at bit-phase resolution
+ * without busy-waiting. It is a channel of the shared TimerService.
+ */
+class OneShotTimer {
+ public:
+  using callback_t = timer_callback_t;
+#if defined(USE_ESP32) || defined(USE_RP2040) || defined(USE_ESP8266) || defined(USE_HDMI_CEC_SIM)
+  // the callback runs at the requested time, independent of the component loop
+  constexpr static bool IS_HARDWARE = true;
+#else
+  constexpr static bool IS_HARDWARE = false;
+#endif
+  // the callback runs from the timer interrupt (the simulated one in host tests), within microseconds of its time
+  constexpr static bool RUNS_IN_ISR = IS_HARDWARE;
+
+  bool setup(callback_t callback, void *arg);
+  // (re)arm the timer to fire once, 'delay_us' from now; replaces a pending expiry
+  void start(uint32_t delay_us) { service_->start(channel_, delay_us); }
+  void stop() { service_->stop(channel_); }
+  // expire the software timer on platforms without a hardware backend; no-op otherwise
+  void poll() { service_->poll(); }
+
+ protected:
+  TimerService *service_{nullptr};
+  int channel_{-1};
+};
+
+#ifdef USE_ESP32
+// Run from the esp_timer task instead, the ACK release could come late, and the receiver would have to busy-wait
+// the 1.5 ms of the ACK bit in the interrupt handler
+static_assert(
+#ifdef CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+    true,
+#else
+    false,
+#endif
+    "hdmi_cec needs the esp_timer ISR dispatch: set CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD in the sdkconfig");
+#endif
+
+}  // namespace hdmi_cec
+}  // namespace esphome
@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <cstring>
+
+#include "esphome/core/hal.h"
+#include "cec_transmitter.h"
+
+namespace esphome {
+namespace hdmi_cec {
+
+const char *send_result_to_string(SendResult result) {
+  switch (result) {
+    case SendResult::Success:
+      return "Success";
+    case SendResult::BusCollision:
+      return "Bus Collision";
+    case SendResult::NoAck:
+      return "No Ack received";
+    case SendResult::Timeout:
+      return "Timeout";
+    case SendResult::Expired:
+      return "Expired";
+    case SendResult::Dropped:
+      return "Dropped";
+    default:
+      return "?";
+  }
+}
+
+void IRAM_ATTR Transmitter::start(const uint8_t *data, size_t length, uint32_t now_us, uint8_t max_attempts) {
+  length_ = (uint8_t) std::min(length, data_.size());
+  std::memcpy(data_.data(), data, length_);
+  is_broadcast_ = (length_ > 0) && ((data_[0] & 0x0F) == 0x0F);
+  phase_ = Phase::WaitBusFree;
+  result_ = SendResult::Success;
+  attempt_ = 0;
+  collisions_ = 0;
+  max_attempts_ = std::max<uint8_t>(max_attempts, 1);
+  retrying_ = false;
+  send_start_us_ = now_us;
+  attempt_start_us_ = now_us;
+}
+
+TxStep IRAM_ATTR Transmitter::step(uint32_t now_us, bool line_level, uint32_t last_bus_edge_us) {
+  switch (phase_) {
+    case Phase::WaitBusFree: {
+      if ((now_us - send_start_us_) > SEND_TIMEOUT_US) {
+        return finish_(SendResult::Timeout);
+      }
+      if ((now_us - attempt_start_us_) > ATTEMPT_TIMEOUT_US) {
+        // bus constantly busy: this counts as a failed attempt
+        attempt_++;
+        if (attempt_ >= max_attempts_) {
+          return finish_(SendResult::Timeout);
+        }
+        retrying_ = true;
+        attempt_start_us_ = now_us;
+      }
+
+      // Bus 'Signal Free' time between transmissions, according to the HDMI-CEC standard, shall be a minimum of:
+      //  - 7 bit periods between successive transmissions of same sender
+      //  - 5 bit periods between transmissions of different senders
+      //  - 3 bit periods for resend of a failed transmission attempt
+      bool other_initiator = (int32_t) (last_bus_edge_us - last_end_us_) > 0;
+      uint32_t free_bit_periods = other_initiator ? 5 : (retrying_ ? 3 : 7);
+      uint32_t last_activity_us = other_initiator ? last_bus_edge_us : last_end_us_;
+      uint32_t free_us = free_bit_periods * TOTAL_BIT_US;
+      if ((now_us - last_activity_us) < free_us) {
+        // Note: while waiting, another initiator may start sending, which pushes 'last_bus_edge_us' further
+        return {LineAction::None, last_activity_us + free_us, false};
+      }
+      if (!line_level) {
+        // someone is holding the line low: check again later
+        return {LineAction::None, now_us + HIGH_BIT_US, false};
+      }
+      result_ = SendResult::Success;
+      bit_index_ = 0;
+      ack_bits_ = 0;
+      return begin_bit_(now_us);
+    }
+
+    case Phase::BitLow: {
+      uint32_t sample_us = bit_sample_us_();
+      phase_ = (sample_us != 0) ? Phase::BitHigh : Phase::BitEnd;
+      return {LineAction::Release, bit_start_us_ + ((sample_us != 0) ? sample_us : bit_total_us_()), false};
+    }
+
+    case Phase::BitHigh: {
+      bool is_ack_bit = (bit_index_ != 0) && ((bit_index_ - 1) % 10 == 9);
+      if (!is_ack_bit && !line_level) {
+        // Start bit or initiator address bit lengthened by another initiator: we lost arbitration.
+        // Immediately stop sending bits: the other concurrent initiator with lower address might not have
+        // detected the conflict (see the specification in the HDMI standard, section "CEC Arbitration")
+        return end_attempt_(now_us, SendResult::BusCollision);
+      }
+      if (is_ack_bit && !line_level) {
+        ack_bits_ |= 1 << ((bit_index_ - 1) / 10);
+      }
+      // 'no broadcast' should give a 'false' signal value as 'ack'
+      if (is_ack_bit && (line_level != is_broadcast_)) {
+        result_ = SendResult::NoAck;
+      }
+      phase_ = Phase::BitEnd;
+      return {LineAction::None, bit_start_us_ + bit_total_us_(), false};
+    }
+
+    case Phase::BitEnd: {
+      if (result_ != SendResult::Success) {
+        return end_attempt_(now_us, result_);
+      }
+      bit_index_++;
+      if (bit_index_ > length_ * 10) {
+        last_end_us_ = now_us;
+        return finish_(SendResult::Success);
+      }
+      return begin_bit_(now_us);
+    }
+
+    case Phase::Idle:
+    default:
+      return {LineAction::None, now_us, true};
+  }
+}
+
+TxStep IRAM_ATTR Transmitter::begin_bit_(uint32_t now_us) {
+  bit_start_us_ = now_us;
+  phase_ = Phase::BitLow;
+  return {LineAction::DriveLow, now_us + bit_low_us_(), false};
+}
+
+TxStep IRAM_ATTR Transmitter::end_attempt_(uint32_t now_us, SendResult result) {
+  last_end_us_ = now_us;
+  attempt_++;
+  if (result == SendResult::BusCollision) {
+    collisions_++;
+  }
+  if (attempt_ >= max_attempts_) {
+    return finish_(result);
+  }
+  // attempt retransmission with smaller free time gap
+  result_ = result;
+  retrying_ = true;
+  attempt_start_us_ = now_us;
+  phase_ = Phase::WaitBusFree;
+  return {LineAction::Release, now_us + 3 * TOTAL_BIT_US, false};
+}
+
+TxStep IRAM_ATTR Transmitter::finish_(SendResult result) {
+  result_ = result;
+  phase_ = Phase::Idle;
+  return {LineAction::Release, 0, true};
+}
+
+uint32_t IRAM_ATTR Transmitter::bit_low_us_() const {
+  // logic 1: pull low for 600 us, then pull high for 1800 us
+  // logic 0: pull low for 1500 us, then pull high for 900 us
+  if (bit_index_ == 0) {
+    return START_BIT_LOW_US;
+  }
+  uint16_t byte_index = (bit_index_ - 1) / 10;
+  uint16_t bit_pos = (bit_index_ - 1) % 10;
+  bool bit_value;
+  if (bit_pos < 8) {
+    bit_value = (data_[byte_index] >> (7 - bit_pos)) & 0b1;
+  } else if (bit_pos == 8) {
+    // EOM bit (logic 1 if this is the last byte of the frame)
+    bit_value = (byte_index == length_ - 1);
+  } else {
+    // ACK bit: always sent as a logical 1, the destination(s) may lengthen it
+    bit_value = true;
+  }
+  return bit_value ? HIGH_BIT_US : LOW_BIT_US;
+}
+
+uint32_t IRAM_ATTR Transmitter::bit_sample_us_() const {
+  if (bit_index_ == 0) {
+    // check half-way the 'high' interval of the start bit for no collision
+    return START_BIT_SAMPLE_US;
+  }
+  uint16_t byte_index = (bit_index_ - 1) / 10;
+  uint16_t bit_pos = (bit_index_ - 1) % 10;
+  if (bit_pos == 9) {
+    return SAFE_SAMPLE_US;
+  }
+  if (byte_index == 0 && bit_pos < 4 && ((data_[0] >> (7 - bit_pos)) & 0b1)) {
+    // my initiator address bit is 1: test for bus collision
+    return SAFE_SAMPLE_US;
+  }
+  return 0;
+}
+
+}  // namespace hdmi_cec
+}  // namespace esphome
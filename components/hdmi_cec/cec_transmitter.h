@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace hdmi_cec {
+
+// transmitter bit timing, from the HDMI CEC standard (all values in microseconds)
+static constexpr uint32_t START_BIT_LOW_US = 3700;
+static constexpr uint32_t START_BIT_US = 4500;
+static constexpr uint32_t START_BIT_SAMPLE_US = 4100;
+static constexpr uint32_t TOTAL_BIT_US = 2400;
+static constexpr uint32_t HIGH_BIT_US = 600;
+static constexpr uint32_t LOW_BIT_US = 1500;
+// middle of the "Safe sample period" (CEC spec -> Signaling and Bit Timing -> Figure 5)
+static constexpr uint32_t SAFE_SAMPLE_US = 1050;
+
+enum class SendResult : uint8_t {
+  Success = 0,
+  BusCollision = 1,
+  NoAck = 2,
+  Timeout = 3,
+  Expired = 4,  // not sent: its deadline passed while waiting in the transmit queue
+  Dropped = 5,  // not sent: pushed out of a full transmit queue by a more important frame
+};
+
+const char *send_result_to_string(SendResult result);
+
+enum class LineAction : uint8_t {
+  None = 0,
+  DriveLow = 1,
+  Release = 2,
+};
+
+/**
+ * Outcome of a single Transmitter step: what to do with the CEC line right now, and when to call 'step()' again.
+ */
+struct TxStep {
+  LineAction line;
+  uint32_t next_us;  // absolute time (in 'micros()' units) of the next step; not used when 'done'
+  bool done;
+};
+
+/**
+ * The Transmitter is the state machine that puts a single frame on the CEC bus, including the
+ * 'signal free time' wait, arbitration, acknowledge checking and retransmissions.
+ * It has no knowledge of pins or timers: the owner calls 'step()' at the requested time with the
+ * current time and line level, and applies the returned line action. That way, a hardware timer can
+ * advance the transmission one bit phase at a time, and the same logic runs against a virtual clock.
+ */
+class Transmitter {
+ public:
+  constexpr static size_t MAX_ATTEMPTS = 5;
+  // abort if we can't send within 2 seconds (prevents endless retries on a busy bus)
+  constexpr static uint32_t SEND_TIMEOUT_US = 2000000;
+  // per-attempt timeout for the bus-free wait
+  constexpr static uint32_t ATTEMPT_TIMEOUT_US = 200000;
+
+  // Prepare a new transmission of 'length' bytes. The first 'step()' starts the bus-free wait.
+  void start(const uint8_t *data, size_t length, uint32_t now_us, uint8_t max_attempts = MAX_ATTEMPTS);
+  // Advance the state machine. 'last_bus_edge_us' is the last falling edge caused by another initiator.
+  TxStep step(uint32_t now_us, bool line_level, uint32_t last_bus_edge_us);
+
+  bool is_busy() const { return phase_ != Phase::Idle; }
+  // true while the frame bits themselves are on the bus (as opposed to waiting for a free bus)
+  bool is_on_bus() const { return phase_ >= Phase::BitLow; }
+  SendResult result() const { return result_; }
+  uint8_t attempts() const { return attempt_; }
+  // attempts of this transmission that stopped because another initiator won the arbitration
+  uint8_t collisions() const { return collisions_; }
+  // ACK bits of the last attempt, bit i set if the ACK bit of byte i was read as '0' (driven low)
+  uint16_t ack_bits() const { return ack_bits_; }
+
+ protected:
+  enum class Phase : uint8_t {
+    Idle = 0,
+    WaitBusFree = 1,
+    BitLow = 2,     // line driven low at the start of the current bit
+    BitHigh = 3,    // line released, waiting for the sample point
+    BitEnd = 4,     // waiting for the end of the current bit period
+  };
+
+  TxStep begin_bit_(uint32_t now_us);
+  TxStep end_attempt_(uint32_t now_us, SendResult result);
+  TxStep finish_(SendResult result);
+  uint32_t bit_low_us_() const;
+  uint32_t bit_sample_us_() const;  // 0 if the current bit is not sampled
+  uint32_t bit_total_us_() const { return (bit_index_ == 0) ? START_BIT_US : TOTAL_BIT_US; }
+
+  std::array<uint8_t, 16> data_{};
+  uint8_t length_{0};
+  bool is_broadcast_{false};
+
+  Phase phase_{Phase::Idle};
+  SendResult result_{SendResult::Success};
+  uint8_t attempt_{0};
+  uint8_t collisions_{0};
+  uint8_t max_attempts_{MAX_ATTEMPTS};
+  bool retrying_{false};
+  uint16_t ack_bits_{0};
+  uint16_t bit_index_{0};  // 0 is the start bit, then 10 bits (8 data, EOM, ACK) per byte
+  uint32_t bit_start_us_{0};
+  uint32_t send_start_us_{0};
+  uint32_t attempt_start_us_{0};
+  uint32_t last_end_us_{0};  // end of our last transmission on the bus
+};
+
+}  // namespace hdmi_cec
+}  // namespace esphome
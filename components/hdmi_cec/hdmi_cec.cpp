@@ -1,31 +1,14 @@
 #include "hdmi_cec.h"
 #include "esphome/core/log.h"
 
-#ifdef USE_CEC_DECODER
-#include "cec_decoder.h"
+#ifdef USE_LOGGER
+#include "esphome/components/logger/logger.h"
 #endif
 
 namespace esphome {
 namespace hdmi_cec {
 
 static const char *const TAG = "hdmi_cec";
-// receiver constants
-static const uint32_t START_BIT_MIN_US = 3500;
-static const uint32_t HIGH_BIT_MIN_US = 400;
-static const uint32_t HIGH_BIT_MAX_US = 800;
-// transmitter constants
-static const uint32_t TOTAL_BIT_US = 2400;
-static const uint32_t HIGH_BIT_US = 600;
-static const uint32_t LOW_BIT_US = 1500;
-// arbitration and retransmission
-static const size_t MAX_ATTEMPTS = 5;
-// Yield interval for bus-free wait loop: break long waits into chunks of this
-// duration and call yield() between each, so the FreeRTOS scheduler can run
-// other tasks and the Task Watchdog Timer is not triggered.
-// 1ms is a good trade-off: short enough to maintain CEC timing accuracy
-// (bus-free periods are 7200-16800µs), yet long enough to avoid excessive
-// context-switch overhead from yielding on every microsecond-scale iteration.
-static const uint32_t YIELD_INTERVAL_US = 1000;
 
 static const gpio::Flags INPUT_MODE_FLAGS = gpio::FLAG_INPUT | gpio::FLAG_PULLUP;
 static const gpio::Flags OUTPUT_MODE_FLAGS = gpio::FLAG_OUTPUT | gpio::FLAG_OPEN_DRAIN;
@@ -35,33 +18,53 @@ static const gpio::Flags OUTPUT_MODE_FLAGS = gpio::FLAG_OUTPUT | gpio::FLAG_OPEN
 // Therefor, 'OUTPUT' will be used only to write '0': For writing a '1' the mode is switched to 'INPUT | PULLUP'.
 // That allows to safely check for cec bus conflicts on writing '1' (avoid short-circuit with other bus initiators).
 
-Frame::Frame(uint8_t initiator_addr, uint8_t target_addr, const std::vector<uint8_t> &payload)
-    : std::vector<uint8_t>(1 + payload.size(), (uint8_t) (0)) {
-  this->at(0) = ((initiator_addr & 0xf) << 4) | (target_addr & 0xf);
-  std::memcpy(this->data() + 1, payload.data(), payload.size());
-}
-
-std::string Frame::to_string(bool skip_decode) const {
-  std::string result;
-  char part_buffer[3];
-  for (auto it = this->cbegin(); it != this->cend(); it++) {
-    uint8_t byte_value = *it;
-    sprintf(part_buffer, "%02X", byte_value);
-    result += part_buffer;
-
-    if (it != (this->end() - 1)) {
-      result += ":";
-    }
+// Log a frame at debug level. Formatting (and decoding) only happens if the log line is going to be emitted.
+// 'message' is the frame already decoded, if any.
+static void log_frame(const char *direction, const Frame &frame, const DecodedMessage *message = nullptr) {
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_DEBUG
+#ifdef USE_LOGGER
+  auto *log = logger::global_logger;
+  if (log != nullptr && log->level_for(TAG) < ESPHOME_LOG_LEVEL_DEBUG) {
+    return;
   }
+#endif
+  char text[Frame::MAX_TEXT_LENGTH];
 #ifdef USE_CEC_DECODER
-  if (!skip_decode) {
-    Decoder decoder(*this);
-    result += " => " + decoder.decode();
+  size_t length = frame.format(text, sizeof(text), true);
+  DecodedMessage decoded;
+  if (message == nullptr) {
+    decoded = DecodedMessage(frame);
+    message = &decoded;
   }
+  length += snprintf(text + length, sizeof(text) - length, " => ");
+  message->format(text + length, sizeof(text) - length);
+#else
+  frame.format(text, sizeof(text));
+#endif
+  ESP_LOGD(TAG, "[%s] %s", direction, text);
 #endif
-  return result;
 }
 
+// A received frame, decoded on first use: most frames are neither logged, cached nor matched by a decoded trigger
+class LazyMessage {
+ public:
+  explicit LazyMessage(const Frame &frame) : frame_(frame) {}
+  const DecodedMessage &get() {
+    if (!decoded_) {
+      Decoder(frame_).decode(message_);
+      decoded_ = true;
+    }
+    return message_;
+  }
+  // the message if it was decoded already, nullptr otherwise
+  const DecodedMessage *decoded() const { return decoded_ ? &message_ : nullptr; }
+
+ protected:
+  const Frame &frame_;
+  DecodedMessage message_;
+  bool decoded_{false};
+};
+
 inline void IRAM_ATTR HDMICEC::set_pin_input_high() {
   pin_->pin_mode(INPUT_MODE_FLAGS);
 }
@@ -75,68 +78,374 @@ void HDMICEC::setup() {
   this->pin_->setup();  
   isr_pin_ = pin_->to_isr();
   frames_queue_.reset();
+  if (!tx_timer_.setup(HDMICEC::tx_timer_callback_, this)) {
+    this->mark_failed();
+    return;
+  }
+#ifdef USE_HDMI_CEC_RMT
+  if (rmt_receiver_) {
+    if (!rmt_capture_.setup(pin_->get_pin())) {
+      this->mark_failed();
+      return;
+    }
+  } else {
+    pin_->attach_interrupt(HDMICEC::gpio_intr_, this, gpio::INTERRUPT_ANY_EDGE);
+  }
+#else
   pin_->attach_interrupt(HDMICEC::gpio_intr_, this, gpio::INTERRUPT_ANY_EDGE);
+#endif
   set_pin_input_high();
+
+  if (allocate_address_ && !monitor_mode_) {
+    allocate_address();
+  }
+#ifdef USE_HDMI_CEC_TASK
+  // from now on, the protocol runs on the CEC task
+  if (!task_->add(HDMICEC::task_loop_, this)) {
+    this->mark_failed();
+    return;
+  }
+#endif
 }
 
 void HDMICEC::dump_config() {
   ESP_LOGCONFIG(TAG, "HDMI-CEC");
   LOG_PIN("  pin: ", pin_);
-  ESP_LOGCONFIG(TAG, "  address: %x", address_);
+  ESP_LOGCONFIG(TAG, "  address: %x%s", address_, allocate_address_ ? " (allocated at runtime)" : "");
   ESP_LOGCONFIG(TAG, "  promiscuous mode: %s", (promiscuous_mode_ ? "yes" : "no"));
   ESP_LOGCONFIG(TAG, "  monitor mode: %s", (monitor_mode_ ? "yes" : "no"));
+  ESP_LOGCONFIG(TAG, "  receive queue: %d frames", MAX_FRAMES_QUEUED);
+#ifdef USE_HDMI_CEC_TASK
+  ESP_LOGCONFIG(TAG, "  protocol: on the CEC task");
+#endif
+#ifdef USE_HDMI_CEC_RMT
+  if (rmt_receiver_) {
+    ESP_LOGCONFIG(TAG, "  receiver: RMT capture");
+  }
+#endif
+#ifdef USE_HDMI_CEC_EDGE_TRACE
+  if (edge_trace_.is_enabled()) {
+    ESP_LOGCONFIG(TAG, "  edge trace: %u edges", (unsigned) edge_trace_.size());
+  }
+#endif
+  if (bridge_target_ != nullptr) {
+    ESP_LOGCONFIG(TAG, "  bridge: to the bus on pin %u", (unsigned) bridge_target_->pin_->get_pin());
+  }
+#ifdef USE_HDMI_CEC_CAPTURE
+  if (capture_sink_ != nullptr) {
+    ESP_LOGCONFIG(TAG, "  frame capture: %u records, to %s", (unsigned) capture_.size(), capture_sink_->name());
+  }
+#endif
 }
 
 void HDMICEC::loop() {
-  while (const Frame *frame = frames_queue_.front()) {
-    uint8_t header = frame->front();
-    uint8_t src_addr = ((header & 0xF0) >> 4);
-    uint8_t dest_addr = (header & 0x0F);
+#ifdef USE_HDMI_CEC_TASK
+  // the CEC task runs the protocol: take what it passes on to the main loop
+  const uint32_t start_us = micros();
+  while (const Frame *queued = loop_frames_.front()) {
+    const Frame frame = *queued;
+    loop_frames_.push_front();
+    handle_frame_(frame);
+    if ((uint32_t) (micros() - start_us) >= loop_budget_us_) {
+      break;
+    }
+  }
+  TxCompletion completion;
+  while (tx_completions_.pop(completion)) {
+    completion.callback(completion.result, completion.index);
+  }
+#else
+  receive_frames_();
+#endif
 
-    if (!promiscuous_mode_ && (dest_addr != 0x0F) && (dest_addr != address_)) {
-      // ignore frames not meant for us, recycle frame buffer
-      frames_queue_.push_front();
-      continue;
+  if (bridge_target_ != nullptr) {
+    update_bridge_ack_mask_();
+  }
+  if (key_events_) {
+    KeyEvent events[KeyTracker::MAX_EVENTS];
+    size_t count = key_tracker_.expire(millis(), events, KeyTracker::MAX_EVENTS);
+    for (size_t i = 0; i < count; i++) {
+      dispatch_key_event_(events[i]);
     }
+  }
+  expire_queries_();
+#ifndef USE_HDMI_CEC_TASK
+  tx_timer_.poll();
+  process_transmit_();
+#endif
+#ifdef USE_HDMI_CEC_CAPTURE
+  drain_capture_();
+#endif
 
-    if (frame->size() == 1) {
-      // don't process pings. they're already dealt with by the acknowledgement mechanism
-      ESP_LOGV(TAG, "ping received: 0x%01X -> 0x%01X", src_addr, dest_addr);
+  // Nothing left to do until the next event: the interrupt handlers (received frame, end of a transmission),
+  // the CEC task and queue_frames_() enable the loop again. An event that comes in meanwhile is not lost, the
+  // loop runs again on the next main loop iteration.
+  if (!has_pending_work_()) {
+    disable_loop();
+  }
+}
+
+bool HDMICEC::has_pending_work_() {
+#ifdef USE_HDMI_CEC_RMT
+  if (rmt_receiver_) {
+    // the RMT frames are only decoded from the loop
+    return true;
+  }
+#endif
+  if (!OneShotTimer::IS_HARDWARE) {
+    // the software timer only expires from the loop
+    return true;
+  }
+  if (bridge_target_ != nullptr) {
+    // the acknowledge mask follows the devices heard on the target bus
+    return true;
+  }
+  if (key_events_ && key_tracker_.has_pressed_key()) {
+    return true;
+  }
+  for (const auto &query : pending_queries_) {
+    if (query.in_use) return true;
+  }
+#ifdef USE_HDMI_CEC_TASK
+  if (!loop_frames_.is_empty() || !tx_completions_.is_empty()) {
+    return true;
+  }
+#else
+  if (!frames_queue_.is_empty() || tx_active_ || tx_done_) {
+    return true;
+  }
+  {
+    LockGuard send_lock(send_mutex_);
+    if (!tx_queue_.is_empty()) return true;
+  }
+#endif
+#ifdef USE_HDMI_CEC_CAPTURE
+  if (!capture_.is_empty()) {
+    return true;
+  }
+#endif
+  return false;
+}
+
+#ifdef USE_HDMI_CEC_TASK
+void HDMICEC::task_loop_(void *arg) {
+  auto *self = static_cast<HDMICEC *>(arg);
+  self->receive_frames_();
+  self->tx_timer_.poll();
+  self->process_transmit_();
+}
+#endif
+
+void HDMICEC::receive_frames_() {
+#ifdef USE_HDMI_CEC_RMT
+  if (rmt_receiver_) {
+    // decode the frames captured by the RMT peripheral since the last run
+    LinePeriod periods[32];
+    while (size_t count = rmt_capture_.read(periods, 32)) {
+      receiver_.on_periods(periods, count, [this](Receiver::Event event) { handle_rx_event_(event); });
+    }
+  }
+#endif
+
+#ifndef USE_HDMI_CEC_TASK
+  const uint32_t start_us = micros();
+#endif
+  while (!frames_queue_.is_empty()) {
+    // take the received frame, and recycle its buffer right away
+    // (the lock keeps the interrupt handler from moving the queued frames meanwhile, see RxOverflowPolicy)
+    Frame frame;
+    uint32_t received_us;
+    {
+      CrossCoreLockGuard rx_lock(rx_lock_);
+      frame = *frames_queue_.front();
+      received_us = frames_queue_.front_time();
       frames_queue_.push_front();
+    }
+
+    if (bridge_target_ != nullptr) {
+      forward_frame_(frame, received_us);
+    }
+    reply_builtin_(frame);
+
+#ifdef USE_HDMI_CEC_TASK
+    Frame *queued = loop_frames_.back();
+    if (queued == nullptr) {
+      ESP_LOGW(TAG, "the main loop is late, a received frame was not passed on");
       continue;
     }
+    *queued = frame;
+    loop_frames_.push_back(received_us);
+    enable_loop_soon_any_context();
+#else
+    handle_frame_(frame);
+    if ((uint32_t) (micros() - start_us) >= loop_budget_us_) {
+      // leave the rest to the next loop run, so a burst of frames doesn't hold up the other components
+      break;
+    }
+#endif
+  }
+}
+
+void HDMICEC::reply_builtin_(const Frame &frame) {
+  const uint8_t src_addr = frame.initiator_addr();
+  const uint8_t dest_addr = frame.destination_addr();
+  if (frame.size() == 1 || dest_addr == 0xF || dest_addr != address_) {
+    return;
+  }
+  const Payload data = frame.payload();
+  if (key_events_ && KeyTracker::is_key_message(data)) {
+    // reported as key events
+    return;
+  }
+  // If no on_message trigger handles this message, we try to run the built-in handlers
+  if (!dispatch_message_(src_addr, dest_addr, data, false)) {
+    try_builtin_handler_(src_addr, dest_addr, data);
+  }
+}
 
-    ESP_LOGD(TAG, "[received] %s", frame->to_string().c_str());
+void HDMICEC::handle_frame_(const Frame &frame) {
+  // decoded at most once, shared by the cache, the log and the on_decoded_message triggers
+  LazyMessage message(frame);
+  if (DeviceCache::learns_from(frame)) {
+    device_cache_.update(message.get(), millis());
+  } else {
+    device_cache_.update(frame, millis());
+  }
 
-    std::vector<uint8_t> data(frame->begin() + 1, frame->end());
+  uint8_t src_addr = frame.initiator_addr();
+  uint8_t dest_addr = frame.destination_addr();
 
-    // recycle received frame buffer
-    frames_queue_.push_front();
+  if (!promiscuous_mode_ && (dest_addr != 0x0F) && (dest_addr != address_)) {
+    // ignore frames not meant for us
+    return;
+  }
 
-    // Process on_message triggers
-    bool handled_by_trigger = false;
-    uint8_t opcode = data[0];
+  if (frame.size() == 1) {
+    // don't process pings. they're already dealt with by the acknowledgement mechanism
+    ESP_LOGV(TAG, "ping received: 0x%01X -> 0x%01X", src_addr, dest_addr);
+    return;
+  }
+
+  const Payload data = frame.payload();
+
+  if (key_events_ && KeyTracker::is_key_message(data)) {
+    // coalesced into key events, instead of a dispatch (and a Feature Abort) per repeated key message
+    KeyEvent events[KeyTracker::MAX_EVENTS];
+    size_t count = key_tracker_.on_message(src_addr, data, millis(), events);
+    for (size_t i = 0; i < count; i++) {
+      dispatch_key_event_(events[i]);
+    }
+    return;
+  }
+
+  if (!decoded_message_triggers_.empty()) {
+    // decode before the log, so it doesn't decode a second time
+    message.get();
+  }
+  log_frame("received", frame, message.decoded());
+  match_queries_(src_addr, dest_addr, data);
+
+  // Process on_message triggers
+  dispatch_message_(src_addr, dest_addr, data, true);
+  if (!decoded_message_triggers_.empty()) {
+    const DecodedMessage &decoded = message.get();
+    for (auto *trigger : decoded_message_triggers_) {
+      if (trigger->matches(decoded)) trigger->trigger(decoded);
+    }
+  }
+  message_callbacks_.call(src_addr, dest_addr, data);
+}
+
+bool MessageTrigger::matches(uint8_t source, uint8_t destination, const Payload &data) const {
+  return (
+    ((source_mask_ >> source) & 0b1) &&
+    ((destination_mask_ >> destination) & 0b1) &&
+    (!opcode_.has_value() || (opcode_ == data[0])) &&
+    (!data_.has_value() || (*data_ == data))
+  );
+}
+
+bool HDMICEC::dispatch_message_(uint8_t source, uint8_t destination, const Payload &data, bool run_triggers) {
+  bool handled = false;
+  if (dispatch_index_ == nullptr) {
     for (auto trigger : message_triggers_) {
-      bool can_trigger = (
-        (!trigger->source_.has_value()      || (trigger->source_ == src_addr)) &&
-        (!trigger->destination_.has_value() || (trigger->destination_ == dest_addr)) &&
-        (!trigger->opcode_.has_value()      || (trigger->opcode_ == opcode)) &&
-        (!trigger->data_.has_value() ||
-          (data.size() == trigger->data_->size() && std::equal(trigger->data_->begin(), trigger->data_->end(), data.begin()))
-        )
-      );
-      if (can_trigger) {
-        trigger->trigger(src_addr, dest_addr, data);
-        handled_by_trigger = true;
+      if (trigger->matches(source, destination, data)) {
+        if (!run_triggers) {
+          return true;
+        }
+        trigger->trigger(source, destination, data);
+        handled = true;
       }
     }
+    return handled;
+  }
 
-    // If nothing in on_message handled this message, we try to run the built-in handlers
-    bool is_directly_addressed = (dest_addr != 0xF && dest_addr == address_);
-    if (is_directly_addressed && !handled_by_trigger) {
-      try_builtin_handler_(src_addr, dest_addr, data);
+  // only visit the triggers for this opcode, and those that accept any opcode,
+  // merged by their position in the trigger list to keep the order of declaration
+  uint8_t opcode = data[0];
+  uint16_t i = progmem_read_uint16(&dispatch_index_[opcode]);
+  const uint16_t i_end = progmem_read_uint16(&dispatch_index_[opcode + 1]);
+  uint16_t w = progmem_read_uint16(&dispatch_index_[256]);
+  const uint16_t w_end = dispatch_count_;
+  while (i < i_end || w < w_end) {
+    uint16_t next_i = (i < i_end) ? progmem_read_uint16(&dispatch_order_[i]) : 0xFFFF;
+    uint16_t next_w = (w < w_end) ? progmem_read_uint16(&dispatch_order_[w]) : 0xFFFF;
+    uint16_t trigger_index;
+    if (next_i < next_w) {
+      trigger_index = next_i;
+      i++;
+    } else {
+      trigger_index = next_w;
+      w++;
+    }
+    if (trigger_index >= message_triggers_.size()) {
+      continue;
+    }
+    MessageTrigger *trigger = message_triggers_[trigger_index];
+    if (trigger->matches(source, destination, data)) {
+      if (!run_triggers) {
+        return true;
+      }
+      trigger->trigger(source, destination, data);
+      handled = true;
+    }
+  }
+  // the triggers added after the tables were generated
+  for (size_t t = dispatch_count_; t < message_triggers_.size(); t++) {
+    MessageTrigger *trigger = message_triggers_[t];
+    if (trigger->matches(source, destination, data)) {
+      if (!run_triggers) {
+        return true;
+      }
+      trigger->trigger(source, destination, data);
+      handled = true;
     }
   }
+  return handled;
+}
+
+void HDMICEC::dispatch_key_event_(const KeyEvent &event) {
+  switch (event.type) {
+    case KeyEvent::Type::Press:
+      ESP_LOGD(TAG, "key 0x%02X pressed on 0x%X", event.key, event.source);
+      for (auto *trigger : key_press_triggers_) {
+        if (trigger->matches(event)) trigger->trigger(event.source, event.key);
+      }
+      break;
+    case KeyEvent::Type::Hold:
+      ESP_LOGV(TAG, "key 0x%02X held on 0x%X: %u repeats, %u ms", event.key, event.source,
+               (unsigned) event.repeat_count, (unsigned) event.held_ms);
+      for (auto *trigger : key_hold_triggers_) {
+        if (trigger->matches(event)) trigger->trigger(event.source, event.key, event.repeat_count, event.held_ms);
+      }
+      break;
+    case KeyEvent::Type::Release:
+      ESP_LOGD(TAG, "key 0x%02X released on 0x%X after %u ms", event.key, event.source, (unsigned) event.held_ms);
+      for (auto *trigger : key_release_triggers_) {
+        if (trigger->matches(event)) trigger->trigger(event.source, event.key, event.held_ms);
+      }
+      break;
+  }
 }
 
 uint8_t logical_address_to_device_type(uint8_t logical_address) {
@@ -172,7 +481,86 @@ uint8_t logical_address_to_device_type(uint8_t logical_address) {
   }
 }
 
-void HDMICEC::try_builtin_handler_(uint8_t source, uint8_t destination, const std::vector<uint8_t> &data) {
+void HDMICEC::report_physical_address_() {
+  // broadcast "Report Physical Address" (0x84)
+  const uint8_t device_type = allocate_address_ ? (uint8_t) device_type_ : logical_address_to_device_type(address_);
+  send(message::report_physical_address(address_, physical_address_, device_type), nullptr, TxPriority::High);
+}
+
+// logical addresses to try for each device type, in order of preference (HDMI CEC spec, "Logical Addressing")
+static const uint8_t TV_ADDRESSES[] = {0x0, 0xE};
+static const uint8_t RECORDING_ADDRESSES[] = {0x1, 0x2, 0x9};
+static const uint8_t TUNER_ADDRESSES[] = {0x3, 0x6, 0x7, 0xA};
+static const uint8_t PLAYBACK_ADDRESSES[] = {0x4, 0x8, 0xB};
+static const uint8_t AUDIO_SYSTEM_ADDRESSES[] = {0x5};
+
+static const uint8_t *candidate_addresses(DeviceType device_type, size_t &count) {
+  switch (device_type) {
+    case DeviceType::TV:
+      count = sizeof(TV_ADDRESSES);
+      return TV_ADDRESSES;
+    case DeviceType::Recording:
+      count = sizeof(RECORDING_ADDRESSES);
+      return RECORDING_ADDRESSES;
+    case DeviceType::Tuner:
+      count = sizeof(TUNER_ADDRESSES);
+      return TUNER_ADDRESSES;
+    case DeviceType::AudioSystem:
+      count = sizeof(AUDIO_SYSTEM_ADDRESSES);
+      return AUDIO_SYSTEM_ADDRESSES;
+    default:
+      count = sizeof(PLAYBACK_ADDRESSES);
+      return PLAYBACK_ADDRESSES;
+  }
+}
+
+void HDMICEC::allocate_address() {
+  // stay silent as 'unregistered' until an address is found
+  set_address(0xF);
+  allocation_index_ = 0;
+  allocation_failures_ = 0;
+  poll_next_address_();
+}
+
+void HDMICEC::poll_next_address_() {
+  size_t count;
+  const uint8_t *candidates = candidate_addresses(device_type_, count);
+  if (allocation_index_ >= count) {
+    ESP_LOGW(TAG, "all logical addresses for this device type are taken, staying unregistered (0xF)");
+    report_physical_address_();
+    return;
+  }
+  // a polling message is a header block alone, with the candidate address as both initiator and destination
+  const uint8_t candidate = candidates[allocation_index_];
+  const Frame poll = message::poll(candidate, candidate);
+  SendCallback callback = [this, candidate](SendResult result) { handle_poll_result_(candidate, result); };
+  if (!queue_frames_(&poll, 1, std::move(callback), TxPriority::High, 0, POLL_ATTEMPTS)) {
+    ESP_LOGE(TAG, "could not queue the poll of logical address 0x%X", candidate);
+  }
+}
+
+void HDMICEC::handle_poll_result_(uint8_t candidate, SendResult result) {
+  if (result == SendResult::NoAck) {
+    // nobody answers to this address: it's ours
+    ESP_LOGI(TAG, "allocated logical address 0x%X", candidate);
+    set_address(candidate);
+    report_physical_address_();
+    return;
+  }
+  if (result == SendResult::Success) {
+    ESP_LOGD(TAG, "logical address 0x%X is taken", candidate);
+    allocation_index_++;
+    allocation_failures_ = 0;
+  } else if (++allocation_failures_ >= MAX_POLL_FAILURES) {
+    // the bus is too busy to tell: skip this candidate rather than risk a conflict
+    ESP_LOGW(TAG, "could not poll logical address 0x%X: %s", candidate, send_result_to_string(result));
+    allocation_index_++;
+    allocation_failures_ = 0;
+  }
+  poll_next_address_();
+}
+
+void HDMICEC::try_builtin_handler_(uint8_t source, uint8_t destination, const Payload &data) {
   if (data.empty()) {
     return;
   }
@@ -181,37 +569,29 @@ void HDMICEC::try_builtin_handler_(uint8_t source, uint8_t destination, const st
   switch (opcode) {
     // "Get CEC Version" request
     case 0x9F: {
-      // reply with "CEC Version" (0x9E)
-      send(address_, source, {0x9E, 0x04});
+      // reply with "CEC Version" (0x9E): 1.3a
+      send(message::cec_version(address_, source, 0x04), nullptr, TxPriority::High);
       break;
     }
 
     // "Give Device Power Status" request
     case 0x8F: {
       // reply with "Report Power Status" (0x90)
-      send(address_, source, {0x90, 0x00}); // "On"
+      send(message::report_power_status(address_, source, 0x00), nullptr, TxPriority::High);  // "On"
       break;
     }
 
     // "Give OSD Name" request
     case 0x46: {
       // reply with "Set OSD Name" (0x47)
-      std::vector<uint8_t> data = { 0x47 };
-      data.insert(data.end(), osd_name_bytes_.begin(), osd_name_bytes_.end());
-      send(address_, source, data);
+      send(message::set_osd_name(address_, source, osd_name_bytes_.data(), osd_name_bytes_.size()), nullptr,
+           TxPriority::High);
       break;
     }
 
     // "Give Physical Address" request
     case 0x83: {
-      // reply with "Report Physical Address" (0x84)
-      auto physical_address_bytes = decode_value(physical_address_);
-      std::vector<uint8_t> data = { 0x84 };
-      data.insert(data.end(), physical_address_bytes.begin(), physical_address_bytes.end());
-      // Device Type
-      data.push_back(logical_address_to_device_type(address_));
-      // Broadcast Physical Address
-      send(address_, 0xF, data);
+      report_physical_address_();
       break;
     }
 
@@ -222,301 +602,672 @@ void HDMICEC::try_builtin_handler_(uint8_t source, uint8_t destination, const st
 
     // default case (no built-in handler + no on_message handler) => message not supported => send "Feature Abort"
     default:
-      send(address_, source, {0x00, opcode, 0x00});
+      // "Unrecognized opcode"
+      send(message::feature_abort(address_, source, opcode, 0x00), nullptr, TxPriority::High);
       break;
   }
 }
 
-bool HDMICEC::send(uint8_t source, uint8_t destination, const std::vector<uint8_t> &data_bytes) {
+bool HDMICEC::send(uint8_t source, uint8_t destination, const std::vector<uint8_t> &data_bytes,
+                   SendCallback callback, TxPriority priority, uint32_t max_delay_ms) {
+  if (data_bytes.size() >= Frame::MAX_LENGTH) {
+    ESP_LOGE(TAG, "HDMICEC::send(): frame too long (%u bytes of data)", (unsigned) data_bytes.size());
+    return false;
+  }
+
+  return send(Frame(source, destination, data_bytes), std::move(callback), priority, max_delay_ms);
+}
+
+bool HDMICEC::send(uint8_t source, uint8_t destination, std::initializer_list<uint8_t> data, SendCallback callback,
+                   TxPriority priority, uint32_t max_delay_ms) {
+  if (data.size() >= Frame::MAX_LENGTH) {
+    ESP_LOGE(TAG, "HDMICEC::send(): frame too long (%u bytes of data)", (unsigned) data.size());
+    return false;
+  }
+  return send(Frame(source, destination, data.begin(), data.size()), std::move(callback), priority, max_delay_ms);
+}
+
+bool HDMICEC::send(uint8_t source, uint8_t destination, const Payload &data, SendCallback callback,
+                   TxPriority priority, uint32_t max_delay_ms) {
+  return send(Frame(source, destination, data), std::move(callback), priority, max_delay_ms);
+}
+
+bool HDMICEC::send(const Frame &frame, SendCallback callback, TxPriority priority, uint32_t max_delay_ms) {
+  if (monitor_mode_) return false;
+
+  return queue_frames_(&frame, 1, TxCallback(std::move(callback)), priority, max_delay_ms, Transmitter::MAX_ATTEMPTS);
+}
+
+bool HDMICEC::send_sequence(const std::vector<Frame> &frames, SequenceCallback callback, TxPriority priority,
+                            uint32_t max_delay_ms) {
+  return send_sequence(frames.data(), frames.size(), std::move(callback), priority, max_delay_ms);
+}
+
+bool HDMICEC::send_sequence(const Frame *frames, size_t count, SequenceCallback callback, TxPriority priority,
+                            uint32_t max_delay_ms) {
   if (monitor_mode_) return false;
 
-  bool is_broadcast = (destination == 0xF);
+  if (count == 0 || count > MAX_SEQUENCE_LENGTH) {
+    ESP_LOGE(TAG, "HDMICEC::send_sequence(): %u frames, 1 to %u supported", (unsigned) count,
+             (unsigned) MAX_SEQUENCE_LENGTH);
+    return false;
+  }
+  return queue_frames_(frames, count, TxCallback(std::move(callback)), priority, max_delay_ms,
+                       Transmitter::MAX_ATTEMPTS);
+}
 
-  // prepare the bytes to send
-  Frame frame(source, destination, data_bytes);
-  ESP_LOGD(TAG, "[sending] %s", frame.to_string().c_str());
+bool HDMICEC::queue_frames_(const Frame *frames, size_t count, TxCallback callback, TxPriority priority,
+                            uint32_t max_delay_ms, uint8_t max_attempts, BridgeStats *bridge_stats,
+                            uint32_t received_us) {
+  TxRequest request;
+  std::copy(frames, frames + count, request.frames.begin());
+  request.num_frames = count;
+  request.callback = std::move(callback);
+  request.priority = priority;
+  request.has_deadline = (max_delay_ms > 0);
+  request.deadline_ms = millis() + max_delay_ms;
+  request.max_attempts = max_attempts;
+  request.bridge_stats = bridge_stats;
+  request.received_us = received_us;
+  // the loop transmits (without the CEC task), or waits for the result of a query
+  enable_loop_soon_any_context();
+
+#ifdef USE_HDMI_CEC_TASK
+  if (!task_->is_current()) {
+    // the CEC task owns the transmit queue: hand the request over (one sending thread at a time)
+    bool submitted;
+    {
+      LockGuard submit_lock(submit_mutex_);
+      submitted = tx_submit_.push(std::move(request));
+    }
+    if (!submitted) {
+      ESP_LOGW(TAG, "HDMICEC::send(): transmit queue full, frame dropped");
+      return false;
+    }
+    task_->notify();
+    return true;
+  }
+#endif
+  return enqueue_(std::move(request));
+}
 
+bool HDMICEC::enqueue_(TxRequest &&incoming) {
+  TxCallback dropped_callback;
   {
+#ifndef USE_HDMI_CEC_TASK
     LockGuard send_lock(send_mutex_);
-    // Bus 'Signal Free' time between transmissions, according to the HDMI-CEC standard, shall be a minimum of:
-    //  - 7 bit periods between successive transmissions of same sender
-    //  - 5 bit periods between transmissions of different senders
-    //  - 3 bit periods for resend of a failed transmission attempt
-    uint8_t free_bit_periods = (last_sent_us_ > last_falling_edge_us_) ? 7 : 5;
-
-    // Total timeout: abort if we can't send within 2 seconds (prevents infinite blocking on busy bus)
-    static const uint32_t SEND_TIMEOUT_US = 2000000;
-    const uint32_t send_start_us = micros();
-
-    for (size_t i = 0; i < MAX_ATTEMPTS; i++) {
-      int32_t delay = 0;
-      // Per-attempt timeout for bus-free wait: 200ms max per attempt
-      const uint32_t attempt_start_us = micros();
-      static const uint32_t ATTEMPT_TIMEOUT_US = 200000;
-
-      while ((delay = free_bit_periods * TOTAL_BIT_US + std::max(last_sent_us_, (uint32_t) last_falling_edge_us_) - micros()) > 0) {
-        // Check total timeout
-        if ((micros() - send_start_us) > SEND_TIMEOUT_US) {
-          ESP_LOGW(TAG, "HDMICEC::send(): total timeout reached (2s), aborting");
-          return false;
-        }
-        // Check per-attempt timeout (bus constantly busy)
-        if ((micros() - attempt_start_us) > ATTEMPT_TIMEOUT_US) {
-          ESP_LOGW(TAG, "HDMICEC::send(): attempt %d bus-wait timeout (200ms), retrying", i + 1);
-          break;
-        }
-        ESP_LOGV(TAG, "HDMICEC::send(): waiting %d usec for bus free period", delay);
-        if (delay >= (int32_t) YIELD_INTERVAL_US) {
-          delay_microseconds_safe(YIELD_INTERVAL_US);
-          yield();
-        } else {
-          delay_microseconds_safe(delay);
-        }
-        // Note: during this delay, the 'last_falling_edge_us_' might be incremented by 'gpio_intr_', requiring further wait
-        free_bit_periods = 5;
-      }
+#endif
 
-      // Skip frame send if we broke out due to per-attempt timeout
-      if ((micros() - attempt_start_us) > ATTEMPT_TIMEOUT_US) {
-        free_bit_periods = 3;
-        yield();
-        continue;
+    // merge with an identical pending frame, unless both want to know about their own outcome
+    TxRequest *request = (incoming.num_frames == 1) ? tx_queue_.find(incoming.frames[0]) : nullptr;
+    if (request != nullptr && !(request->callback && incoming.callback)) {
+      if (!request->callback) {
+        request->callback = std::move(incoming.callback);
       }
+      if (request->bridge_stats == nullptr) {
+        request->bridge_stats = incoming.bridge_stats;
+        request->received_us = incoming.received_us;
+      }
+      if (incoming.priority > request->priority) {
+        request->priority = incoming.priority;
+      }
+      if (!incoming.has_deadline) {
+        request->has_deadline = false;
+      } else if (request->has_deadline && (int32_t) (incoming.deadline_ms - request->deadline_ms) > 0) {
+        request->deadline_ms = incoming.deadline_ms;
+      }
+      ESP_LOGV(TAG, "HDMICEC::send(): merged with identical pending frame");
+      return true;
+    }
 
-      ESP_LOGV(TAG, "HDMICEC::send(): bus available, sending frame...");
-
-      auto result = send_frame_(frame, is_broadcast);
-      if (result == SendResult::Success) {
-        ESP_LOGD(TAG, "frame sent and acknowledged");
-        return true;
+    request = tx_queue_.acquire();
+    if (request == nullptr) {
+      // queue full: make room by dropping the most recent frame of a lower priority
+      TxRequest *victim = tx_queue_.back();
+      if (victim == nullptr || victim->priority >= incoming.priority) {
+        ESP_LOGW(TAG, "HDMICEC::send(): transmit queue full, frame dropped");
+        return false;
       }
-      ESP_LOGI(TAG, "HDMICEC::send(): frame not sent: %s",
-               ((result == SendResult::BusCollision) ? "Bus Collision" : "No Ack received"));
-      // attempt retransmission with smaller free time gap
-      free_bit_periods = 3;
-      yield();
+      dropped_callback = std::move(victim->callback);
+      if (victim->bridge_stats != nullptr) {
+        victim->bridge_stats->failed++;
+      }
+      tx_queue_.release(victim);
+      request = victim;
     }
+    *request = std::move(incoming);
+    tx_queue_.push(request);
   }
 
-  ESP_LOGE(TAG, "HDMICEC::send(): send failed after %d attempts", MAX_ATTEMPTS);
-  return false;
+  report_tx_result_(std::move(dropped_callback), SendResult::Dropped, 0);
+  return true;
 }
 
-SendResult HDMICEC::send_frame_(const Frame &frame, bool is_broadcast) {
-  pin_->detach_interrupt();  // do NOT listen for pin changes while sending
-  auto result = SendResult::Success;
-
-  bool success = send_start_bit_();
+void HDMICEC::report_tx_result_(TxCallback &&callback, SendResult result, size_t index) {
+  if (!callback) {
+    return;
+  }
+#ifdef USE_HDMI_CEC_TASK
+  if (task_->is_current()) {
+    // callbacks run in the main loop, like the automations they trigger
+    if (!tx_completions_.push(TxCompletion{std::move(callback), result, index})) {
+      ESP_LOGE(TAG, "the main loop is late, a transmit result was lost");
+    }
+    enable_loop_soon_any_context();
+    return;
+  }
+#endif
+  callback(result, index);
+}
 
-  // for each byte of the frame:
-  for (auto it = frame.begin(); it != frame.end(); ++it) {
-    uint8_t current_byte = *it;
+void HDMICEC::forward_frame_(Frame frame, uint32_t received_us) {
+  const uint8_t destination = frame.destination_addr();
+  if (frame.size() == 1 || destination == address_) {
+    // pings are answered by the acknowledgement of this bus already
+    return;
+  }
+  if (!frame.is_broadcast() && !((bridge_ack_mask_ >> destination) & 1)) {
+    // for a device of this bus
+    return;
+  }
+  if (!bridge_rules_.apply(frame)) {
+    bridge_stats_.filtered++;
+    ESP_LOGV(TAG, "bridge: frame 0x%02X filtered", frame.opcode());
+    return;
+  }
+  // the frame keeps its initiator: the target bus sends it in its name
+  if (!bridge_target_->queue_frames_(&frame, 1, nullptr, TxPriority::Normal, 0, Transmitter::MAX_ATTEMPTS,
+                                     &bridge_stats_, received_us)) {
+    bridge_stats_.failed++;
+  }
+}
 
-    // 1. send the current byte
-    for (int8_t i = 7; (i >= 0) && success; i--) {
-      bool bit_value = ((current_byte >> i) & 0b1);
-      if ((it == frame.begin()) && i >= 4 && bit_value) {
-        // my initiator address bit is 1: test for bus collision
-        // see the specification in the HDMI standard, section "CEC Arbitration"
-        success = send_high_and_test_();
-      } else {
-        send_bit_(bit_value);
-      }
+void HDMICEC::update_bridge_ack_mask_() {
+  // acknowledge for the devices heard on the target bus, unless they are on this bus too
+  const DeviceCache &target_devices = bridge_target_->device_cache();
+  uint16_t mask = 0;
+  for (uint8_t address = 0; address < 0xF; address++) {
+    if (address != address_ && target_devices.device(address).seen.known &&
+        !device_cache_.device(address).seen.known) {
+      mask |= 1 << address;
     }
+  }
+  if (mask == bridge_ack_mask_) {
+    return;
+  }
+  ESP_LOGD(TAG, "bridge: acknowledging frames for the devices 0x%04X of the target bus", mask);
+  bridge_ack_mask_ = mask;
+  InterruptLock interrupt_lock;
+  receiver_.set_ack_mask(mask);
+}
 
-    if (!success) {
-      // immediatly stop sending bits due to bus collision:
-      // the other concurrent initiator with lower address might not have detected the conflict
-      result = SendResult::BusCollision;
+bool HDMICEC::refresh_cached(uint8_t address, CacheField field, uint32_t max_age_ms) {
+  const uint32_t now = millis();
+  if (device_cache_.is_fresh(address, field, now, max_age_ms)) {
+    return true;
+  }
+  CachedValue<bool> &query = device_cache_.query(address, field);
+  if (query.is_fresh(now, CACHE_QUERY_INTERVAL_MS)) {
+    // asked already, the reply may still come
+    return false;
+  }
+  uint8_t opcode;
+  switch (field) {
+    case CacheField::PhysicalAddress:
+      opcode = 0x83;  // "Give Physical Address"
+      break;
+    case CacheField::VendorId:
+      opcode = 0x8C;  // "Give Device Vendor ID"
+      break;
+    case CacheField::OsdName:
+      opcode = 0x46;  // "Give OSD Name"
+      break;
+    case CacheField::PowerStatus:
+      opcode = 0x8F;  // "Give Device Power Status"
+      break;
+    case CacheField::CecVersion:
+      opcode = 0x9F;  // "Get CEC Version"
+      break;
+    case CacheField::ActiveSource:
+      opcode = 0x85;  // "Request Active Source", broadcast
+      address = 0xF;
+      break;
+    default:
+      return false;
+  }
+  if (send(address_, address, {opcode})) {
+    query.set(true, now);
+  }
+  return false;
+}
+
+bool HDMICEC::query(uint8_t destination, const std::vector<uint8_t> &data_bytes, uint8_t reply_opcode,
+                    uint32_t timeout_ms, QueryCallback callback) {
+  if (data_bytes.empty()) {
+    ESP_LOGE(TAG, "HDMICEC::query(): no opcode to send");
+    return reject_query_();
+  }
+  PendingQuery *query = nullptr;
+  for (auto &slot : pending_queries_) {
+    if (!slot.in_use) {
+      query = &slot;
       break;
     }
+  }
+  if (query == nullptr) {
+    ESP_LOGW(TAG, "HDMICEC::query(): too many queries waiting for a reply");
+    return reject_query_();
+  }
 
-    // 2. send EOM bit (logic 1 if this is the last byte of the frame)
-    bool is_eom = (it == (frame.end() - 1));
-    send_bit_(is_eom);
+  const uint32_t id = next_query_id_++;
+  auto send_callback = [this, id](SendResult result) {
+    if (result == SendResult::Success) {
+      return;
+    }
+    for (auto &query : pending_queries_) {
+      if (query.in_use && query.id == id) {
+        finish_query_(query, QueryResult::SendFailed, Payload());
+      }
+    }
+  };
+  if (!send(address_, destination, data_bytes, send_callback, TxPriority::Normal, timeout_ms)) {
+    return reject_query_();
+  }
+  query->callback = std::move(callback);
+  query->id = id;
+  query->deadline_ms = millis() + timeout_ms;
+  query->destination = destination;
+  query->request_opcode = data_bytes[0];
+  query->reply_opcode = reply_opcode;
+  query->in_use = true;
+  return true;
+}
 
-    // 3. send ack bit and test bit value from destination(s)
-    bool value = send_high_and_test_();
-    success = (value == is_broadcast);  // 'no broadcast' should give a 'false' signal value as 'ack'
-    if (!success) {
-      result = SendResult::NoAck;
-      break;
+void HDMICEC::match_queries_(uint8_t source, uint8_t destination, const Payload &data) {
+  // a reply comes from the queried device, and is addressed to us (or broadcast, for the broadcast replies); in
+  // promiscuous mode, the replies to the queries of other devices come in too
+  if (destination != address_ && destination != 0xF) {
+    return;
+  }
+  const uint8_t opcode = data[0];
+  if (opcode == 0x00 && (data.size() < 3 || destination == 0xF)) {
+    // a malformed "Feature Abort": no reason, or broadcast
+    return;
+  }
+  for (auto &query : pending_queries_) {
+    if (!query.in_use || (query.destination != 0xF && query.destination != source)) {
+      continue;
+    }
+    if (opcode == query.reply_opcode) {
+      finish_query_(query, QueryResult::Reply, data);
+    } else if (opcode == 0x00 && data[1] == query.request_opcode) {
+      finish_query_(query, QueryResult::FeatureAbort, data);
     }
   }
-  // capture last bus busy time also for bus writes (with interrupts off)
-  last_sent_us_ = micros();
-  pin_->attach_interrupt(HDMICEC::gpio_intr_, this, gpio::INTERRUPT_ANY_EDGE);
-  return result;
 }
 
-bool HDMICEC::send_start_bit_() {
-  // 1. pull low for 3700 us
-  set_pin_output_low();
-  delay_microseconds_safe(3700);
+void HDMICEC::expire_queries_() {
+  const uint32_t now = millis();
+  for (auto &query : pending_queries_) {
+    if (query.in_use && (int32_t) (now - query.deadline_ms) >= 0) {
+      finish_query_(query, QueryResult::Timeout, Payload());
+    }
+  }
+}
 
-  // 2. pull high for 800 us
-  set_pin_input_high();
-  delay_microseconds_safe(400);
+bool HDMICEC::reject_query_() {
+  last_query_result_ = QueryResult::SendFailed;
+  last_query_reply_.clear();
+  return false;
+}
 
-  // check half-way the 'high' interval for no collision
-  bool value = pin_->digital_read();
+void HDMICEC::finish_query_(PendingQuery &query, QueryResult result, const Payload &data) {
+  // free the slot first: the callback may start another query
+  QueryCallback callback = std::move(query.callback);
+  query.callback = nullptr;
+  query.in_use = false;
+  last_query_result_ = result;
+  last_query_reply_ = data;
+  if (callback) {
+    callback(result, data);
+  }
+}
 
-  // check at end of 'high' interval for no collision
-  delay_microseconds_safe(400);
-  value &= pin_->digital_read();
+void HDMICEC::dump_edge_trace() {
+#ifdef USE_HDMI_CEC_EDGE_TRACE
+  if (!edge_trace_.is_enabled()) {
+    ESP_LOGW(TAG, "edge trace is not enabled on this bus, see 'edge_trace_size'");
+    return;
+  }
+  edge_trace_.set_paused(true);
+  const size_t total = edge_trace_.serialized_size();
+  ESP_LOGI(TAG, "edge trace: %u edges, %u bytes", (unsigned) edge_trace_.count(), (unsigned) total);
+  uint8_t chunk[64];
+  char line[2 * sizeof(chunk) + 1];
+  for (size_t offset = 0; offset < total;) {
+    size_t length = edge_trace_.serialize(offset, chunk, sizeof(chunk));
+    for (size_t i = 0; i < length; i++) {
+      snprintf(line + 2 * i, 3, "%02X", chunk[i]);
+    }
+    ESP_LOGI(TAG, "edge trace %06X: %s", (unsigned) offset, line);
+    offset += length;
+  }
+  edge_trace_.set_paused(false);
+#else
+  ESP_LOGW(TAG, "edge trace is not enabled, see 'edge_trace_size'");
+#endif
+}
 
-  // total duration of start bit: 4500 us
-  // No other initiator tried to 'start' concurrently by pulling the pin low?
-  bool success = (value == true);
-  return success;
+#ifdef USE_HDMI_CEC_CAPTURE
+void HDMICEC::drain_capture_() {
+  if (capture_sink_ == nullptr) {
+    return;
+  }
+  // hand the records to the sink in batches, to keep the per-write overhead of the sink low
+  uint8_t batch[8 * capture::MAX_RECORD_SIZE];
+  size_t length = 0;
+  CaptureRecord record;
+  for (size_t i = 0; i < capture_.size(); i++) {
+    if (!capture_.pop(record)) {
+      break;
+    }
+    if (length + capture::MAX_RECORD_SIZE > sizeof(batch)) {
+      capture_sink_->write(batch, length);
+      length = 0;
+    }
+    length += record.serialize(batch + length);
+  }
+  if (length > 0) {
+    capture_sink_->write(batch, length);
+  }
+  uint32_t dropped = capture_.dropped();
+  if (dropped != capture_dropped_reported_) {
+    ESP_LOGW(TAG, "frame capture: %u records dropped, the ring is too small",
+             (unsigned) (dropped - capture_dropped_reported_));
+    capture_dropped_reported_ = dropped;
+  }
 }
+#endif
 
-void HDMICEC::send_bit_(bool bit_value) {
-  // total bit duration:
-  // logic 1: pull low for 600 us, then pull high for 1800 us
-  // logic 0: pull low for 1500 us, then pull high for 900 us
+void HDMICEC::process_transmit_() {
+  if (tx_done_) {
+    // the transmitter finished: report the result outside of the timer context
+    SendResult result = transmitter_.result();
+    size_t index = tx_frame_index_;
+    if (result == SendResult::Success) {
+      ESP_LOGD(TAG, "frame sent and acknowledged");
+    } else if (tx_current_.num_frames > 1) {
+      ESP_LOGE(TAG, "HDMICEC::send_sequence(): frame %u of %u failed after %u attempts: %s", (unsigned) index + 1,
+               tx_current_.num_frames, transmitter_.attempts(), send_result_to_string(result));
+    } else {
+      ESP_LOGE(TAG, "HDMICEC::send(): send failed after %u attempts: %s", transmitter_.attempts(),
+               send_result_to_string(result));
+    }
+    if (tx_current_.bridge_stats != nullptr) {
+      BridgeStats &stats = *tx_current_.bridge_stats;
+      if (result == SendResult::Success) {
+        stats.forwarded++;
+      } else {
+        stats.failed++;
+      }
+      if (tx_started_) {
+        stats.record_latency(tx_started_us_ - tx_current_.received_us);
+      }
+    }
+    TxCallback callback = std::move(tx_current_.callback);
+    tx_current_.callback = nullptr;
+    tx_done_ = false;
+    tx_active_ = false;
+    report_tx_result_(std::move(callback), result, index);
+  }
 
-  const uint32_t low_duration_us = (bit_value ? HIGH_BIT_US : LOW_BIT_US);
-  const uint32_t high_duration_us = (TOTAL_BIT_US - low_duration_us);
+#ifdef USE_HDMI_CEC_TASK
+  TxRequest submitted;
+  while (tx_submit_.pop(submitted)) {
+    if (!enqueue_(std::move(submitted))) {
+      // the sender was already told the frame was accepted: a rejected request keeps its callback
+      report_tx_result_(std::move(submitted.callback), SendResult::Dropped, 0);
+    }
+  }
+#endif
 
-  set_pin_output_low();
-  delay_microseconds_safe(low_duration_us);
-  set_pin_input_high();
-  delay_microseconds_safe(high_duration_us);
-}
+  if (tx_active_) {
+    // still sending: the timer drives the transmission
+    return;
+  }
+  while (!tx_active_) {
+    TxCallback expired_callback;
+    {
+#ifndef USE_HDMI_CEC_TASK
+      LockGuard send_lock(send_mutex_);
+#endif
+      TxRequest *request = tx_queue_.front();
+      if (request == nullptr) {
+        return;
+      }
+      if (request->has_deadline && (int32_t) (millis() - request->deadline_ms) > 0) {
+        expired_callback = std::move(request->callback);
+      } else {
+        tx_current_.frames = request->frames;
+        tx_current_.num_frames = request->num_frames;
+        tx_current_.callback = std::move(request->callback);
+        tx_current_.max_attempts = request->max_attempts;
+        tx_current_.bridge_stats = request->bridge_stats;
+        tx_current_.received_us = request->received_us;
+        tx_active_ = true;
+      }
+      tx_queue_.release(request);
+    }
+    if (!tx_active_) {
+      ESP_LOGD(TAG, "HDMICEC::send(): frame dropped, its deadline passed");
+      report_tx_result_(std::move(expired_callback), SendResult::Expired, 0);
+    }
+  }
 
-bool HDMICEC::send_high_and_test_() {
-  uint32_t start_us = micros();
+  for (size_t i = 0; i < tx_current_.num_frames; i++) {
+    log_frame("sending", tx_current_.frames[i]);
+  }
+  CrossCoreLockGuard tx_lock(tx_lock_);
+  const Frame &frame = tx_current_.frames[0];
+  tx_frame_index_ = 0;
+  tx_started_ = false;
+  transmitter_.start(frame.data(), frame.size(), micros(), tx_current_.max_attempts);
+  // take the first step from the timer, so all steps run in the same context
+  tx_step_us_ = micros();
+  tx_step_pending_ = true;
+  arm_timer_();
+}
 
-  // send a Logical 1
-  set_pin_output_low();
-  delay_microseconds_safe(HIGH_BIT_US);
-  set_pin_input_high();
+void IRAM_ATTR HDMICEC::tx_timer_callback_(void *arg) {
+  auto *self = static_cast<HDMICEC *>(arg);
+  bool tx_done = false;
+  {
+    // the GPIO interrupt handler may arm the timer too, from the other core: keep it from interleaving
+    CrossCoreLockGuard tx_lock(self->tx_lock_);
+    const uint32_t now = micros();
+    if (self->ack_pending_ && (int32_t) (now - self->ack_release_us_) >= 0) {
+      self->ack_pending_ = false;
+      self->set_pin_input_high();
+    }
+    if (self->tx_step_pending_ && (int32_t) (now - self->tx_step_us_) >= 0) {
+      self->tx_step_pending_ = false;
+      tx_done = self->tx_step_();
+    }
+    self->arm_timer_();
+  }
+  if (tx_done) {
+    // outside of the lock: the notification may switch to the task
+#ifdef USE_HDMI_CEC_TASK
+    self->task_->notify_from_isr();
+#else
+    self->enable_loop_soon_any_context();
+#endif
+  }
+}
 
-  // ...then wait up to the middle of the "Safe sample period" (CEC spec -> Signaling and Bit Timing -> Figure 5)
-  static const uint32_t SAFE_SAMPLE_US = 1050;
-  delay_microseconds_safe(SAFE_SAMPLE_US - (micros() - start_us));
-  bool value = pin_->digital_read();
+void IRAM_ATTR HDMICEC::arm_timer_() {
+  bool armed = false;
+  uint32_t next_us = 0;
+  if (ack_pending_) {
+    next_us = ack_release_us_;
+    armed = true;
+  }
+  if (tx_step_pending_ && (!armed || (int32_t) (tx_step_us_ - next_us) < 0)) {
+    next_us = tx_step_us_;
+    armed = true;
+  }
+  if (armed) {
+    int32_t delay = (int32_t) (next_us - micros());
+    tx_timer_.start((delay > 0) ? (uint32_t) delay : 0);
+  }
+}
 
-  // sleep for the rest of the bit period
-  delay_microseconds_safe(TOTAL_BIT_US - (micros() - start_us));
+bool IRAM_ATTR HDMICEC::tx_step_() {
+  TxStep step = transmitter_.step(micros(), isr_pin_.digital_read(), last_falling_edge_us_);
 
-  // If a 'high' value was read, the 'low' pulse was short, not lengthened by another driver.
-  // Such short pulse represents a 'high' bit.
-  return value;
+  // make sure the receiver ignores our own edges before they happen, and only listens again after them
+  if (transmitter_.is_on_bus()) {
+    transmitting_ = true;
+    if (!tx_started_) {
+      tx_started_ = true;
+      tx_started_us_ = micros();
+    }
+  }
+  if (step.line == LineAction::DriveLow) {
+    set_pin_output_low();
+  } else if (step.line == LineAction::Release) {
+    set_pin_input_high();
+  }
+  transmitting_ = transmitter_.is_on_bus();
+
+  if (step.done) {
+    const SendResult result = transmitter_.result();
+    volatile uint32_t &frames = (result == SendResult::Success) ? tx_stats_.frames_sent : tx_stats_.frames_failed;
+    frames = frames + 1;
+    tx_stats_.arbitration_lost = tx_stats_.arbitration_lost + transmitter_.collisions();
+#ifdef USE_HDMI_CEC_CAPTURE
+    capture_.push(micros(), capture::FLAG_TX, result, transmitter_.ack_bits(), tx_current_.frames[tx_frame_index_]);
+#endif
+    if (result == SendResult::Success && tx_frame_index_ + 1 < tx_current_.num_frames) {
+      // next frame of the sequence right away: the transmitter keeps the signal free time after the previous one
+      tx_frame_index_ = tx_frame_index_ + 1;
+      const Frame &frame = tx_current_.frames[tx_frame_index_];
+      transmitter_.start(frame.data(), frame.size(), micros(), tx_current_.max_attempts);
+      tx_step_us_ = micros();
+      tx_step_pending_ = true;
+      return false;
+    }
+    tx_done_ = true;
+    return true;
+  }
+  tx_step_us_ = step.next_us;
+  tx_step_pending_ = true;
+  return false;
 }
 
 void IRAM_ATTR HDMICEC::gpio_intr_(HDMICEC *self) {
   const uint32_t now = micros();
-  const bool level = self->isr_pin_.digital_read();
+  self->handle_edge_(self->isr_pin_.digital_read(), now);
+  self->rx_stats_.record_isr_duration(micros() - now);
+}
 
-  if (level == self->last_level_) {
+void IRAM_ATTR HDMICEC::handle_edge_(bool level, uint32_t now) {
+  if (level == last_level_) {
     // spurious interrupt, probably resulting from a pin mode change
+    RxStats::increment(rx_stats_.spurious_edges);
     return;
   }
-  self->last_level_ = level;
-
-  // on falling edge, store current time as the start of the low pulse
-  if (level == false) {
-    self->last_falling_edge_us_ = now;
+  last_level_ = level;
+#ifdef USE_HDMI_CEC_EDGE_TRACE
+  edge_trace_.record(now, level, transmitting_);
+#endif
 
-    if (self->recv_ack_queued_ && !self->monitor_mode_) {
-      self->recv_ack_queued_ = false;
-      {
-        InterruptLock interrupt_lock;
-        self->set_pin_output_low();
-        delay_microseconds_safe(LOW_BIT_US);
-        self->set_pin_input_high();
-      }
-    }
+  if (transmitting_) {
+    // our own frame on the bus: not to be received
     return;
   }
-  // otherwise, it's a rising edge, so it's time to process the pulse length
-
-  auto pulse_duration = (now - self->last_falling_edge_us_);
 
-  if (pulse_duration > START_BIT_MIN_US) {
-    // start bit detected. reset everything and start receiving
-    self->receiver_state_ = ReceiverState::ReceivingByte;
-    reset_state_variables_(self);
-    self->recv_ack_queued_ = false;
-    // pick frame receive buffer to fill, if available.
-    self->frame_receive_ = self->frames_queue_.back();
-    return;
-  } else if (pulse_duration < (HIGH_BIT_MIN_US / 4)) {
-    // short glitch on the line: ignore
-    return;
+  if (level == false) {
+    last_falling_edge_us_ = now;
   }
 
-  bool value = (pulse_duration >= HIGH_BIT_MIN_US && pulse_duration <= HIGH_BIT_MAX_US);
-  
-  switch (self->receiver_state_) {
-    case ReceiverState::ReceivingByte: {
-      // write bit to the current byte
-      self->recv_byte_buffer_ = (self->recv_byte_buffer_ << 1) | (value & 0b1);
-
-      self->recv_bit_counter_++;
-      if (self->recv_bit_counter_ >= 8) { 
-        // if we reached eight bits, push the current byte to the frame buffer
-        if (self->frame_receive_) {
-          self->frame_receive_->push_back(self->recv_byte_buffer_);
-        }
-
-        self->recv_bit_counter_ = 0;
-        self->recv_byte_buffer_ = 0;
+  handle_rx_event_(receiver_.on_edge(level, now));
+}
 
-        self->receiver_state_ = ReceiverState::WaitingForEOM;
-      } else {
-        self->receiver_state_ = ReceiverState::ReceivingByte;
-      }
+void IRAM_ATTR HDMICEC::handle_rx_event_(Receiver::Event event) {
+  switch (event) {
+    case Receiver::Event::FrameRestart:
+      RxStats::increment(rx_stats_.resyncs);
+      // fall through
+    case Receiver::Event::FrameStart: {
+      CrossCoreLockGuard rx_lock(rx_lock_);
+      rx_nak_ = (rx_overflow_policy_ == RxOverflowPolicy::Nak) && frames_queue_.is_full();
       break;
     }
 
-    case ReceiverState::WaitingForEOM: {
-      // check if we need to acknowledge this byte on the next bit
-      uint8_t destination_address = self->frame_receive_ ? (self->frame_receive_->front() & 0x0F) : 0xF;
-      if (destination_address != 0xF && destination_address == self->address_) {
-        self->recv_ack_queued_ = true;
+    case Receiver::Event::DriveAck: {
+      if (rx_nak_) {
+        // no room to store the frame: the initiator retries later
+        break;
       }
-
-      bool isEOM = (value == 1);
-      if (isEOM) {
-        // pass frame to app
-        if (self->frame_receive_ && self->frame_receive_->size() > 0) {
-          self->frames_queue_.push_back();
-          self->frame_receive_ = nullptr;
-        }
-        reset_state_variables_(self);
+      RxStats::increment(rx_stats_.acks_driven);
+      if (OneShotTimer::RUNS_IN_ISR) {
+        // hold the line low for a '0' from the initiator's falling edge on, and let the timer release it
+        CrossCoreLockGuard tx_lock(tx_lock_);
+        set_pin_output_low();
+        ack_release_us_ = last_falling_edge_us_ + LOW_BIT_US;
+        ack_pending_ = true;
+        arm_timer_();
+      } else {
+        // no hardware timer on this platform: the software timer would release the line too late
+        CrossCoreLockGuard tx_lock(tx_lock_);
+        set_pin_output_low();
+        delay_microseconds_safe(LOW_BIT_US);
+        set_pin_input_high();
       }
-
-      self->receiver_state_ = (
-        isEOM
-        ? ReceiverState::WaitingForEOMAck
-        : ReceiverState::WaitingForAck
-      );
       break;
     }
 
-    case ReceiverState::WaitingForAck: {
-      self->receiver_state_ = ReceiverState::ReceivingByte;
+    case Receiver::Event::FrameComplete: {
+#ifdef USE_HDMI_CEC_CAPTURE
+      capture_.push(micros(), 0, SendResult::Success, receiver_.ack_bits(), receiver_.frame());
+#endif
+      // wake the loop up, also for a dropped frame: it drains the capture records
+      enable_loop_soon_any_context();
+      // pass frame to app
+      {
+        CrossCoreLockGuard rx_lock(rx_lock_);
+        Frame *frame = rx_nak_ ? nullptr : frames_queue_.back();
+        if (frame == nullptr && !rx_nak_ && rx_overflow_policy_ == RxOverflowPolicy::DropOldestNonAddressed &&
+            frames_queue_.erase_oldest_not_addressed_to(address_)) {
+          RxStats::increment(rx_stats_.frames_dropped);
+          frame = frames_queue_.back();
+        }
+        if (frame == nullptr) {
+          RxStats::increment(rx_stats_.frames_dropped);
+          break;
+        }
+        *frame = receiver_.frame();
+        frames_queue_.push_back(micros());
+        if (frames_queue_.size() > rx_stats_.queue_high_water) {
+          rx_stats_.queue_high_water = frames_queue_.size();
+        }
+      }
+#ifdef USE_HDMI_CEC_TASK
+      task_->notify_from_isr();
+#endif
+      RxStats::increment(rx_stats_.frames_received);
       break;
     }
 
-    case ReceiverState::WaitingForEOMAck: {
-      self->receiver_state_ = ReceiverState::Idle;
+    case Receiver::Event::Glitch:
+      RxStats::increment(rx_stats_.glitches);
       break;
-    }
 
-    default: {
+    default:
       break;
-    }
   }
 }
 
-void IRAM_ATTR HDMICEC::reset_state_variables_(HDMICEC *self) {
-  self->recv_bit_counter_ = 0;
-  self->recv_byte_buffer_ = 0x0;
-}
-
 }
 }
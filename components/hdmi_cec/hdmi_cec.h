@@ -1,48 +1,49 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <vector>
 #include <atomic>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <new>
+#include <type_traits>
 
+#include "esphome/core/defines.h"
 #include "esphome/core/component.h"
 #include "esphome/core/hal.h"
 #include "esphome/core/automation.h"
+#include "esphome/core/helpers.h"
 
-namespace esphome {
-namespace hdmi_cec {
-
-class Frame : public std::vector<uint8_t> {
- public:
-  Frame() = default;
-  Frame(uint8_t initiator_addr, uint8_t target_addr, const std::vector<uint8_t> &payload);
-  uint8_t initiator_addr() const { return (this->at(0) >> 4) & 0xf; }
-  uint8_t destination_addr() const { return this->at(0) & 0xf; }
-  uint8_t opcode() const { return (this->size() >= 2) ? this->at(1) : 0; }
-  bool is_broadcast() const { return this->destination_addr() == 0xf; }
-  std::string to_string(bool skip_decode = 0) const;
-  constexpr static int MAX_LENGTH = 16;  // from HDMI CEC standard 1.4
-};
+#include "cec_bridge.h"
+#include "cec_capture.h"
+#include "cec_decoder.h"
+#include "cec_device_cache.h"
+#include "cec_edge_trace.h"
+#include "cec_frame.h"
+#include "cec_key_tracker.h"
+#include "cec_messages.h"
+#include "cec_receiver.h"
+#include "cec_rmt_capture.h"
+#include "cec_task.h"
+#include "cec_timer.h"
+#include "cec_transmitter.h"
 
-enum class ReceiverState : uint8_t {
-  Idle = 0,
-  ReceivingByte = 2,
-  WaitingForEOM = 3,
-  WaitingForAck = 4,
-  WaitingForEOMAck = 5,
-};
+// depth of the receive queue, set by codegen from 'rx_queue_size'
+#ifndef HDMI_CEC_RX_QUEUE_SIZE
+#define HDMI_CEC_RX_QUEUE_SIZE 4
+#endif
 
-enum class SendResult : uint8_t {
-  Success = 0,
-  BusCollision = 1,
-  NoAck = 2,
-};
+namespace esphome {
+namespace hdmi_cec {
 
 /*
 * The FrameRingBuffer is a container for Frames to queue data in a consumer-producer
 * application. The use of std::Atomics allows safe multi-thread operation when used with
 * a single producer and single consumer thread, where each Atomic index is updated
 * by one thread only.
-* After initialization, it operates without dynamic memmory allocation.
+* The Frames are stored inline, so it operates without dynamic memory allocation.
 * This allows the gpio isr to safely and efficiently pick-up and pass Frames.
 * Due to its fixed memory size, it might return NULL pointers in case the buffer is full or empty.
 */
@@ -52,53 +53,473 @@ class FrameRingBuffer {
   FrameRingBuffer()
   : front_inx_{0}
   , back_inx_{0}
-  , store_{} {
-    for (auto& t : store_) {
-      t = new Frame;
-      t->reserve(Frame::MAX_LENGTH);
-    }
-  }
-  ~FrameRingBuffer() {
-    for (auto& t : store_) {
-      delete t;
-    }
-  }
+  , store_{} {}
   // 'front' is used to access data, use that, and recycle its memory space for later use.
-  Frame* front() const { return is_empty() ? nullptr : store_[front_inx_]; }
+  const Frame* front() const { return is_empty() ? nullptr : &store_[front_inx_]; }
+  // time the 'front' Frame was received, as passed to 'push_back'
+  uint32_t front_time() const { return times_[front_inx_]; }
   void push_front() { cyclic_incr(front_inx_); }
   // 'back' is used to fetch a free Frame, fill with data, and queue for later pick-up
-  Frame* back() const { return is_full() ? nullptr : (store_[back_inx_]->clear(), store_[back_inx_]); }
-  void push_back() { cyclic_incr(back_inx_); }
+  Frame* back() { return is_full() ? nullptr : (store_[back_inx_].clear(), &store_[back_inx_]); }
+  void push_back(uint32_t time_us = 0) { times_[back_inx_] = time_us; cyclic_incr(back_inx_); }
   bool is_empty() const {return count() == 0;}
   bool is_full() const {return count() == SIZE;}  // using safe wrap-around of unsignd int
+  unsigned int size() const {return count();}
   void reset() {front_inx_ = 0; back_inx_ = 0;}
+  // Producer side: remove the oldest queued Frame that is not directly addressed to 'address', to make room.
+  // It moves queued Frames, so the consumer must not access the buffer meanwhile (e.g. by an InterruptLock).
+  bool IRAM_ATTR erase_oldest_not_addressed_to(uint8_t address) {
+    for (unsigned int i = front_inx_; i != back_inx_; i = next(i)) {
+      const Frame &frame = store_[i];
+      if (frame.is_broadcast() || frame.destination_addr() != address) {
+        // close the gap by moving the more recent Frames one place towards the front
+        for (unsigned int j = next(i); j != back_inx_; j = next(j)) {
+          store_[i] = store_[j];
+          times_[i] = times_[j];
+          i = j;
+        }
+        back_inx_ = i;
+        return true;
+      }
+    }
+    return false;
+  }
 
   protected:
   using Index = std::atomic<unsigned int>;
   // this simple increment scheme is sufficiently 'atomic' if the front and back are each used by
   // one thread only. (So, at most one reader thread and one writer thread in the application.)
   int count() const {int n = (int)(back_inx_ - front_inx_); if (n < 0) n += SIZE + 1; return n;}
-  void cyclic_incr(Index &inx) { inx = (inx == SIZE) ? 0 : (inx + 1); }
+  void cyclic_incr(Index &inx) { inx = next(inx); }
+  static unsigned int next(unsigned int inx) { return (inx == SIZE) ? 0 : (inx + 1); }
   Index front_inx_;  // ranging 0 .. SIZE
   Index back_inx_;   // ranging 0 .. SIZE
   // if front_inx_ == back_inx_ the store is empty, so it can hold at most SIZE elements
-  std::array<Frame*, SIZE + 1> store_;
+  std::array<Frame, SIZE + 1> store_;
+  std::array<uint32_t, SIZE + 1> times_{};
+};
+
+/**
+ * Counters of the receive path, to size the queues and spot timing trouble in the field.
+ * They are only written by the GPIO interrupt handler, and only read by the component's users.
+ */
+struct RxStats {
+  constexpr static size_t ISR_DURATION_BUCKETS = 4;
+  // upper bounds of the first buckets of the interrupt handler duration histogram; the last one takes the rest
+  constexpr static uint32_t ISR_DURATION_BOUNDS_US[ISR_DURATION_BUCKETS - 1] = {10, 100, 1000};
+
+  volatile uint32_t frames_received = 0;
+  volatile uint32_t frames_dropped = 0;    // complete frames lost, because the receive queue was full
+  volatile uint32_t glitches = 0;          // low pulses too short to be a bit
+  volatile uint32_t spurious_edges = 0;    // interrupts without a level change, e.g. after a pin mode change
+  volatile uint32_t resyncs = 0;           // start bits in the middle of a frame
+  volatile uint32_t acks_driven = 0;
+  volatile uint32_t queue_high_water = 0;  // most frames waiting in the receive queue at once
+  volatile uint32_t isr_duration_histogram[ISR_DURATION_BUCKETS] = {};
+  volatile uint32_t isr_duration_max_us = 0;
+
+  static void IRAM_ATTR increment(volatile uint32_t &counter) { counter = counter + 1; }
+  void IRAM_ATTR record_isr_duration(uint32_t duration_us) {
+    size_t bucket = 0;
+    while (bucket < ISR_DURATION_BUCKETS - 1 && duration_us >= ISR_DURATION_BOUNDS_US[bucket]) {
+      bucket++;
+    }
+    increment(isr_duration_histogram[bucket]);
+    if (duration_us > isr_duration_max_us) {
+      isr_duration_max_us = duration_us;
+    }
+  }
+};
+
+/**
+ * Counters of the transmit path, written by the transmit timer callback at the end of each frame.
+ */
+struct TxStats {
+  volatile uint32_t frames_sent = 0;       // acknowledged frames, and broadcasts
+  volatile uint32_t frames_failed = 0;     // frames given up on after their last attempt
+  volatile uint32_t arbitration_lost = 0;  // attempts stopped because another initiator won the arbitration
+};
+
+// What to do with a received frame when the receive queue is full
+enum class RxOverflowPolicy : uint8_t {
+  Nak = 0,                     // don't acknowledge frames addressed to us, so the initiator retransmits them
+  DropNewest = 1,              // acknowledge, but discard the new frame
+  DropOldestNonAddressed = 2,  // make room by discarding the oldest queued broadcast or frame for another device
+};
+
+// Device types, as reported in "Report Physical Address"; each one has its own set of logical addresses
+enum class DeviceType : uint8_t {
+  TV = 0x00,
+  Recording = 0x01,
+  Tuner = 0x03,
+  Playback = 0x04,
+  AudioSystem = 0x05,
 };
 
 class MessageTrigger;
+class DecodedMessageTrigger;
+class KeyPressTrigger;
+class KeyHoldTrigger;
+class KeyReleaseTrigger;
+
+using SendCallback = std::function<void(SendResult)>;
+// result of a sequence of frames, and the index of the frame it is about: the failed one, or the last one
+using SequenceCallback = std::function<void(SendResult result, size_t index)>;
+
+// most frames sent as one sequence, see HDMICEC::send_sequence()
+static constexpr size_t MAX_SEQUENCE_LENGTH = 4;
+
+enum class QueryResult : uint8_t {
+  Reply = 0,         // the expected reply arrived
+  FeatureAbort = 1,  // the device refused the request with "Feature Abort"
+  Timeout = 2,       // no answer in time
+  SendFailed = 3,    // the request could not be sent (e.g. not acknowledged)
+};
+
+// called with the reply (or "Feature Abort") message data, empty for the other results
+using QueryCallback = std::function<void(QueryResult, const Payload &)>;
+
+// a request waiting for its reply
+struct PendingQuery {
+  QueryCallback callback;
+  uint32_t id = 0;           // to tell the queries that reused this slot apart
+  uint32_t deadline_ms = 0;
+  uint8_t destination = 0;   // 0xF: the reply may come from any device
+  uint8_t request_opcode = 0;
+  uint8_t reply_opcode = 0;
+  bool in_use = false;
+};
+
+/**
+ * Callback of a transmit request: the SendCallback of send(), or the SequenceCallback of send_sequence(), kept as
+ * given. Wrapping a SendCallback into a SequenceCallback would not fit in the inline storage of std::function, and
+ * allocate on every send.
+ */
+class TxCallback {
+ public:
+  TxCallback() {}
+  TxCallback(std::nullptr_t) {}
+  TxCallback(SendCallback callback) {
+    if (callback) {
+      new (&send_) SendCallback(std::move(callback));
+      kind_ = Kind::Send;
+    }
+  }
+  TxCallback(SequenceCallback callback) {
+    if (callback) {
+      new (&sequence_) SequenceCallback(std::move(callback));
+      kind_ = Kind::Sequence;
+    }
+  }
+  TxCallback(TxCallback &&other) noexcept { move_from_(other); }
+  TxCallback &operator=(TxCallback &&other) noexcept {
+    if (this != &other) {
+      reset_();
+      move_from_(other);
+    }
+    return *this;
+  }
+  TxCallback &operator=(std::nullptr_t) {
+    reset_();
+    return *this;
+  }
+  ~TxCallback() { reset_(); }
+
+  explicit operator bool() const { return kind_ != Kind::None; }
+  // 'index' is the frame of the sequence the result is about; a SendCallback only gets the result
+  void operator()(SendResult result, size_t index) const {
+    if (kind_ == Kind::Send) {
+      send_(result);
+    } else if (kind_ == Kind::Sequence) {
+      sequence_(result, index);
+    }
+  }
+
+ protected:
+  enum class Kind : uint8_t { None, Send, Sequence };
+
+  void reset_() {
+    if (kind_ == Kind::Send) {
+      send_.~SendCallback();
+    } else if (kind_ == Kind::Sequence) {
+      sequence_.~SequenceCallback();
+    }
+    kind_ = Kind::None;
+  }
+  // leaves 'other' empty
+  void move_from_(TxCallback &other) {
+    if (other.kind_ == Kind::Send) {
+      new (&send_) SendCallback(std::move(other.send_));
+    } else if (other.kind_ == Kind::Sequence) {
+      new (&sequence_) SequenceCallback(std::move(other.sequence_));
+    }
+    kind_ = other.kind_;
+    other.reset_();
+  }
+
+  Kind kind_{Kind::None};
+  union {
+    SendCallback send_;
+    SequenceCallback sequence_;
+  };
+};
+
+// result of a transmission, passed from the CEC task to the main loop to call its callback there
+struct TxCompletion {
+  TxCallback callback;
+  SendResult result = SendResult::Success;
+  size_t index = 0;
+};
+
+enum class TxPriority : uint8_t {
+  Normal = 0,  // user commands
+  High = 1,    // protocol replies, like "Report Physical Address"
+};
+
+// frames waiting for transmission (usually one, more for a sequence), with their optional completion callback
+struct TxRequest {
+  std::array<Frame, MAX_SEQUENCE_LENGTH> frames;
+  uint8_t num_frames = 0;
+  TxCallback callback;
+  TxPriority priority = TxPriority::Normal;
+  bool has_deadline = false;
+  uint32_t deadline_ms = 0;  // drop the frame if its transmission did not start by then
+  uint32_t sequence = 0;     // arrival order, to keep FIFO order within a priority class
+  uint8_t max_attempts = Transmitter::MAX_ATTEMPTS;
+  // frame forwarded from another bus: the bridge counters to update, and when the frame was received there
+  BridgeStats *bridge_stats = nullptr;
+  uint32_t received_us = 0;
+  bool in_use = false;
+};
+
+/*
+* The TxQueue holds the frames waiting for transmission in a fixed set of preallocated slots,
+* so queueing a frame does not allocate memory after initialization.
+* Frames are taken out by priority first, then in order of arrival.
+* It is not thread-safe by itself: the HDMICEC component guards it with its send mutex.
+*/
+template <unsigned int SIZE>
+class TxQueue {
+  public:
+  TxQueue() = default;
+  // pending single frame request with identical frame bytes, if any
+  TxRequest* find(const Frame &frame) {
+    for (auto& slot : store_) {
+      if (slot.in_use && slot.num_frames == 1 && slot.frames[0] == frame) return &slot;
+    }
+    return nullptr;
+  }
+  // free slot to fill and 'push', or nullptr if the queue is full
+  TxRequest* acquire() {
+    for (auto& slot : store_) {
+      if (!slot.in_use) return &slot;
+    }
+    return nullptr;
+  }
+  void push(TxRequest *request) { request->sequence = next_sequence_++; request->in_use = true; }
+  // most important pending request: highest priority, oldest first
+  TxRequest* front() {
+    TxRequest *best = nullptr;
+    for (auto& slot : store_) {
+      if (slot.in_use && (best == nullptr || slot.priority > best->priority ||
+                          (slot.priority == best->priority && is_older(slot, *best)))) {
+        best = &slot;
+      }
+    }
+    return best;
+  }
+  // least important pending request: lowest priority, most recent first
+  TxRequest* back() {
+    TxRequest *worst = nullptr;
+    for (auto& slot : store_) {
+      if (slot.in_use && (worst == nullptr || slot.priority < worst->priority ||
+                          (slot.priority == worst->priority && is_older(*worst, slot)))) {
+        worst = &slot;
+      }
+    }
+    return worst;
+  }
+  void release(TxRequest *request) { request->callback = nullptr; request->in_use = false; }
+  bool is_empty() const {
+    for (auto& slot : store_) {
+      if (slot.in_use) return false;
+    }
+    return true;
+  }
+
+  protected:
+  static bool is_older(const TxRequest &a, const TxRequest &b) { return (int32_t) (a.sequence - b.sequence) < 0; }
+  std::array<TxRequest, SIZE> store_;
+  uint32_t next_sequence_ = 0;
+};
 
 class HDMICEC : public Component {
 public:
   void set_pin(InternalGPIOPin *pin) { pin_ = pin; }
-  void set_address(uint8_t address) { address_ = address; }
+  void set_address(uint8_t address) {
+    address_ = address;
+    receiver_.set_address(address);
+  }
   uint8_t address() { return address_; }
+  /**
+   * Pick the logical address at runtime instead of using a fixed one: poll the addresses of 'device_type'
+   * at startup, and take the first one no other device acknowledges (HDMI CEC spec, "Logical Address Allocation").
+   */
+  void set_device_type(DeviceType device_type) {
+    device_type_ = device_type;
+    allocate_address_ = true;
+  }
+  // Start (again) the logical address allocation, e.g. after a device with the same address showed up
+  void allocate_address();
   void set_physical_address(uint16_t physical_address) { physical_address_ = physical_address; }
   void set_promiscuous_mode(bool promiscuous_mode) { promiscuous_mode_ = promiscuous_mode; }
-  void set_monitor_mode(bool monitor_mode) { monitor_mode_ = monitor_mode; }
+  void set_rx_overflow_policy(RxOverflowPolicy policy) { rx_overflow_policy_ = policy; }
+  // Time a loop run may spend on received frames before it leaves the rest to the next run (at least one frame
+  // is handled per run)
+  void set_loop_budget(uint32_t loop_budget_us) { loop_budget_us_ = loop_budget_us; }
+  void set_monitor_mode(bool monitor_mode) {
+    monitor_mode_ = monitor_mode;
+    receiver_.set_ack_enabled(!monitor_mode);
+  }
   void set_osd_name_bytes(const std::vector<uint8_t> &osd_name_bytes) { osd_name_bytes_ = osd_name_bytes; }
+#ifdef USE_HDMI_CEC_RMT
+  // Receive with the RMT peripheral instead of the GPIO interrupt (monitor mode only: no acknowledge)
+  void set_rmt_receiver(bool rmt_receiver) { rmt_receiver_ = rmt_receiver; }
+#endif
+#ifdef USE_HDMI_CEC_EDGE_TRACE
+  // Keep the 'size' most recent edges of this bus, for dump_edge_trace()
+  void set_edge_trace_size(size_t size) { edge_trace_.allocate(size); }
+  // The edges recorded so far; pause the recording to serialize them
+  EdgeTrace &edge_trace() { return edge_trace_; }
+#endif
   void add_message_trigger(MessageTrigger *trigger) { message_triggers_.push_back(trigger); }
+  void add_decoded_message_trigger(DecodedMessageTrigger *trigger) { decoded_message_triggers_.push_back(trigger); }
+  /**
+   * Turn "User Control Pressed"/"Released" messages into key events (see KeyTracker). They are then taken out
+   * of the on_message dispatch: they are only reported by the on_key_press/hold/release triggers.
+   */
+  void set_key_events(uint32_t hold_interval_ms, uint32_t release_timeout_ms) {
+    key_events_ = true;
+    key_tracker_.set_hold_interval(hold_interval_ms);
+    key_tracker_.set_release_timeout(release_timeout_ms);
+  }
+  void add_key_press_trigger(KeyPressTrigger *trigger) { key_press_triggers_.push_back(trigger); }
+  void add_key_hold_trigger(KeyHoldTrigger *trigger) { key_hold_triggers_.push_back(trigger); }
+  void add_key_release_trigger(KeyReleaseTrigger *trigger) { key_release_triggers_.push_back(trigger); }
+  // C++ listeners, called for every message that is also offered to the on_message triggers
+  void add_on_message_callback(std::function<void(uint8_t, uint8_t, const Payload &)> &&callback) {
+    message_callbacks_.add(std::move(callback));
+  }
+  /**
+   * Opcode dispatch tables generated at codegen time, both stored in flash:
+   * - 'index' has 257 entries: the triggers for opcode N are order[index[N]] .. order[index[N + 1] - 1],
+   *   the triggers that may match any opcode are order[index[256]] .. order[count - 1]
+   * - 'order' has 'count' entries, positions in the trigger list, ascending within each opcode group
+   * The tables cover the first 'count' triggers; the ones added after them (from C++) are checked one by one.
+   * Without these tables, each received message is checked against all triggers.
+   */
+  void set_message_dispatch(const uint16_t *index, const uint16_t *order, uint16_t count) {
+    dispatch_index_ = index;
+    dispatch_order_ = order;
+    dispatch_count_ = count;
+  }
+
+  /**
+   * Queue a frame for transmission. This returns right away: the frame is put on the bus by a timer-driven
+   * state machine, and the optional 'callback' is called from loop() once it is sent or given up on.
+   * Frames of a higher 'priority' go first. With a 'max_delay_ms', the frame is dropped rather than sent late.
+   * A frame identical to one that is still pending is merged with it.
+   * It may be called from any thread or task (not from an interrupt handler); the callback runs on the main loop.
+   * @return true if the frame was accepted for transmission
+   */
+  bool send(uint8_t source, uint8_t destination, const std::vector<uint8_t> &data_bytes,
+            SendCallback callback = nullptr, TxPriority priority = TxPriority::Normal, uint32_t max_delay_ms = 0);
+  /**
+   * Same as above, without any memory allocation on the way (as long as 'callback' is empty): the frame is built
+   * on the stack and copied into the preallocated transmit queue. See the builders in cec_messages.h.
+   */
+  bool send(const Frame &frame, SendCallback callback = nullptr, TxPriority priority = TxPriority::Normal,
+            uint32_t max_delay_ms = 0);
+  bool send(uint8_t source, uint8_t destination, const Payload &data, SendCallback callback = nullptr,
+            TxPriority priority = TxPriority::Normal, uint32_t max_delay_ms = 0);
+  bool send(uint8_t source, uint8_t destination, std::initializer_list<uint8_t> data, SendCallback callback = nullptr,
+            TxPriority priority = TxPriority::Normal, uint32_t max_delay_ms = 0);
+  /**
+   * Queue up to MAX_SEQUENCE_LENGTH frames as one transaction, e.g. "Image View On" + "Active Source".
+   * They are sent back to back, each one right after the signal free time of the previous one, without a
+   * round trip through loop(). The sequence stops at the first frame that fails, whose index is reported.
+   * @return true if the frames were accepted for transmission
+   */
+  bool send_sequence(const std::vector<Frame> &frames, SequenceCallback callback = nullptr,
+                     TxPriority priority = TxPriority::Normal, uint32_t max_delay_ms = 0);
+  bool send_sequence(const Frame *frames, size_t count, SequenceCallback callback = nullptr,
+                     TxPriority priority = TxPriority::Normal, uint32_t max_delay_ms = 0);
+
+#ifdef USE_HDMI_CEC_CAPTURE
+  // Pass the frames of this bus to 'sink', through a ring of 'size' records drained by the loop
+  void set_capture(CaptureSink *sink, size_t size) {
+    capture_sink_ = sink;
+    capture_.allocate(size);
+  }
+#endif
+
+  /**
+   * Repeat the frames of this bus on the 'target' bus, as filtered and rewritten by the bridge rules (see
+   * BridgeRules): broadcasts, and the frames addressed to the devices seen on the target bus only. This bus
+   * acknowledges the frames for those devices in their place. Frames go straight from the receive queue to
+   * the transmit queue of the target, ahead of the on_message triggers. For both directions, set up a bridge
+   * on each bus.
+   */
+  void set_bridge(HDMICEC *target, BridgeAction default_action) {
+    bridge_target_ = target;
+    bridge_rules_.set_default_action(default_action);
+  }
+  void add_bridge_rule(uint16_t opcode, BridgeAction action, uint16_t physical_address_from = 0,
+                       uint16_t physical_address_to = 0) {
+    bridge_rules_.add_rule({opcode, action, physical_address_from, physical_address_to});
+  }
+  const BridgeStats &bridge_stats() const { return bridge_stats_; }
+  // the longest bridge latency since the previous call
+  uint32_t take_bridge_latency_max_us() {
+    uint32_t max_us = bridge_stats_.latency_max_us;
+    bridge_stats_.latency_max_us = 0;
+    return max_us;
+  }
+
+  // State of the other devices, learned from all frames on the bus, see DeviceCache
+  const DeviceCache &device_cache() const { return device_cache_; }
+  /**
+   * Make sure a cached value is at most 'max_age_ms' old: if it is older, or unknown, send the matching
+   * "Give ..." request (at most every few seconds), whose reply updates the cache later on.
+   * @return true if the cached value is fresh
+   */
+  bool refresh_cached(uint8_t address, CacheField field, uint32_t max_age_ms);
+
+  /**
+   * Send a request, and wait for its reply without blocking: the 'callback' is called from loop() once a message
+   * with 'reply_opcode' comes from 'destination' (from any device, if broadcast) to this device or to all, once the
+   * device answers with "Feature Abort" for the request opcode, or once 'timeout_ms' passed since this call.
+   * Several queries may wait at once, up to MAX_PENDING_QUERIES.
+   * @return true if the request was accepted for transmission (otherwise, the callback is not called)
+   */
+  bool query(uint8_t destination, const std::vector<uint8_t> &data_bytes, uint8_t reply_opcode, uint32_t timeout_ms,
+             QueryCallback callback);
+  // Result and reply (or "Feature Abort") data of the last query that was settled, or that could not be sent: the
+  // actions that follow hdmi_cec.query read them
+  QueryResult last_query_result() const { return last_query_result_; }
+  const Payload &last_query_reply() const { return last_query_reply_; }
 
-  bool send(uint8_t source, uint8_t destination, const std::vector<uint8_t> &data_bytes);
+  // Write the edge trace (if enabled) to the log, in hex lines of the binary format, see EdgeTrace
+  void dump_edge_trace();
+
+  const RxStats &rx_stats() const { return rx_stats_; }
+  const TxStats &tx_stats() const { return tx_stats_; }
+  // the longest interrupt handler run since the previous call
+  uint32_t take_isr_duration_max_us() {
+    uint32_t max_us = rx_stats_.isr_duration_max_us;
+    rx_stats_.isr_duration_max_us = 0;
+    return max_us;
+  }
 
   // Component overrides
   float get_setup_priority() { return esphome::setup_priority::HARDWARE; }
@@ -108,52 +529,319 @@ public:
 
 protected:
   static void gpio_intr_(HDMICEC *self);
-  static void reset_state_variables_(HDMICEC *self);
-  void try_builtin_handler_(uint8_t source, uint8_t destination, const std::vector<uint8_t> &data);
-  SendResult send_frame_(const Frame &frame, bool is_broadcast);
-  bool send_start_bit_();
-  void send_bit_(bool bit_value);
-  bool send_high_and_test_();
+  void handle_edge_(bool level, uint32_t now);
+  void handle_rx_event_(Receiver::Event event);
+  static void tx_timer_callback_(void *arg);
+#ifdef USE_HDMI_CEC_TASK
+  static void task_loop_(void *arg);
+#endif
+  void arm_timer_();
+  // with 'run_triggers' false, only tell whether an on_message trigger matches
+  bool dispatch_message_(uint8_t source, uint8_t destination, const Payload &data, bool run_triggers);
+  void try_builtin_handler_(uint8_t source, uint8_t destination, const Payload &data);
+  bool queue_frames_(const Frame *frames, size_t count, TxCallback callback, TxPriority priority,
+                     uint32_t max_delay_ms, uint8_t max_attempts, BridgeStats *bridge_stats = nullptr,
+                     uint32_t received_us = 0);
+  bool enqueue_(TxRequest &&incoming);
+  // pass a transmission result to its callback, in the main loop
+  void report_tx_result_(TxCallback &&callback, SendResult result, size_t index);
+  // protocol side of the received frames: forwarding and built-in replies (on the CEC task, if enabled)
+  void receive_frames_();
+  void reply_builtin_(const Frame &frame);
+  // main loop side of the received frames: device cache, key events, queries and triggers
+  void handle_frame_(const Frame &frame);
+  void forward_frame_(Frame frame, uint32_t received_us);
+  void update_bridge_ack_mask_();
+  void poll_next_address_();
+  void handle_poll_result_(uint8_t candidate, SendResult result);
+  void report_physical_address_();
+  void dispatch_key_event_(const KeyEvent &event);
+  void match_queries_(uint8_t source, uint8_t destination, const Payload &data);
+  void expire_queries_();
+  void finish_query_(PendingQuery &query, QueryResult result, const Payload &data);
+  // a query that could not be sent: record it as the last one, @return false
+  bool reject_query_();
+  void process_transmit_();
+  // whether the loop has to run again without a new event (see loop())
+  bool has_pending_work_();
+  // called with 'tx_lock_' held; @return true once the transmission is over: then wake the loop (or the CEC task)
+  bool tx_step_();
+  void drain_capture_();
   void set_pin_input_high();
   void set_pin_output_low();
 
-  constexpr static int MAX_FRAMES_QUEUED = 4;
+  constexpr static int MAX_FRAMES_QUEUED = HDMI_CEC_RX_QUEUE_SIZE;
+  constexpr static int MAX_FRAMES_SEND_QUEUED = 8;
+  // a lost ACK would make us take an address in use: poll each candidate twice before taking it
+  constexpr static uint8_t POLL_ATTEMPTS = 2;
+  constexpr static uint8_t MAX_POLL_FAILURES = 3;
+  // time for a device to answer a cache refresh query, before asking again
+  constexpr static uint32_t CACHE_QUERY_INTERVAL_MS = 3000;
+  constexpr static size_t MAX_PENDING_QUERIES = 8;
   InternalGPIOPin *pin_;
   ISRInternalGPIOPin isr_pin_;
   uint8_t address_;
   uint16_t physical_address_;
   bool promiscuous_mode_;
   bool monitor_mode_;
+  bool allocate_address_ = false;
+  DeviceType device_type_ = DeviceType::Playback;
+  uint8_t allocation_index_ = 0;     // candidate address being polled
+  uint8_t allocation_failures_ = 0;  // polls of that candidate that ended in an error other than 'NoAck'
+  DeviceCache device_cache_;
+  bool key_events_ = false;
+  KeyTracker key_tracker_;
+  std::vector<KeyPressTrigger *> key_press_triggers_;
+  std::vector<KeyHoldTrigger *> key_hold_triggers_;
+  std::vector<KeyReleaseTrigger *> key_release_triggers_;
+  HDMICEC *bridge_target_ = nullptr;
+  BridgeRules bridge_rules_;
+  BridgeStats bridge_stats_;
+  uint16_t bridge_ack_mask_ = 0;  // devices of the target bus this bus acknowledges for
+  std::array<PendingQuery, MAX_PENDING_QUERIES> pending_queries_;
+  uint32_t next_query_id_ = 0;
+  QueryResult last_query_result_ = QueryResult::Timeout;
+  Payload last_query_reply_;
   std::vector<uint8_t> osd_name_bytes_;
   std::vector<MessageTrigger*> message_triggers_;
+  std::vector<DecodedMessageTrigger *> decoded_message_triggers_;
+  CallbackManager<void(uint8_t, uint8_t, const Payload &)> message_callbacks_;
+  const uint16_t *dispatch_index_ = nullptr;
+  const uint16_t *dispatch_order_ = nullptr;
+  uint16_t dispatch_count_ = 0;
 
   bool last_level_ = true;            // cec line level on last isr call
-  volatile uint32_t last_falling_edge_us_ = 0; // timepoint in received message (volatile: written by ISR, read by send())
-  uint32_t last_sent_us_ = 0;         // timepoint on end of sent message
-  ReceiverState receiver_state_;
-  uint8_t recv_bit_counter_ = 0;
-  uint8_t recv_byte_buffer_ = 0;
-  Frame *frame_receive_ = nullptr;
+  volatile uint32_t last_falling_edge_us_ = 0; // timepoint in received message (volatile: written by ISR, read by tx_step_())
+  Receiver receiver_;
+#ifdef USE_HDMI_CEC_EDGE_TRACE
+  EdgeTrace edge_trace_;
+#endif
+#ifdef USE_HDMI_CEC_RMT
+  RmtCapture rmt_capture_;
+  bool rmt_receiver_ = false;
+#endif
+#ifdef USE_HDMI_CEC_CAPTURE
+  CaptureRing capture_;
+  CaptureSink *capture_sink_ = nullptr;
+  uint32_t capture_dropped_reported_ = 0;
+#endif
+  RxOverflowPolicy rx_overflow_policy_ = RxOverflowPolicy::Nak;
+  uint32_t loop_budget_us_ = 5000;
+  bool rx_nak_ = false;               // the current frame is not acknowledged, because the queue was full at its start
+  RxStats rx_stats_;
+  // The GPIO interrupt handler may run on another core than the loop (or the CEC task) taking the frames out:
+  // 'rx_lock_' guards the queue.
+  CrossCoreLock rx_lock_;
   FrameRingBuffer<MAX_FRAMES_QUEUED> frames_queue_;
-  bool recv_ack_queued_ = false;
+
+  // transmitter
+  OneShotTimer tx_timer_;
+  Transmitter transmitter_;
+  TxStats tx_stats_;
+  TxRequest tx_current_;                   // frames owned by the transmitter while 'tx_active_'
+  volatile uint8_t tx_frame_index_ = 0;    // frame of 'tx_current_' on the bus
+  std::atomic<bool> tx_active_{false};
+  std::atomic<bool> tx_done_{false};       // set by the timer callback, result is reported by loop()
+  volatile bool transmitting_ = false;     // frame bits on the bus: the receiver ignores our own edges
+  volatile bool tx_started_ = false;       // the current frame went on the bus, at 'tx_started_us_'
+  volatile uint32_t tx_started_us_ = 0;
+  // the transmitter and the ACK generation share the timer, it is armed for the earliest of both.
+  // The timer callback and the GPIO interrupt handler (ACK) may run on different cores: 'tx_lock_' guards the
+  // transmitter, these fields and the pin.
+  CrossCoreLock tx_lock_;
+  volatile bool tx_step_pending_ = false;
+  volatile uint32_t tx_step_us_ = 0;       // time of the next transmitter step
+  volatile bool ack_pending_ = false;      // the line is held low to acknowledge a byte
+  volatile uint32_t ack_release_us_ = 0;   // time to release it
+  TxQueue<MAX_FRAMES_SEND_QUEUED> tx_queue_;
+#ifdef USE_HDMI_CEC_TASK
+  // the CEC task owns the transmit queue and the receive processing; the main loop talks to it through
+  // lock-free queues only
+  ProtocolTask *task_ = ProtocolTask::get();
+  // single producer: the threads that call send() take turns with 'submit_mutex_', the CEC task never waits on it
+  SpscQueue<TxRequest, MAX_FRAMES_SEND_QUEUED> tx_submit_;
+  Mutex submit_mutex_;
+  SpscQueue<TxCompletion, 2 * MAX_FRAMES_SEND_QUEUED> tx_completions_;
+  FrameRingBuffer<MAX_FRAMES_QUEUED> loop_frames_;
+#else
   Mutex send_mutex_;
+#endif
 };
 
-class MessageTrigger : public Trigger<uint8_t, uint8_t, std::vector<uint8_t>> {
+class MessageTrigger : public Trigger<uint8_t, uint8_t, Payload> {
   friend class HDMICEC;
 
 public:
   explicit MessageTrigger(HDMICEC *parent) { parent->add_message_trigger(this); };
-  void set_source(uint8_t source) { source_ = source; };
-  void set_destination(uint8_t destination) { destination_ = destination; };
+  void set_source(uint8_t source) { source_mask_ = 1 << (source & 0xF); };
+  void set_destination(uint8_t destination) { destination_mask_ = 1 << (destination & 0xF); };
   void set_opcode(uint8_t opcode) { opcode_ = opcode; };
-  void set_data(const std::vector<uint8_t> &data) { data_ = data; };
+  void set_data(const Payload &data) { data_ = data; };
+  bool matches(uint8_t source, uint8_t destination, const Payload &data) const;
 
 protected:
-  optional<uint8_t> source_;
-  optional<uint8_t> destination_;
+  uint16_t source_mask_ = 0xFFFF;       // bit N set: accept messages from logical address N
+  uint16_t destination_mask_ = 0xFFFF;  // bit N set: accept messages to logical address N
+  optional<uint8_t> opcode_;
+  optional<Payload> data_;
+};
+
+/**
+ * Same messages as the on_message triggers, passed on decoded: the operands come typed (physical address,
+ * vendor ID, UI command, ...) instead of as bytes. It only observes, the built-in replies still run.
+ */
+class DecodedMessageTrigger : public Trigger<DecodedMessage> {
+public:
+  explicit DecodedMessageTrigger(HDMICEC *parent) { parent->add_decoded_message_trigger(this); }
+  void set_source(uint8_t source) { source_mask_ = 1 << (source & 0xF); }
+  void set_destination(uint8_t destination) { destination_mask_ = 1 << (destination & 0xF); }
+  void set_opcode(uint8_t opcode) { opcode_ = opcode; }
+  bool matches(const DecodedMessage &message) const {
+    return ((source_mask_ >> message.initiator()) & 0b1) && ((destination_mask_ >> message.destination()) & 0b1) &&
+           (!opcode_.has_value() || *opcode_ == message.frame.opcode());
+  }
+
+protected:
+  uint16_t source_mask_ = 0xFFFF;
+  uint16_t destination_mask_ = 0xFFFF;
   optional<uint8_t> opcode_;
-  optional<std::vector<uint8_t>> data_;
+};
+
+// Optional source and key filters of the key event triggers
+class KeyFilter {
+public:
+  void set_source(uint8_t source) { source_ = source; }
+  void set_key(uint8_t key) { key_ = key; }
+  bool matches(const KeyEvent &event) const {
+    return (!source_.has_value() || *source_ == event.source) && (!key_.has_value() || *key_ == event.key);
+  }
+
+protected:
+  optional<uint8_t> source_;
+  optional<uint8_t> key_;
+};
+
+// source, key
+class KeyPressTrigger : public Trigger<uint8_t, uint8_t>, public KeyFilter {
+public:
+  explicit KeyPressTrigger(HDMICEC *parent) { parent->add_key_press_trigger(this); }
+};
+
+// source, key, repeat count, held duration in ms
+class KeyHoldTrigger : public Trigger<uint8_t, uint8_t, uint32_t, uint32_t>, public KeyFilter {
+public:
+  explicit KeyHoldTrigger(HDMICEC *parent) { parent->add_key_hold_trigger(this); }
+};
+
+// source, key, held duration in ms
+class KeyReleaseTrigger : public Trigger<uint8_t, uint8_t, uint32_t>, public KeyFilter {
+public:
+  explicit KeyReleaseTrigger(HDMICEC *parent) { parent->add_key_release_trigger(this); }
+};
+
+class SendSequenceFailureTrigger : public Trigger<uint8_t> {};
+
+template<typename... Ts> class SendSequenceAction : public Action<Ts...> {
+public:
+  SendSequenceAction(HDMICEC *parent) : parent_(parent) {}
+  TEMPLATABLE_VALUE(uint8_t, source)
+  void add_message(uint8_t destination, const Payload &data) { messages_.push_back({destination, data}); }
+  void set_priority(TxPriority priority) { priority_ = priority; }
+  void add_failure_trigger(SendSequenceFailureTrigger *trigger) { failure_triggers_.push_back(trigger); }
+
+  void play(const Ts&... x) override {
+    auto source_address = source_.has_value() ? source_.value(x...) : parent_->address();
+    std::array<Frame, MAX_SEQUENCE_LENGTH> frames;
+    size_t count = 0;
+    for (const auto &message : messages_) {
+      if (count == frames.size()) break;
+      frames[count++] = Frame(source_address, message.first, message.second);
+    }
+    SequenceCallback callback;
+    if (!failure_triggers_.empty()) {
+      callback = [this](SendResult result, size_t index) {
+        if (result != SendResult::Success) {
+          for (auto *trigger : failure_triggers_) trigger->trigger(index);
+        }
+      };
+    }
+    parent_->send_sequence(frames.data(), count, callback, priority_);
+  }
+
+protected:
+  HDMICEC *parent_;
+  std::vector<std::pair<uint8_t, Payload>> messages_;
+  TxPriority priority_{TxPriority::Normal};
+  std::vector<SendSequenceFailureTrigger *> failure_triggers_;
+};
+
+class QueryResponseTrigger : public Trigger<Payload> {};
+class QueryFeatureAbortTrigger : public Trigger<uint8_t> {};
+class QueryTimeoutTrigger : public Trigger<> {};
+
+template<typename... Ts> class QueryAction : public Action<Ts...> {
+public:
+  QueryAction(HDMICEC *parent) : parent_(parent) {}
+  TEMPLATABLE_VALUE(uint8_t, destination)
+  TEMPLATABLE_VALUE(std::vector<uint8_t>, data)
+  void set_reply_opcode(uint8_t reply_opcode) { reply_opcode_ = reply_opcode; }
+  void set_timeout(uint32_t timeout_ms) { timeout_ms_ = timeout_ms; }
+  void add_response_trigger(QueryResponseTrigger *trigger) { response_triggers_.push_back(trigger); }
+  void add_feature_abort_trigger(QueryFeatureAbortTrigger *trigger) { feature_abort_triggers_.push_back(trigger); }
+  void add_timeout_trigger(QueryTimeoutTrigger *trigger) { timeout_triggers_.push_back(trigger); }
+
+  // The following actions run once the query is settled, after the on_response, on_feature_abort or on_timeout
+  // triggers; they find the result in HDMICEC::last_query_result() and last_query_reply().
+  void play_complex(const Ts&... x) override {
+    this->num_running_++;
+    const uint32_t run = run_;
+    QueryCallback callback = [this, run, x...](QueryResult result, const Payload &data) {
+      if (run != run_) {
+        // the automation was stopped meanwhile
+        return;
+      }
+      switch (result) {
+        case QueryResult::Reply:
+          for (auto *trigger : response_triggers_) trigger->trigger(data);
+          break;
+        case QueryResult::FeatureAbort:
+          // "Feature Abort" operands: opcode, reason (always present, see match_queries_())
+          for (auto *trigger : feature_abort_triggers_) trigger->trigger(data[2]);
+          break;
+        default:
+          for (auto *trigger : timeout_triggers_) trigger->trigger();
+          break;
+      }
+      this->play_next_(x...);
+    };
+    if (!parent_->query(destination_.value(x...), data_.value(x...), reply_opcode_, timeout_ms_, callback)) {
+      // not sent: the callback won't come
+      callback(QueryResult::SendFailed, Payload());
+    }
+  }
+
+  void play(const Ts&... x) override { /* ignore - see play_complex */ }
+
+  void stop() override { run_++; }
+
+protected:
+  HDMICEC *parent_;
+  uint8_t reply_opcode_{0};
+  uint32_t timeout_ms_{1000};
+  uint32_t run_{0};  // changed by stop(), so the queries of a stopped run don't resume the automation
+  std::vector<QueryResponseTrigger *> response_triggers_;
+  std::vector<QueryFeatureAbortTrigger *> feature_abort_triggers_;
+  std::vector<QueryTimeoutTrigger *> timeout_triggers_;
+};
+
+template<typename... Ts> class DumpEdgeTraceAction : public Action<Ts...> {
+public:
+  DumpEdgeTraceAction(HDMICEC *parent) : parent_(parent) {}
+
+  void play(const Ts&... x) override { parent_->dump_edge_trace(); }
+
+protected:
+  HDMICEC *parent_;
 };
 
 template<typename... Ts> class SendAction : public Action<Ts...> {
@@ -162,16 +850,35 @@ public:
   TEMPLATABLE_VALUE(uint8_t, source)
   TEMPLATABLE_VALUE(uint8_t, destination)
   TEMPLATABLE_VALUE(std::vector<uint8_t>, data)
+  // constant data, generated in flash: sent from there, without going through a std::vector
+  void set_static_data(const uint8_t *data, size_t length) {
+    static_data_ = data;
+    static_data_length_ = length;
+  }
+  void set_priority(TxPriority priority) { priority_ = priority; }
+  void set_max_delay(uint32_t max_delay_ms) { max_delay_ms_ = max_delay_ms; }
 
   void play(const Ts&... x) override {
     auto source_address = source_.has_value() ? source_.value(x...) : parent_->address();
     auto destination_address = destination_.value(x...);
+    if (static_data_ != nullptr) {
+      Payload data;
+      for (size_t i = 0; i < static_data_length_; i++) {
+        data.push_back(progmem_read_byte(&static_data_[i]));
+      }
+      parent_->send(source_address, destination_address, data, nullptr, priority_, max_delay_ms_);
+      return;
+    }
     auto data = data_.value(x...);
-    parent_->send(source_address, destination_address, data);
+    parent_->send(source_address, destination_address, data, nullptr, priority_, max_delay_ms_);
   }
 
 protected:
   HDMICEC *parent_;
+  const uint8_t *static_data_ = nullptr;
+  size_t static_data_length_ = 0;
+  TxPriority priority_{TxPriority::Normal};
+  uint32_t max_delay_ms_{0};
 };
 
 }
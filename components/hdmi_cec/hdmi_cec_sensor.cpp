@@ -0,0 +1,63 @@
+#include "hdmi_cec_sensor.h"
+
+#ifdef USE_SENSOR
+
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace hdmi_cec {
+
+static const char *const TAG = "hdmi_cec.sensor";
+
+static void publish_counter(sensor::Sensor *sensor, uint32_t value) {
+  if (sensor != nullptr) {
+    sensor->publish_state(value);
+  }
+}
+
+void HDMICECSensor::update() {
+  const RxStats &stats = parent_->rx_stats();
+  publish_counter(frames_received_sensor_, stats.frames_received);
+  publish_counter(frames_dropped_sensor_, stats.frames_dropped);
+  publish_counter(glitches_sensor_, stats.glitches);
+  publish_counter(spurious_edges_sensor_, stats.spurious_edges);
+  publish_counter(resyncs_sensor_, stats.resyncs);
+  publish_counter(acks_driven_sensor_, stats.acks_driven);
+  publish_counter(rx_queue_high_water_sensor_, stats.queue_high_water);
+  for (size_t i = 0; i < RxStats::ISR_DURATION_BUCKETS; i++) {
+    publish_counter(isr_duration_bucket_sensors_[i], stats.isr_duration_histogram[i]);
+  }
+  uint32_t isr_duration_max_us = parent_->take_isr_duration_max_us();
+  publish_counter(isr_duration_max_sensor_, isr_duration_max_us);
+
+  const BridgeStats &bridge_stats = parent_->bridge_stats();
+  publish_counter(bridge_forwarded_sensor_, bridge_stats.forwarded);
+  publish_counter(bridge_filtered_sensor_, bridge_stats.filtered);
+  publish_counter(bridge_failed_sensor_, bridge_stats.failed);
+  uint32_t bridge_latency_max_us = parent_->take_bridge_latency_max_us();
+  publish_counter(bridge_latency_max_sensor_, bridge_latency_max_us);
+}
+
+void HDMICECSensor::dump_config() {
+  ESP_LOGCONFIG(TAG, "HDMI-CEC Sensor");
+  LOG_SENSOR("  ", "Frames Received", frames_received_sensor_);
+  LOG_SENSOR("  ", "Frames Dropped", frames_dropped_sensor_);
+  LOG_SENSOR("  ", "Glitches", glitches_sensor_);
+  LOG_SENSOR("  ", "Spurious Edges", spurious_edges_sensor_);
+  LOG_SENSOR("  ", "Resyncs", resyncs_sensor_);
+  LOG_SENSOR("  ", "ACKs Driven", acks_driven_sensor_);
+  LOG_SENSOR("  ", "RX Queue High Water", rx_queue_high_water_sensor_);
+  LOG_SENSOR("  ", "ISR Duration Max", isr_duration_max_sensor_);
+  LOG_SENSOR("  ", "Bridge Forwarded", bridge_forwarded_sensor_);
+  LOG_SENSOR("  ", "Bridge Filtered", bridge_filtered_sensor_);
+  LOG_SENSOR("  ", "Bridge Failed", bridge_failed_sensor_);
+  LOG_SENSOR("  ", "Bridge Latency Max", bridge_latency_max_sensor_);
+  for (auto *sensor : isr_duration_bucket_sensors_) {
+    LOG_SENSOR("  ", "ISR Duration Bucket", sensor);
+  }
+}
+
+}  // namespace hdmi_cec
+}  // namespace esphome
+
+#endif  // USE_SENSOR
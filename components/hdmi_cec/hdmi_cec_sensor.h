@@ -0,0 +1,62 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+#ifdef USE_SENSOR
+
+#include <array>
+
+#include "esphome/core/component.h"
+#include "esphome/core/helpers.h"
+#include "esphome/components/sensor/sensor.h"
+#include "hdmi_cec.h"
+
+namespace esphome {
+namespace hdmi_cec {
+
+/**
+ * Publishes the receive path statistics (see RxStats) and the bridge counters (see BridgeStats) of an HDMICEC bus
+ * as sensors. The counters keep counting since boot; 'isr_duration_max' is the longest interrupt handler run
+ * within the last update interval, and 'bridge_latency_max' the longest bridge latency.
+ */
+class HDMICECSensor : public PollingComponent, public Parented<HDMICEC> {
+ public:
+  void set_frames_received_sensor(sensor::Sensor *sensor) { frames_received_sensor_ = sensor; }
+  void set_frames_dropped_sensor(sensor::Sensor *sensor) { frames_dropped_sensor_ = sensor; }
+  void set_glitches_sensor(sensor::Sensor *sensor) { glitches_sensor_ = sensor; }
+  void set_spurious_edges_sensor(sensor::Sensor *sensor) { spurious_edges_sensor_ = sensor; }
+  void set_resyncs_sensor(sensor::Sensor *sensor) { resyncs_sensor_ = sensor; }
+  void set_acks_driven_sensor(sensor::Sensor *sensor) { acks_driven_sensor_ = sensor; }
+  void set_rx_queue_high_water_sensor(sensor::Sensor *sensor) { rx_queue_high_water_sensor_ = sensor; }
+  void set_isr_duration_max_sensor(sensor::Sensor *sensor) { isr_duration_max_sensor_ = sensor; }
+  void set_bridge_forwarded_sensor(sensor::Sensor *sensor) { bridge_forwarded_sensor_ = sensor; }
+  void set_bridge_filtered_sensor(sensor::Sensor *sensor) { bridge_filtered_sensor_ = sensor; }
+  void set_bridge_failed_sensor(sensor::Sensor *sensor) { bridge_failed_sensor_ = sensor; }
+  void set_bridge_latency_max_sensor(sensor::Sensor *sensor) { bridge_latency_max_sensor_ = sensor; }
+  void set_isr_duration_bucket_sensor(size_t bucket, sensor::Sensor *sensor) {
+    isr_duration_bucket_sensors_[bucket] = sensor;
+  }
+
+  void update() override;
+  void dump_config() override;
+
+ protected:
+  sensor::Sensor *frames_received_sensor_{nullptr};
+  sensor::Sensor *frames_dropped_sensor_{nullptr};
+  sensor::Sensor *glitches_sensor_{nullptr};
+  sensor::Sensor *spurious_edges_sensor_{nullptr};
+  sensor::Sensor *resyncs_sensor_{nullptr};
+  sensor::Sensor *acks_driven_sensor_{nullptr};
+  sensor::Sensor *rx_queue_high_water_sensor_{nullptr};
+  sensor::Sensor *isr_duration_max_sensor_{nullptr};
+  sensor::Sensor *bridge_forwarded_sensor_{nullptr};
+  sensor::Sensor *bridge_filtered_sensor_{nullptr};
+  sensor::Sensor *bridge_failed_sensor_{nullptr};
+  sensor::Sensor *bridge_latency_max_sensor_{nullptr};
+  std::array<sensor::Sensor *, RxStats::ISR_DURATION_BUCKETS> isr_duration_bucket_sensors_{};
+};
+
+}  // namespace hdmi_cec
+}  // namespace esphome
+
+#endif  // USE_SENSOR
@@ -0,0 +1,98 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import sensor
+from esphome.const import (
+    CONF_ID,
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+)
+from . import hdmi_cec_ns, HDMICEC
+
+DEPENDENCIES = ["hdmi_cec"]
+
+CONF_HDMI_CEC_ID = "hdmi_cec_id"
+CONF_FRAMES_RECEIVED = "frames_received"
+CONF_FRAMES_DROPPED = "frames_dropped"
+CONF_GLITCHES = "glitches"
+CONF_SPURIOUS_EDGES = "spurious_edges"
+CONF_RESYNCS = "resyncs"
+CONF_ACKS_DRIVEN = "acks_driven"
+CONF_ISR_DURATION_MAX = "isr_duration_max"
+CONF_RX_QUEUE_HIGH_WATER = "rx_queue_high_water"
+CONF_BRIDGE_FORWARDED = "bridge_forwarded"
+CONF_BRIDGE_FILTERED = "bridge_filtered"
+CONF_BRIDGE_FAILED = "bridge_failed"
+CONF_BRIDGE_LATENCY_MAX = "bridge_latency_max"
+# interrupt handler duration histogram, one key per bucket (see RxStats::ISR_DURATION_BOUNDS_US)
+ISR_DURATION_BUCKETS = [
+    "isr_duration_under_10us",
+    "isr_duration_under_100us",
+    "isr_duration_under_1000us",
+    "isr_duration_over_1000us",
+]
+
+UNIT_MICROSECOND = "µs"
+
+HDMICECSensor = hdmi_cec_ns.class_(
+    "HDMICECSensor", cg.PollingComponent
+)
+
+COUNTERS = [
+    CONF_FRAMES_RECEIVED,
+    CONF_FRAMES_DROPPED,
+    CONF_GLITCHES,
+    CONF_SPURIOUS_EDGES,
+    CONF_RESYNCS,
+    CONF_ACKS_DRIVEN,
+    CONF_BRIDGE_FORWARDED,
+    CONF_BRIDGE_FILTERED,
+    CONF_BRIDGE_FAILED,
+]
+
+def counter_schema():
+    return sensor.sensor_schema(
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_TOTAL_INCREASING,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    )
+
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(): cv.declare_id(HDMICECSensor),
+        cv.GenerateID(CONF_HDMI_CEC_ID): cv.use_id(HDMICEC),
+        **{cv.Optional(key): counter_schema() for key in COUNTERS + ISR_DURATION_BUCKETS},
+        cv.Optional(CONF_RX_QUEUE_HIGH_WATER): sensor.sensor_schema(
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_ISR_DURATION_MAX): sensor.sensor_schema(
+            unit_of_measurement=UNIT_MICROSECOND,
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_BRIDGE_LATENCY_MAX): sensor.sensor_schema(
+            unit_of_measurement=UNIT_MICROSECOND,
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+    }
+).extend(cv.polling_component_schema("60s"))
+
+async def to_code(config):
+    var = cg.new_Pvariable(config[CONF_ID])
+    await cg.register_component(var, config)
+    await cg.register_parented(var, config[CONF_HDMI_CEC_ID])
+
+    for key in COUNTERS + [CONF_RX_QUEUE_HIGH_WATER, CONF_ISR_DURATION_MAX, CONF_BRIDGE_LATENCY_MAX]:
+        if key in config:
+            sens = await sensor.new_sensor(config[key])
+            cg.add(getattr(var, f"set_{key}_sensor")(sens))
+
+    for bucket, key in enumerate(ISR_DURATION_BUCKETS):
+        if key in config:
+            sens = await sensor.new_sensor(config[key])
+            cg.add(var.set_isr_duration_bucket_sensor(bucket, sens))
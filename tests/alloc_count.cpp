@@ -0,0 +1,43 @@
+#include "alloc_count.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace alloc_count {
+
+static std::atomic<size_t> count{0};
+
+size_t allocations() { return count.load(); }
+
+static void count_one() {
+  if (paused == 0) {
+    count++;
+  }
+}
+
+static void *allocate(size_t size) {
+  count_one();
+  void *memory = std::malloc((size > 0) ? size : 1);
+  if (memory == nullptr) {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+}  // namespace alloc_count
+
+void *operator new(size_t size) { return alloc_count::allocate(size); }
+void *operator new[](size_t size) { return alloc_count::allocate(size); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  alloc_count::count_one();
+  return std::malloc((size > 0) ? size : 1);
+}
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  alloc_count::count_one();
+  return std::malloc((size > 0) ? size : 1);
+}
+void operator delete(void *memory) noexcept { std::free(memory); }
+void operator delete[](void *memory) noexcept { std::free(memory); }
+void operator delete(void *memory, size_t) noexcept { std::free(memory); }
+void operator delete[](void *memory, size_t) noexcept { std::free(memory); }
@@ -0,0 +1,25 @@
+#pragma once
+
+// Counts the heap allocations of the whole program: linking alloc_count.cpp replaces the global operator new.
+
+#include <cstddef>
+
+namespace alloc_count {
+
+// allocations since the start of the program, except the paused ones
+size_t allocations();
+
+// depth of the Pause guards of this thread
+inline thread_local int paused = 0;
+
+// Allocations made while a Pause is alive, on the same thread, are not counted: e.g. the bookkeeping of the
+// simulated bus, which is not part of what the tests measure. Header-only, so the simulator needs no link to this.
+class Pause {
+ public:
+  Pause() { paused++; }
+  ~Pause() { paused--; }
+  Pause(const Pause &) = delete;
+  Pause &operator=(const Pause &) = delete;
+};
+
+}  // namespace alloc_count
@@ -0,0 +1,158 @@
+// Bus benchmark on the simulated wire: N nodes sending directed frames to each other, either all the time
+// (saturated bus) or at random times (light load). Reports, in simulated time:
+//  - frames delivered per second, and frames given up on (on a saturated bus, the initiators with the highest
+//    logical addresses lose the arbitration every time, until they run out of attempts)
+//  - arbitration losses per frame
+//  - latency from send() to the on_message trigger of the destination
+// usage: bench_bus [--nodes N] [--load saturated|light] [--seconds S] [--seed X]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "esphome/core/log.h"
+#include "host_hal.h"
+#include "sim_node.h"
+
+using namespace esphome::hdmi_cec;
+using namespace esphome::hdmi_cec::sim;
+
+// logical addresses of the nodes, in order
+static const uint8_t ADDRESSES[] = {0x0, 0x4, 0x1, 0x5, 0x3, 0x8, 0x2, 0xB};
+
+struct Options {
+  size_t nodes = 4;
+  bool saturated = true;
+  double seconds = 60;
+  uint32_t seed = 1;
+};
+
+class Benchmark {
+ public:
+  explicit Benchmark(const Options &options) : options_(options), random_(options.seed) {
+    set_seed(options.seed);
+    for (size_t i = 0; i < options.nodes; i++) {
+      nodes_.push_back(std::make_unique<Node>(bus_, ADDRESSES[i]));
+    }
+    bus_.run_for(20000);
+  }
+
+  void run() {
+    const uint64_t start_us = Scheduler::get().now();
+    const uint64_t end_us = start_us + (uint64_t) (options_.seconds * 1e6);
+    for (size_t i = 0; i < nodes_.size(); i++) {
+      if (options_.saturated) {
+        send_(i);
+      } else {
+        schedule_(i);
+      }
+    }
+    const auto wall_start = std::chrono::steady_clock::now();
+    bus_.run_for(end_us - start_us);
+    const double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    report_(wall_s);
+  }
+
+ protected:
+  // a directed "Vendor Command" to another node, numbered in its payload
+  void send_(size_t from) {
+    size_t to = std::uniform_int_distribution<size_t>(0, nodes_.size() - 2)(random_);
+    if (to >= from) {
+      to++;
+    }
+    const uint16_t id = next_id_++;
+    Payload data{0x89, (uint8_t) (id >> 8), (uint8_t) id};
+    const size_t padding = std::uniform_int_distribution<size_t>(0, 2)(random_);
+    for (size_t i = 0; i < padding; i++) {
+      data.push_back(0x00);
+    }
+    sent_us_[id] = Scheduler::get().now();
+    const Frame frame(ADDRESSES[from], ADDRESSES[to], data);
+    nodes_[from]->cec.send(frame, [this, from](SendResult result) {
+      if (result != SendResult::Success) {
+        failed_++;
+      }
+      if (options_.saturated) {
+        send_(from);
+      }
+    });
+  }
+
+  // light load: a frame every 2 seconds from each node, on average
+  void schedule_(size_t from) {
+    const double delay_s = std::exponential_distribution<double>(0.5)(random_);
+    Scheduler::get().after((uint64_t) (delay_s * 1e6), [this, from]() {
+      send_(from);
+      schedule_(from);
+    });
+  }
+
+  void report_(double wall_s) {
+    std::vector<double> latencies_ms;
+    for (const auto &node : nodes_) {
+      for (const auto &received : node->received) {
+        const Payload data = received.frame.payload();
+        const uint16_t id = (data.at(1) << 8) | data.at(2);
+        auto it = sent_us_.find(id);
+        if (it != sent_us_.end()) {
+          latencies_ms.push_back((received.time_us - it->second) / 1000.0);
+        }
+      }
+    }
+    std::sort(latencies_ms.begin(), latencies_ms.end());
+    uint32_t sent = 0, arbitration_lost = 0;
+    for (const auto &node : nodes_) {
+      sent += node->cec.tx_stats().frames_sent;
+      arbitration_lost += node->cec.tx_stats().arbitration_lost;
+    }
+    auto percentile = [&](double p) {
+      return latencies_ms.empty() ? 0.0 : latencies_ms[(size_t) (p * (latencies_ms.size() - 1))];
+    };
+
+    const std::string name =
+        std::string("bus.") + (options_.saturated ? "saturated." : "light.") + std::to_string(options_.nodes);
+    printf("%-36s %10s\n", name.c_str(), "value");
+    printf("  %-34s %10.2f\n", "frames delivered/s", latencies_ms.size() / options_.seconds);
+    printf("  %-34s %10u\n", "frames failed", (unsigned) failed_);
+    printf("  %-34s %10.3f\n", "arbitration losses/frame", sent ? (double) arbitration_lost / sent : 0.0);
+    printf("  %-34s %10.2f\n", "latency p50 (ms)", percentile(0.5));
+    printf("  %-34s %10.2f\n", "latency p99 (ms)", percentile(0.99));
+    printf("  %-34s %10.2f\n", "latency max (ms)", latencies_ms.empty() ? 0.0 : latencies_ms.back());
+    printf("  %-34s %10.0f\n", "simulation speed (x real time)", options_.seconds / wall_s);
+  }
+
+  Options options_;
+  std::mt19937 random_;
+  Bus bus_;
+  std::vector<std::unique_ptr<Node>> nodes_;
+  std::unordered_map<uint16_t, uint64_t> sent_us_;
+  uint16_t next_id_ = 0;
+  uint32_t failed_ = 0;
+};
+
+int main(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "--nodes") == 0) {
+      options.nodes = std::min<size_t>(std::max(atoi(argv[i + 1]), 2), sizeof(ADDRESSES));
+    } else if (strcmp(argv[i], "--load") == 0) {
+      options.saturated = strcmp(argv[i + 1], "light") != 0;
+    } else if (strcmp(argv[i], "--seconds") == 0) {
+      options.seconds = atof(argv[i + 1]);
+    } else if (strcmp(argv[i], "--seed") == 0) {
+      options.seed = (uint32_t) atoi(argv[i + 1]);
+    }
+  }
+  // the failed sends of a saturated bus are expected: the low priority initiators run out of attempts
+  esphome::host::set_log_level(ESPHOME_LOG_LEVEL_NONE);
+  Benchmark benchmark(options);
+  benchmark.run();
+  return 0;
+}
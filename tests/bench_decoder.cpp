@@ -0,0 +1,122 @@
+// Decoder benchmark, on the corpus and the generated frames. Reports, per frame:
+//  - time to decode into a DecodedMessage, to decode and format it, and to format the frame (hex bytes and text)
+//  - heap allocations (expected: none)
+//  - stack used by decoding and formatting, measured on a thread with a painted stack, less an empty run
+// usage: bench_decoder [--rounds N]
+
+#include <pthread.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "alloc_count.h"
+#include "cec_decoder.h"
+#include "corpus.h"
+
+using namespace esphome::hdmi_cec;
+
+static const size_t STACK_SIZE = 256 * 1024;
+static const uint8_t STACK_PAINT = 0xA5;
+
+// keeps the results alive, so the compiler can't drop the work
+static volatile size_t sink;
+
+static std::vector<Frame> load_frames() {
+  std::vector<Frame> frames = generated_frames();
+  for (const auto &entry : load_corpus()) {
+    frames.push_back(entry.frame);
+  }
+  return frames;
+}
+
+static void decode(const std::vector<Frame> &frames) {
+  for (const auto &frame : frames) {
+    const DecodedMessage message(frame);
+    sink = sink + message.num_operands;
+  }
+}
+
+static void decode_format(const std::vector<Frame> &frames) {
+  for (const auto &frame : frames) {
+    const DecodedMessage message(frame);
+    char text[Frame::MAX_TEXT_LENGTH];
+    sink = sink + message.format(text, sizeof(text));
+  }
+}
+
+static void frame_format(const std::vector<Frame> &frames) {
+  for (const auto &frame : frames) {
+    char text[Frame::MAX_TEXT_LENGTH];
+    sink = sink + frame.format(text, sizeof(text));
+  }
+}
+
+static void *run_thread(void *arg) {
+  (*static_cast<std::function<void()> *>(arg))();
+  return nullptr;
+}
+
+// bytes of stack used by work, on a thread whose stack is painted first
+static size_t stack_used(std::function<void()> work) {
+  static std::vector<uint8_t> stack(STACK_SIZE);
+  memset(stack.data(), STACK_PAINT, stack.size());
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstack(&attr, stack.data(), stack.size());
+  pthread_t thread;
+  if (pthread_create(&thread, &attr, run_thread, &work) != 0) {
+    pthread_attr_destroy(&attr);
+    return 0;
+  }
+  pthread_join(thread, nullptr);
+  pthread_attr_destroy(&attr);
+  // the stack grows down: the lowest byte not painted any more is the deepest use
+  size_t untouched = 0;
+  while (untouched < stack.size() && stack[untouched] == STACK_PAINT) {
+    untouched++;
+  }
+  return stack.size() - untouched;
+}
+
+static void report(const char *name, const std::vector<Frame> &frames, size_t rounds,
+                   void (*work)(const std::vector<Frame> &)) {
+  work(frames);  // warm-up
+
+  const size_t allocations = alloc_count::allocations();
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < rounds; i++) {
+    work(frames);
+  }
+  const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  const double count = (double) frames.size() * rounds;
+  const double allocations_per_frame = (alloc_count::allocations() - allocations) / count;
+
+  const size_t baseline = stack_used([] {});
+  const size_t used = stack_used([&] { work(frames); });
+
+  printf("%-14s %8.1f ns/frame  %6.3f allocations/frame  %5zu bytes of stack\n", name, ns / count,
+         allocations_per_frame, (used > baseline) ? used - baseline : 0);
+}
+
+int main(int argc, char **argv) {
+  size_t rounds = 20;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+      rounds = strtoul(argv[++i], nullptr, 0);
+    } else {
+      fprintf(stderr, "usage: %s [--rounds N]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  const std::vector<Frame> frames = load_frames();
+  printf("%zu frames, %zu rounds\n", frames.size(), rounds);
+  report("decode", frames, rounds, decode);
+  report("decode+format", frames, rounds, decode_format);
+  report("Frame::format", frames, rounds, frame_format);
+  return 0;
+}
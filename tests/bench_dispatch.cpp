@@ -0,0 +1,71 @@
+// on_message dispatch benchmark: 1, 16, 64 and 256 triggers, each for an opcode of its own, and messages of every
+// opcode. Reports the time per message with the opcode tables generated by codegen, and checking every trigger.
+// usage: bench_dispatch [--rounds N]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "dispatch.h"
+
+using namespace esphome::hdmi_cec;
+
+static const size_t TRIGGER_COUNTS[] = {1, 16, 64, 256};
+
+// keeps the results alive, so the compiler can't drop the work
+static volatile size_t sink;
+
+static double ns_per_message(DispatchingHDMICEC &cec, size_t rounds) {
+  Payload messages[256];
+  for (size_t opcode = 0; opcode < 256; opcode++) {
+    messages[opcode] = Payload{(uint8_t) opcode, 0x00};
+  }
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t round = 0; round < rounds; round++) {
+    for (const auto &message : messages) {
+      sink = sink + cec.dispatch_message_(0x4, 0x0, message, true);
+    }
+  }
+  const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  return ns / (256.0 * rounds);
+}
+
+int main(int argc, char **argv) {
+  size_t rounds = 2000;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+      rounds = strtoul(argv[++i], nullptr, 0);
+    } else {
+      fprintf(stderr, "usage: %s [--rounds N]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  printf("%8s %16s %16s\n", "triggers", "tables ns/msg", "linear ns/msg");
+  for (size_t count : TRIGGER_COUNTS) {
+    DispatchingHDMICEC with_tables, linear;
+    std::vector<std::unique_ptr<MessageTrigger>> triggers;
+    std::vector<int> opcodes;
+    for (size_t i = 0; i < count; i++) {
+      // spread over the opcodes, starting with the common ones
+      const uint8_t opcode = (uint8_t) ((0x44 + 37 * i) % 256);
+      for (HDMICEC *cec : {(HDMICEC *) &with_tables, (HDMICEC *) &linear}) {
+        triggers.push_back(std::make_unique<MessageTrigger>(cec));
+        triggers.back()->set_opcode(opcode);
+        triggers.back()->add_listener([](const uint8_t &, const uint8_t &, const Payload &) { sink = sink + 1; });
+      }
+      opcodes.push_back(opcode);
+    }
+    const DispatchTables tables = build_dispatch_tables(opcodes);
+    with_tables.set_tables(tables);
+
+    ns_per_message(with_tables, rounds / 10 + 1);  // warm-up
+    const double tables_ns = ns_per_message(with_tables, rounds);
+    const double linear_ns = ns_per_message(linear, rounds);
+    printf("%8zu %16.1f %16.1f\n", count, tables_ns, linear_ns);
+  }
+  return 0;
+}
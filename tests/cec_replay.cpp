@@ -0,0 +1,214 @@
+// Edge trace replay: plays a binary edge trace (see cec_edge_trace.h, tools/edge_trace_from_log.py) back through
+// the receiver with replay_edge_trace(), as fast as it goes, and prints the frames it got, or checks them against
+// the expected ones. Reports the replay speed against the duration of the trace.
+// It also records a reference trace on the simulated bus, with the frames a node received live from it.
+// usage: cec_replay TRACE [--expect FRAMES] [--rounds N]
+//        cec_replay --record TRACE FRAMES [--frames N] [--seed X]
+// FRAMES: one frame per line in hex ("40:90:01"), '#' starts a comment. Pings are left out, the component
+// doesn't pass them on either.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "cec_edge_trace.h"
+#include "esphome/core/log.h"
+#include "host_hal.h"
+#include "sim_node.h"
+
+using namespace esphome::hdmi_cec;
+using namespace esphome::hdmi_cec::sim;
+
+static std::vector<uint8_t> read_file(const char *path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static std::vector<Frame> read_frames(const char *path) {
+  std::vector<Frame> frames;
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line)) {
+    line = line.substr(0, line.find('#'));
+    Frame frame;
+    for (size_t i = 0; i < line.size() && frame.size() < Frame::MAX_LENGTH;) {
+      while (i < line.size() && (line[i] == ':' || line[i] == ' ')) {
+        i++;
+      }
+      if (i + 2 > line.size()) {
+        break;
+      }
+      frame.push_back((uint8_t) strtoul(line.substr(i, 2).c_str(), nullptr, 16));
+      i += 2;
+    }
+    if (!frame.empty()) {
+      frames.push_back(frame);
+    }
+  }
+  return frames;
+}
+
+static std::string hex(const Frame &frame) {
+  char text[Frame::MAX_TEXT_LENGTH];
+  frame.format(text, sizeof(text), true);
+  return text;
+}
+
+// the time from the first edge of the trace to the last one, from its truncated timestamps
+static uint64_t trace_duration_us(const std::vector<uint8_t> &trace) {
+  uint64_t duration_us = 0;
+  const size_t count = (trace.size() - edge_trace::HEADER_SIZE) / 4;
+  for (size_t i = 1; i < count; i++) {
+    uint32_t previous, current;
+    memcpy(&previous, &trace[edge_trace::HEADER_SIZE + 4 * (i - 1)], 4);
+    memcpy(&current, &trace[edge_trace::HEADER_SIZE + 4 * i], 4);
+    duration_us += (current - previous) & edge_trace::TIME_MASK;
+  }
+  return duration_us;
+}
+
+static int replay(const char *trace_path, const char *expect_path, size_t rounds) {
+  const std::vector<uint8_t> trace = read_file(trace_path);
+  std::vector<Frame> frames;
+  int edges = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t round = 0; round < rounds; round++) {
+    Receiver receiver;
+    frames.clear();
+    edges = replay_edge_trace(trace.data(), trace.size(), receiver, [&](Receiver::Event event) {
+      if (event == Receiver::Event::FrameComplete && receiver.frame().size() > 1) {
+        frames.push_back(receiver.frame());
+      }
+    });
+    if (edges < 0) {
+      fprintf(stderr, "%s: not an edge trace\n", trace_path);
+      return 2;
+    }
+  }
+  const double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / rounds;
+
+  int status = 0;
+  if (expect_path == nullptr) {
+    for (const auto &frame : frames) {
+      printf("%s\n", hex(frame).c_str());
+    }
+  } else {
+    const std::vector<Frame> expected = read_frames(expect_path);
+    for (size_t i = 0; i < std::max(frames.size(), expected.size()); i++) {
+      const std::string got = (i < frames.size()) ? hex(frames[i]) : "(none)";
+      const std::string want = (i < expected.size()) ? hex(expected[i]) : "(none)";
+      if (got != want) {
+        printf("frame %u: replayed %s, expected %s\n", (unsigned) i, got.c_str(), want.c_str());
+        status = 1;
+        break;
+      }
+    }
+  }
+  const double trace_s = trace_duration_us(trace) / 1e6;
+  printf("%-36s %10s\n", "replay", "value");
+  printf("  %-34s %10d\n", "edges", edges);
+  printf("  %-34s %10u\n", "frames", (unsigned) frames.size());
+  printf("  %-34s %10.2f\n", "trace duration (s)", trace_s);
+  printf("  %-34s %10.3f\n", "replay time (ms)", wall_s * 1e3);
+  printf("  %-34s %10.0f\n", "edges/s", edges / wall_s);
+  printf("  %-34s %10.0f\n", "replay speed (x real time)", trace_s / wall_s);
+  if (status != 0) {
+    printf("replayed frames differ from %s\n", expect_path);
+  }
+  return status;
+}
+
+/**
+ * Two nodes send to each other at the same time (so they arbitrate), to a missing device (retransmissions) and
+ * to all, with timing jitter; a third node listens in promiscuous mode, and records the edges.
+ */
+static int record(const char *trace_path, const char *frames_path, size_t count, uint32_t seed) {
+  set_seed(seed);
+  timing() = Timing{5, 5, 20, 5, 20};
+  std::mt19937 random(seed);
+  Bus bus;
+  bus.wire().set_recording(false);
+  Node a(bus, 0x4);
+  Node b(bus, 0x0);
+  Node listener(bus, 0x5);
+  listener.cec.set_promiscuous_mode(true);
+  listener.cec.set_edge_trace_size(100000);
+  bus.run_for(20000);
+
+  auto random_payload = [&]() {
+    static const uint8_t OPCODES[] = {0x90, 0x87, 0x47, 0x84, 0x44, 0x89};
+    Payload data{OPCODES[std::uniform_int_distribution<size_t>(0, sizeof(OPCODES) - 1)(random)]};
+    const size_t length = std::uniform_int_distribution<size_t>(0, 4)(random);
+    for (size_t i = 0; i < length; i++) {
+      data.push_back((uint8_t) random());
+    }
+    return data;
+  };
+  for (size_t i = 0; i < count; i++) {
+    static const uint8_t DESTINATIONS[] = {0x0, 0x5, 0xF, 0x8};
+    const uint8_t to_b = DESTINATIONS[std::uniform_int_distribution<size_t>(0, sizeof(DESTINATIONS) - 1)(random)];
+    size_t pending = 2;
+    a.cec.send(Frame(0x4, to_b, random_payload()), [&](SendResult) { pending--; });
+    b.cec.send(Frame(0x0, 0x4, random_payload()), [&](SendResult) { pending--; });
+    if (!bus.run_until([&]() { return pending == 0; }, 5000000)) {
+      fprintf(stderr, "the simulated bus got stuck\n");
+      return 2;
+    }
+    bus.run_for(std::uniform_int_distribution<uint32_t>(0, 50000)(random));
+  }
+  bus.run_for(100000);
+
+  EdgeTrace &trace = listener.cec.edge_trace();
+  std::vector<uint8_t> data(trace.serialized_size());
+  trace.set_paused(true);
+  trace.serialize(0, data.data(), data.size());
+  trace.set_paused(false);
+  std::ofstream(trace_path, std::ios::binary).write((const char *) data.data(), data.size());
+
+  std::ofstream frames(frames_path);
+  frames << "# frames received live by the listener of the recorded trace, see cec_replay.cpp\n";
+  for (const auto &received : listener.received) {
+    frames << hex(received.frame) << "\n";
+  }
+  printf("recorded %u edges, %u frames\n", (unsigned) trace.count(), (unsigned) listener.received.size());
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  esphome::host::set_log_level(ESPHOME_LOG_LEVEL_NONE);
+  if (argc >= 4 && strcmp(argv[1], "--record") == 0) {
+    size_t count = 50;
+    uint32_t seed = 1;
+    for (int i = 4; i + 1 < argc; i += 2) {
+      if (strcmp(argv[i], "--frames") == 0) {
+        count = (size_t) atoi(argv[i + 1]);
+      } else if (strcmp(argv[i], "--seed") == 0) {
+        seed = (uint32_t) atoi(argv[i + 1]);
+      }
+    }
+    return record(argv[2], argv[3], count, seed);
+  }
+  if (argc < 2) {
+    fprintf(stderr, "usage: cec_replay TRACE [--expect FRAMES] [--rounds N]\n"
+                    "       cec_replay --record TRACE FRAMES [--frames N] [--seed X]\n");
+    return 2;
+  }
+  const char *expect_path = nullptr;
+  size_t rounds = 1;
+  for (int i = 2; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "--expect") == 0) {
+      expect_path = argv[i + 1];
+    } else if (strcmp(argv[i], "--rounds") == 0) {
+      rounds = std::max(atoi(argv[i + 1]), 1);
+    }
+  }
+  return replay(argv[1], expect_path, rounds);
+}
@@ -0,0 +1,51 @@
+#include "corpus.h"
+
+#include <cstdio>
+#include <cstring>
+
+using esphome::hdmi_cec::Frame;
+
+std::vector<CorpusEntry> load_corpus() {
+  std::vector<CorpusEntry> entries;
+  FILE *file = fopen(CORPUS_DIR "/decoder.txt", "r");
+  if (file == nullptr) {
+    printf("cannot open %s\n", CORPUS_DIR "/decoder.txt");
+    return entries;
+  }
+  char line[512];
+  while (fgets(line, sizeof(line), file) != nullptr) {
+    const char *separator = strstr(line, " | ");
+    if (line[0] == '#' || separator == nullptr) {
+      continue;
+    }
+    uint8_t bytes[Frame::MAX_LENGTH];
+    size_t length = 0;
+    unsigned value;
+    for (const char *p = line; p < separator && length < sizeof(bytes) && sscanf(p, "%2x", &value) == 1; p += 3) {
+      bytes[length++] = (uint8_t) value;
+    }
+    std::string text(separator + 3);
+    while (!text.empty() && (text.back() == '\n' || text.back() == '\r')) {
+      text.pop_back();
+    }
+    entries.push_back({Frame(bytes, length), text});
+  }
+  fclose(file);
+  return entries;
+}
+
+std::vector<Frame> generated_frames() {
+  std::vector<Frame> frames;
+  for (int opcode = 0; opcode < 256; opcode++) {
+    for (size_t operands = 0; operands <= Frame::MAX_LENGTH - 2; operands++) {
+      for (int pattern = 0; pattern < 3; pattern++) {
+        uint8_t bytes[Frame::MAX_LENGTH] = {0x40, (uint8_t) opcode};
+        for (size_t i = 0; i < operands; i++) {
+          bytes[2 + i] = (pattern == 0) ? 0x00 : (pattern == 1) ? 0xFF : (uint8_t) (i + 1);
+        }
+        frames.emplace_back(bytes, 2 + operands);
+      }
+    }
+  }
+  return frames;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+// The decoder corpus (corpus/decoder.txt), and generated frames covering every opcode with every length
+
+#include <string>
+#include <vector>
+
+#include "cec_frame.h"
+
+struct CorpusEntry {
+  esphome::hdmi_cec::Frame frame;
+  std::string text;  // expected decoder text
+};
+
+std::vector<CorpusEntry> load_corpus();
+
+// every opcode, with 0 to 14 operand bytes of a few patterns (zeros, ones, counting up):
+// all the entries of the opcode table, with each of their operands complete and cut short
+std::vector<esphome::hdmi_cec::Frame> generated_frames();
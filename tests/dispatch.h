@@ -0,0 +1,36 @@
+#pragma once
+
+// The on_message dispatch of HDMICEC, with the opcode tables built like codegen does (build_dispatch_tables() in
+// __init__.py)
+
+#include <cstdint>
+#include <vector>
+
+#include "hdmi_cec.h"
+
+struct DispatchTables {
+  std::vector<uint16_t> index;
+  std::vector<uint16_t> order;
+};
+
+// 'opcodes' has the opcode of each trigger, or -1 for the triggers that may match any opcode
+inline DispatchTables build_dispatch_tables(const std::vector<int> &opcodes) {
+  std::vector<std::vector<uint16_t>> groups(257);
+  for (size_t position = 0; position < opcodes.size(); position++) {
+    groups[(opcodes[position] < 0) ? 256 : opcodes[position]].push_back((uint16_t) position);
+  }
+  DispatchTables tables;
+  for (const auto &group : groups) {
+    tables.index.push_back((uint16_t) tables.order.size());
+    tables.order.insert(tables.order.end(), group.begin(), group.end());
+  }
+  return tables;
+}
+
+class DispatchingHDMICEC : public esphome::hdmi_cec::HDMICEC {
+ public:
+  using HDMICEC::dispatch_message_;
+  void set_tables(const DispatchTables &tables) {
+    set_message_dispatch(tables.index.data(), tables.order.data(), (uint16_t) tables.order.size());
+  }
+};
@@ -0,0 +1,68 @@
+# Flash and RAM of the component with decode_messages (USE_CEC_DECODER) and without, from the sections of the
+# two footprint programs (`size -A`). Linked with --gc-sections, like a firmware, so only what is used counts.
+#   cmake -DSIZE=size -DWITH=footprint_decoder -DWITHOUT=footprint_plain -P footprint.cmake
+# On the host, tables of pointers land in .data.rel.ro (read-only once relocated): on the devices they are
+# flash, so they count as flash here. The strings they point to are in .rodata: flash on the ESP32 and the RP2040,
+# but RAM on the ESP8266, which maps .rodata to DRAM (only PROGMEM data stays in flash there).
+# Static initializers are the .init_array entries, run before setup().
+
+function(measure program prefix)
+  execute_process(COMMAND ${SIZE} -A ${program} OUTPUT_VARIABLE output RESULT_VARIABLE result)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${SIZE} -A ${program} failed")
+  endif()
+  set(code 0)
+  set(constants 0)
+  set(rodata 0)
+  set(data 0)
+  set(bss 0)
+  set(initializers 0)
+  string(REPLACE "\n" ";" lines "${output}")
+  foreach(line ${lines})
+    if(NOT line MATCHES "^(\\.[A-Za-z0-9_.]+) +([0-9]+)")
+      continue()
+    endif()
+    set(section ${CMAKE_MATCH_1})
+    set(bytes ${CMAKE_MATCH_2})
+    if(section MATCHES "^\\.text")
+      math(EXPR code "${code} + ${bytes}")
+    elseif(section MATCHES "^\\.rodata")
+      math(EXPR rodata "${rodata} + ${bytes}")
+      math(EXPR constants "${constants} + ${bytes}")
+    elseif(section MATCHES "^\\.data\\.rel\\.ro")
+      math(EXPR constants "${constants} + ${bytes}")
+    elseif(section STREQUAL ".data")
+      math(EXPR data "${data} + ${bytes}")
+    elseif(section STREQUAL ".bss")
+      math(EXPR bss "${bss} + ${bytes}")
+    elseif(section STREQUAL ".init_array")
+      math(EXPR initializers "${initializers} + ${bytes} / 8")
+    endif()
+  endforeach()
+  math(EXPR flash "${code} + ${constants} + ${data}")
+  math(EXPR ram "${data} + ${bss}")
+  foreach(name code constants rodata data bss flash ram initializers)
+    set(${prefix}_${name} ${${name}} PARENT_SCOPE)
+  endforeach()
+endfunction()
+
+measure(${WITH} with)
+measure(${WITHOUT} without)
+
+function(row label name)
+  math(EXPR difference "${with_${name}} - ${without_${name}}")
+  string(LENGTH "${label}" length)
+  math(EXPR padding "32 - ${length}")
+  string(REPEAT " " ${padding} spaces)
+  message("${label}${spaces}${with_${name}}\t${without_${name}}\t${difference}")
+endfunction()
+
+message("component footprint, bytes       decode_messages: true\tfalse\tdifference")
+row("code (.text)" code)
+row("constants (.rodata, .rel.ro)" constants)
+row("  .rodata (RAM on the ESP8266)" rodata)
+row("initialized data (.data)" data)
+row("zeroed data (.bss)" bss)
+row("flash: code + constants + data" flash)
+row("RAM: data + bss" ram)
+row("static initializers" initializers)
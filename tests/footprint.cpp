@@ -0,0 +1,11 @@
+// Smallest program that keeps the whole component: the vtable of HDMICEC keeps setup(), loop(), dump_config()
+// and everything they call. Built with and without decode_messages, for footprint.cmake to compare their sizes.
+
+#include "hdmi_cec.h"
+
+using namespace esphome::hdmi_cec;
+
+int main() {
+  static HDMICEC cec;
+  return cec.get_setup_priority() < 0.0f;
+}
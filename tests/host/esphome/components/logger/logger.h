@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace logger {
+
+// Runtime log level, like the logger component's 'level_for()': see host::set_log_level
+class Logger {
+ public:
+  uint8_t level_for(const char *tag);
+};
+
+extern Logger *global_logger;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+}  // namespace logger
+}  // namespace esphome
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "esphome/core/component.h"
+#include "esphome/core/helpers.h"
+
+namespace esphome {
+
+#define TEMPLATABLE_VALUE_(type, name) \
+ protected: \
+  TemplatableValue<type, Ts...> name##_{}; \
+\
+ public: \
+  template<typename V> void set_##name(V name) { this->name##_ = name; }
+
+#define TEMPLATABLE_VALUE(type, name) TEMPLATABLE_VALUE_(type, name)
+
+template<typename T, typename... X> class TemplatableValue {
+ public:
+  TemplatableValue() = default;
+  TemplatableValue(T value) : value_(std::move(value)), has_value_(true) {}
+  template<typename F, typename = decltype(std::declval<F>()(std::declval<X>()...))>
+  TemplatableValue(F lambda) : lambda_(lambda), has_value_(true) {}
+
+  bool has_value() const { return has_value_; }
+  T value(X... x) const { return lambda_ ? lambda_(x...) : value_; }
+
+ protected:
+  T value_{};
+  std::function<T(X...)> lambda_;
+  bool has_value_{false};
+};
+
+/**
+ * On the host, a trigger runs the listeners the tests added, in place of the automations of a configuration.
+ */
+template<typename... Ts> class Trigger {
+ public:
+  void trigger(const Ts &...x) {
+    for (auto &listener : listeners_) {
+      listener(x...);
+    }
+  }
+  void add_listener(std::function<void(const Ts &...)> &&listener) { listeners_.push_back(std::move(listener)); }
+  bool is_action_running() { return false; }
+  void stop_action() {}
+
+ protected:
+  std::vector<std::function<void(const Ts &...)>> listeners_;
+};
+
+template<typename... Ts> class ActionList;
+
+template<typename... Ts> class Action {
+ public:
+  virtual ~Action() = default;
+  virtual void play_complex(const Ts &...x) {
+    this->num_running_++;
+    this->play(x...);
+    this->play_next_(x...);
+  }
+  virtual void stop_complex() {
+    if (this->num_running_ > 0) {
+      this->stop();
+      this->num_running_ = 0;
+    }
+    if (this->next_ != nullptr) {
+      this->next_->stop_complex();
+    }
+  }
+  virtual bool is_running() { return this->num_running_ > 0; }
+
+ protected:
+  friend ActionList<Ts...>;
+
+  virtual void play(const Ts &...x) = 0;
+  virtual void stop() {}
+  void play_next_(const Ts &...x) {
+    if (this->num_running_ > 0) {
+      this->num_running_--;
+      if (this->next_ != nullptr) {
+        this->next_->play_complex(x...);
+      }
+    }
+  }
+
+  Action<Ts...> *next_{nullptr};
+  int num_running_{0};
+};
+
+/**
+ * The actions of an automation, each one started by the previous one once it's done.
+ */
+template<typename... Ts> class ActionList {
+ public:
+  void add_action(Action<Ts...> *action) {
+    if (this->actions_end_ == nullptr) {
+      this->actions_begin_ = action;
+    } else {
+      this->actions_end_->next_ = action;
+    }
+    this->actions_end_ = action;
+  }
+  void play(const Ts &...x) {
+    if (this->actions_begin_ != nullptr) {
+      this->actions_begin_->play_complex(x...);
+    }
+  }
+  void stop() {
+    if (this->actions_begin_ != nullptr) {
+      this->actions_begin_->stop_complex();
+    }
+  }
+
+ protected:
+  Action<Ts...> *actions_begin_{nullptr};
+  Action<Ts...> *actions_end_{nullptr};
+};
+
+/**
+ * An action that runs a function, like a lambda action of a configuration.
+ */
+template<typename... Ts> class LambdaAction : public Action<Ts...> {
+ public:
+  explicit LambdaAction(std::function<void(const Ts &...)> &&f) : f_(std::move(f)) {}
+
+ protected:
+  void play(const Ts &...x) override { this->f_(x...); }
+
+  std::function<void(const Ts &...)> f_;
+};
+
+}  // namespace esphome
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+
+namespace esphome {
+
+namespace setup_priority {
+extern const float HARDWARE;
+extern const float DATA;
+}  // namespace setup_priority
+
+class Component {
+ public:
+  virtual ~Component() = default;
+  virtual void setup() {}
+  virtual void loop() {}
+  virtual void dump_config() {}
+  virtual float get_setup_priority() const;
+
+  // One iteration of the application's main loop for this component: setup() the first time, then loop()
+  // while the loop is enabled
+  void call();
+  void mark_failed();
+  bool is_failed() const { return state_ == State::Failed; }
+  bool is_loop_enabled() const { return state_ == State::Loop; }
+  void disable_loop();
+  void enable_loop();
+  // from any thread or interrupt: the loop is enabled again on the next iteration
+  void enable_loop_soon_any_context() { pending_enable_loop_ = true; }
+
+ protected:
+  enum class State : uint8_t { Construction, Loop, LoopDone, Failed };
+  State state_{State::Construction};
+  std::atomic<bool> pending_enable_loop_{false};
+};
+
+}  // namespace esphome
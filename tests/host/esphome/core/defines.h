@@ -0,0 +1,3 @@
+#pragma once
+
+// The host builds pass the component options on the compiler command line (see tests/CMakeLists.txt).
@@ -0,0 +1,79 @@
+#pragma once
+
+// Host stand-in for the ESPHome HAL: the clock is virtual, and the pins are provided by the tests (see sim/).
+
+#include <cstddef>
+#include <cstdint>
+
+#define IRAM_ATTR
+#define PROGMEM
+
+namespace esphome {
+
+uint32_t micros();
+uint32_t millis();
+void delay(uint32_t ms);
+void delay_microseconds_safe(uint32_t us);
+void yield();
+
+inline uint8_t progmem_read_byte(const uint8_t *addr) { return *addr; }
+inline uint16_t progmem_read_uint16(const uint16_t *addr) { return *addr; }
+inline const char *progmem_read_ptr(const char *const *addr) { return *addr; }
+
+namespace gpio {
+
+enum Flags : uint8_t {
+  FLAG_NONE = 0x00,
+  FLAG_INPUT = 0x01,
+  FLAG_OUTPUT = 0x02,
+  FLAG_OPEN_DRAIN = 0x04,
+  FLAG_PULLUP = 0x08,
+  FLAG_PULLDOWN = 0x10,
+};
+
+inline constexpr Flags operator|(Flags a, Flags b) { return static_cast<Flags>((uint8_t) a | (uint8_t) b); }
+inline constexpr Flags operator&(Flags a, Flags b) { return static_cast<Flags>((uint8_t) a & (uint8_t) b); }
+
+enum InterruptType : uint8_t {
+  INTERRUPT_RISING_EDGE = 1,
+  INTERRUPT_FALLING_EDGE = 2,
+  INTERRUPT_ANY_EDGE = 3,
+};
+
+}  // namespace gpio
+
+class InternalGPIOPin;
+
+// Copy of a pin usable from interrupt handlers; on the host it forwards to the pin itself
+class ISRInternalGPIOPin {
+ public:
+  ISRInternalGPIOPin() = default;
+  explicit ISRInternalGPIOPin(InternalGPIOPin *pin) : pin_(pin) {}
+  bool digital_read();
+  void digital_write(bool value);
+  void pin_mode(gpio::Flags flags);
+
+ protected:
+  InternalGPIOPin *pin_{nullptr};
+};
+
+class InternalGPIOPin {
+ public:
+  virtual ~InternalGPIOPin() = default;
+  virtual void setup() = 0;
+  virtual void pin_mode(gpio::Flags flags) = 0;
+  virtual bool digital_read() = 0;
+  virtual void digital_write(bool value) = 0;
+  virtual uint8_t get_pin() const = 0;
+  virtual void detach_interrupt() const = 0;
+  virtual ISRInternalGPIOPin to_isr() const = 0;
+
+  template<typename T> void attach_interrupt(void (*func)(T *), T *arg, gpio::InterruptType type) const {
+    this->attach_interrupt(reinterpret_cast<void (*)(void *)>(func), arg, type);
+  }
+
+ protected:
+  virtual void attach_interrupt(void (*func)(void *), void *arg, gpio::InterruptType type) const = 0;
+};
+
+}  // namespace esphome
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "esphome/core/optional.h"
+
+namespace esphome {
+
+class Mutex {
+ public:
+  Mutex() = default;
+  Mutex(const Mutex &) = delete;
+  Mutex &operator=(const Mutex &) = delete;
+  void lock() { mutex_.lock(); }
+  bool try_lock() { return mutex_.try_lock(); }
+  void unlock() { mutex_.unlock(); }
+
+ protected:
+  std::mutex mutex_;
+};
+
+class LockGuard {
+ public:
+  LockGuard(Mutex &mutex) : mutex_(mutex) { mutex_.lock(); }
+  ~LockGuard() { mutex_.unlock(); }
+
+ protected:
+  Mutex &mutex_;
+};
+
+/**
+ * Keeps the simulated interrupt handlers from running meanwhile: on the host, the "interrupts" are whatever the
+ * tests run from another thread, under the same (recursive) lock (see host::InterruptContext).
+ */
+class InterruptLock {
+ public:
+  InterruptLock();
+  ~InterruptLock();
+};
+
+template<typename... X> class CallbackManager;
+
+template<typename... Ts> class CallbackManager<void(Ts...)> {
+ public:
+  void add(std::function<void(Ts...)> &&callback) { callbacks_.push_back(std::move(callback)); }
+  void call(Ts... args) {
+    for (auto &callback : callbacks_) {
+      callback(args...);
+    }
+  }
+  size_t size() const { return callbacks_.size(); }
+
+ protected:
+  std::vector<std::function<void(Ts...)>> callbacks_;
+};
+
+template<typename T> class Parented {
+ public:
+  Parented() {}
+  Parented(T *parent) : parent_(parent) {}
+  T *get_parent() const { return parent_; }
+  void set_parent(T *parent) { parent_ = parent; }
+
+ protected:
+  T *parent_{nullptr};
+};
+
+}  // namespace esphome
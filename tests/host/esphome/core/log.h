@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdarg>
+#include <cstdint>
+
+#define ESPHOME_LOG_LEVEL_NONE 0
+#define ESPHOME_LOG_LEVEL_ERROR 1
+#define ESPHOME_LOG_LEVEL_WARN 2
+#define ESPHOME_LOG_LEVEL_INFO 3
+#define ESPHOME_LOG_LEVEL_CONFIG 4
+#define ESPHOME_LOG_LEVEL_DEBUG 5
+#define ESPHOME_LOG_LEVEL_VERBOSE 6
+#define ESPHOME_LOG_LEVEL_VERY_VERBOSE 7
+
+// everything is compiled in, like a firmware built with 'logger: level: VERY_VERBOSE'; the level that is
+// actually printed is set at runtime by the tests (see host::set_log_level)
+#ifndef ESPHOME_LOG_LEVEL
+#define ESPHOME_LOG_LEVEL ESPHOME_LOG_LEVEL_VERY_VERBOSE
+#endif
+
+namespace esphome {
+
+void esp_log_printf_(int level, const char *tag, int line, const char *format, ...)  // NOLINT
+    __attribute__((format(printf, 4, 5)));
+
+}  // namespace esphome
+
+#define ESP_LOGE(tag, ...) ::esphome::esp_log_printf_(ESPHOME_LOG_LEVEL_ERROR, tag, __LINE__, __VA_ARGS__)
+#define ESP_LOGW(tag, ...) ::esphome::esp_log_printf_(ESPHOME_LOG_LEVEL_WARN, tag, __LINE__, __VA_ARGS__)
+#define ESP_LOGI(tag, ...) ::esphome::esp_log_printf_(ESPHOME_LOG_LEVEL_INFO, tag, __LINE__, __VA_ARGS__)
+#define ESP_LOGCONFIG(tag, ...) ::esphome::esp_log_printf_(ESPHOME_LOG_LEVEL_CONFIG, tag, __LINE__, __VA_ARGS__)
+#define ESP_LOGD(tag, ...) ::esphome::esp_log_printf_(ESPHOME_LOG_LEVEL_DEBUG, tag, __LINE__, __VA_ARGS__)
+#define ESP_LOGV(tag, ...) ::esphome::esp_log_printf_(ESPHOME_LOG_LEVEL_VERBOSE, tag, __LINE__, __VA_ARGS__)
+#define ESP_LOGVV(tag, ...) ::esphome::esp_log_printf_(ESPHOME_LOG_LEVEL_VERY_VERBOSE, tag, __LINE__, __VA_ARGS__)
+
+#define LOG_PIN(prefix, pin) \
+  if ((pin) != nullptr) { \
+    ESP_LOGCONFIG(TAG, prefix "GPIO%u", (unsigned) (pin)->get_pin()); \
+  }
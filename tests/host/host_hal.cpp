@@ -0,0 +1,130 @@
+#include "host_hal.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#include "esphome/components/logger/logger.h"
+#include "esphome/core/component.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+
+namespace esphome {
+
+namespace host {
+
+static std::atomic<uint64_t> clock_us{1000000};
+static std::atomic<bool> real_clock{false};
+static std::atomic<int> level{ESPHOME_LOG_LEVEL_WARN};
+
+static uint64_t real_time_us() {
+  static const auto start = std::chrono::steady_clock::now();
+  return 1000000 +
+         std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+uint64_t time_us() { return real_clock ? real_time_us() : clock_us.load(); }
+void set_time_us(uint64_t time_us) { clock_us = time_us; }
+void advance_time_us(uint64_t delta_us) { clock_us += delta_us; }
+void use_real_clock(bool real) { real_clock = real; }
+
+void set_log_level(int log_level) { level = log_level; }
+int log_level() { return level; }
+
+std::recursive_mutex &interrupt_mutex() {
+  static std::recursive_mutex mutex;
+  return mutex;
+}
+
+}  // namespace host
+
+uint32_t micros() { return (uint32_t) host::time_us(); }
+uint32_t millis() { return (uint32_t) (host::time_us() / 1000); }
+
+void delay(uint32_t ms) { delay_microseconds_safe(ms * 1000); }
+
+// a busy wait: with the virtual clock, the time passes without anything else running meanwhile
+void delay_microseconds_safe(uint32_t us) {
+  if (host::real_clock) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+  } else {
+    host::advance_time_us(us);
+  }
+}
+
+void yield() { std::this_thread::yield(); }
+
+bool ISRInternalGPIOPin::digital_read() { return pin_->digital_read(); }
+void ISRInternalGPIOPin::digital_write(bool value) { pin_->digital_write(value); }
+void ISRInternalGPIOPin::pin_mode(gpio::Flags flags) { pin_->pin_mode(flags); }
+
+InterruptLock::InterruptLock() { host::interrupt_mutex().lock(); }
+InterruptLock::~InterruptLock() { host::interrupt_mutex().unlock(); }
+
+void esp_log_printf_(int level, const char *tag, int line, const char *format, ...) {  // NOLINT
+  if (level > host::log_level()) {
+    return;
+  }
+  static const char LETTERS[] = "-EWICDVV";
+  char text[512];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+  printf("[%9.3f][%c][%s:%d] %s\n", host::time_us() / 1e6, LETTERS[level], tag, line, text);
+}
+
+namespace logger {
+
+uint8_t Logger::level_for(const char *tag) { return (uint8_t) host::log_level(); }
+
+static Logger logger_instance;
+Logger *global_logger = &logger_instance;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+}  // namespace logger
+
+namespace setup_priority {
+const float HARDWARE = 800.0f;
+const float DATA = 600.0f;
+}  // namespace setup_priority
+
+float Component::get_setup_priority() const { return setup_priority::DATA; }
+
+void Component::call() {
+  switch (state_) {
+    case State::Construction:
+      state_ = State::Loop;
+      setup();
+      break;
+    case State::LoopDone:
+      if (pending_enable_loop_.exchange(false)) {
+        state_ = State::Loop;
+        loop();
+      }
+      break;
+    case State::Loop:
+      pending_enable_loop_ = false;
+      loop();
+      break;
+    case State::Failed:
+      break;
+  }
+}
+
+void Component::mark_failed() { state_ = State::Failed; }
+
+void Component::disable_loop() {
+  if (state_ == State::Loop) {
+    state_ = State::LoopDone;
+  }
+}
+
+void Component::enable_loop() {
+  if (state_ == State::LoopDone) {
+    state_ = State::Loop;
+  }
+}
+
+}  // namespace esphome
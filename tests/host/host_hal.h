@@ -0,0 +1,33 @@
+#pragma once
+
+// Test-side controls of the host HAL (see esphome/core/hal.h)
+
+#include <cstdint>
+#include <mutex>
+
+namespace esphome {
+namespace host {
+
+// The clock behind micros() and millis(): virtual, it only moves when the tests (or delays) move it
+uint64_t time_us();
+void set_time_us(uint64_t time_us);
+void advance_time_us(uint64_t delta_us);
+// With the real clock, micros() and millis() follow the monotonic clock of the host instead
+void use_real_clock(bool real_clock);
+
+// Lines below this level are not printed; ESP_LOGx still formats them, see logger::Logger::level_for()
+void set_log_level(int level);
+int log_level();
+
+// Held while a test thread plays an interrupt handler, so it excludes the InterruptLock holders like one
+std::recursive_mutex &interrupt_mutex();
+class InterruptContext {
+ public:
+  InterruptContext() : lock_(interrupt_mutex()) {}
+
+ protected:
+  std::lock_guard<std::recursive_mutex> lock_;
+};
+
+}  // namespace host
+}  // namespace esphome
@@ -0,0 +1,233 @@
+#include "sim_bus.h"
+
+#include <algorithm>
+
+#include "alloc_count.h"
+#include "cec_timer.h"
+#include "host_hal.h"
+
+namespace esphome {
+namespace hdmi_cec {
+namespace sim {
+
+static std::mt19937 &random_engine() {
+  static std::mt19937 engine(1);
+  return engine;
+}
+
+void set_seed(uint32_t seed) { random_engine().seed(seed); }
+
+Timing &timing() {
+  static Timing timing;
+  return timing;
+}
+
+static uint32_t delay_with_jitter(uint32_t latency_us, uint32_t jitter_us) {
+  if (jitter_us == 0) {
+    return latency_us;
+  }
+  return latency_us + std::uniform_int_distribution<uint32_t>(0, jitter_us)(random_engine());
+}
+
+Scheduler &Scheduler::get() {
+  static Scheduler scheduler;
+  return scheduler;
+}
+
+uint64_t Scheduler::now() const { return host::time_us(); }
+
+uint64_t Scheduler::at(uint64_t time_us, Callback callback) {
+  // the event queue of the simulator is not part of the components under test
+  alloc_count::Pause pause;
+  const uint64_t id = next_id_++;
+  if (time_us < now()) {
+    time_us = now();
+  }
+  events_.emplace(std::make_pair(time_us, id), std::move(callback));
+  times_[id] = time_us;
+  return id;
+}
+
+void Scheduler::cancel(uint64_t id) {
+  auto it = times_.find(id);
+  if (it == times_.end()) {
+    return;
+  }
+  events_.erase(std::make_pair(it->second, id));
+  times_.erase(it);
+}
+
+bool Scheduler::run_next_(uint64_t end_us) {
+  auto it = events_.begin();
+  if (it == events_.end() || it->first.first > end_us) {
+    return false;
+  }
+  // a busy wait in the previous event may have moved the clock past this one: it runs late
+  if (it->first.first > now()) {
+    host::set_time_us(it->first.first);
+  }
+  Callback callback = std::move(it->second);
+  times_.erase(it->first.second);
+  events_.erase(it);
+  events_run_++;
+  callback();
+  return true;
+}
+
+void Scheduler::run_until(uint64_t end_us) {
+  while (run_next_(end_us)) {
+  }
+  if (end_us > now()) {
+    host::set_time_us(end_us);
+  }
+}
+
+bool Scheduler::run_until(const std::function<bool()> &done, uint64_t timeout_us) {
+  const uint64_t end_us = now() + timeout_us;
+  while (!done()) {
+    if (!run_next_(end_us)) {
+      host::set_time_us(end_us);
+      return done();
+    }
+  }
+  return true;
+}
+
+void Wire::drive(int source, bool low) {
+  const bool before = level();
+  if (low) {
+    if (low_drivers_ == 0) {
+      first_low_source_ = source;
+    }
+    low_drivers_ |= 1ULL << source;
+  } else {
+    low_drivers_ &= ~(1ULL << source);
+  }
+  if (level() == before) {
+    return;
+  }
+  const Edge edge{Scheduler::get().now(), level(), level() ? source : first_low_source_};
+  std::copy_backward(recent_edges_.begin(), recent_edges_.end() - 1, recent_edges_.end());
+  recent_edges_[0] = edge;
+  if (recording_) {
+    edges_.push_back(edge);
+  }
+  for (auto *pin : pins_) {
+    pin->on_level_change();
+  }
+}
+
+bool Wire::input_level() const {
+  const uint64_t now = Scheduler::get().now();
+  for (const auto &edge : recent_edges_) {
+    if (edge.time_us + timing().propagation_us <= now) {
+      return edge.level;
+    }
+  }
+  // all of them too recent: the level before the oldest one
+  return !recent_edges_.back().level;
+}
+
+std::vector<LowPulse> Wire::low_pulses() const {
+  std::vector<LowPulse> pulses;
+  for (size_t i = 0; i + 1 < edges_.size(); i++) {
+    if (!edges_[i].level && edges_[i + 1].level) {
+      pulses.push_back({edges_[i].time_us, (uint32_t) (edges_[i + 1].time_us - edges_[i].time_us), edges_[i].source});
+    }
+  }
+  return pulses;
+}
+
+std::vector<WireFrame> Wire::frames() const {
+  std::vector<WireFrame> frames;
+  for (const auto &pulse : low_pulses()) {
+    if (pulse.duration_us >= START_PULSE_MIN_US) {
+      frames.push_back({pulse.start_us, pulse.start_us, pulse.source, 0});
+    } else if (!frames.empty()) {
+      frames.back().last_bit_us = pulse.start_us;
+      frames.back().bits++;
+    }
+  }
+  return frames;
+}
+
+void SimPin::pin_mode(gpio::Flags flags) {
+  output_ = (flags & gpio::FLAG_OUTPUT) != 0;
+  update_();
+}
+
+void SimPin::digital_write(bool value) {
+  value_ = value;
+  update_();
+}
+
+void SimPin::update_() { wire_->drive(pin_, output_ && !value_); }
+
+void SimPin::attach_interrupt(void (*func)(void *), void *arg, gpio::InterruptType type) const {
+  isr_ = func;
+  isr_arg_ = arg;
+}
+
+void SimPin::on_level_change() {
+  if (isr_ == nullptr) {
+    return;
+  }
+  const uint32_t delay_us =
+      timing().propagation_us + delay_with_jitter(timing().isr_latency_us, timing().isr_jitter_us);
+  Scheduler::get().after(delay_us, [this]() {
+    if (isr_ != nullptr) {
+      host::InterruptContext context;
+      isr_(isr_arg_);
+    }
+  });
+}
+
+Bus::Bus(uint32_t loop_interval_us) : loop_interval_us_(loop_interval_us) {
+  Scheduler::get().after(0, [this]() { loop_(); });
+}
+
+SimPin *Bus::add_pin() {
+  pins_.push_back(std::make_unique<SimPin>(&wire_, (uint8_t) pins_.size()));
+  return pins_.back().get();
+}
+
+void Bus::add_component(Component *component) { components_.emplace_back(component, false); }
+
+void Bus::pause_loop(Component *component, bool paused) {
+  for (auto &entry : components_) {
+    if (entry.first == component) {
+      entry.second = paused;
+    }
+  }
+}
+
+void Bus::loop_() {
+  for (auto &entry : components_) {
+    if (!entry.second) {
+      entry.first->call();
+    }
+  }
+  Scheduler::get().after(loop_interval_us_, [this]() { loop_(); });
+}
+
+// the hardware timer of TimerService, see cec_timer.h
+static uint64_t timer_event = 0;
+
+void arm_timer(uint32_t delay_us, void (*alarm)(void *arg), void *arg) {
+  Scheduler::get().cancel(timer_event);
+  delay_us += delay_with_jitter(timing().timer_latency_us, timing().timer_jitter_us);
+  timer_event = Scheduler::get().after(delay_us, [alarm, arg]() {
+    timer_event = 0;
+    host::InterruptContext context;
+    alarm(arg);
+  });
+}
+
+void disarm_timer() {
+  Scheduler::get().cancel(timer_event);
+  timer_event = 0;
+}
+
+}  // namespace sim
+}  // namespace hdmi_cec
+}  // namespace esphome
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "esphome/core/component.h"
+#include "esphome/core/hal.h"
+
+namespace esphome {
+namespace hdmi_cec {
+namespace sim {
+
+/**
+ * Discrete-event clock: the events run in time order, and the virtual clock behind micros() jumps from one to
+ * the next. Everything the nodes of a simulated bus do (interrupt handlers, timer callbacks, loop iterations)
+ * is an event, so a test runs the same way every time, much faster than real time.
+ */
+class Scheduler {
+ public:
+  using Callback = std::function<void()>;
+
+  static Scheduler &get();
+
+  uint64_t now() const;
+  // @return an id, to cancel the event
+  uint64_t at(uint64_t time_us, Callback callback);
+  uint64_t after(uint64_t delay_us, Callback callback) { return at(now() + delay_us, std::move(callback)); }
+  void cancel(uint64_t id);
+  // run the events up to 'end_us', and leave the clock there
+  void run_until(uint64_t end_us);
+  // run the events until 'done()' holds, for at most 'timeout_us'. @return done()
+  bool run_until(const std::function<bool()> &done, uint64_t timeout_us);
+  uint64_t events_run() const { return events_run_; }
+
+ protected:
+  bool run_next_(uint64_t end_us);
+
+  std::map<std::pair<uint64_t, uint64_t>, Callback> events_;  // by (time, id)
+  std::unordered_map<uint64_t, uint64_t> times_;              // time of each pending event, by id
+  uint64_t next_id_{1};
+  uint64_t events_run_{0};
+};
+
+/**
+ * Delays between a cause and its effect:
+ *  - propagation: a level change of the wire only shows at the inputs after the edge time of the line, so
+ *    nodes that check the line within that delay all see it free (and go on to arbitrate)
+ *  - interrupt: input level change -> GPIO interrupt handler of each node
+ *  - timer: requested expiry -> timer callback
+ * The interrupt and timer delays are drawn uniformly from [latency, latency + jitter].
+ */
+struct Timing {
+  uint32_t propagation_us = 5;
+  uint32_t isr_latency_us = 2;
+  uint32_t isr_jitter_us = 0;
+  uint32_t timer_latency_us = 2;
+  uint32_t timer_jitter_us = 0;
+};
+Timing &timing();
+void set_seed(uint32_t seed);
+
+class SimPin;
+
+// A level change of the wire, and the pin that caused it
+struct Edge {
+  uint64_t time_us;
+  bool level;
+  int source;  // pin number, or the id passed to Wire::drive()
+};
+
+// A low period of the wire: from a falling edge to the next rising edge
+struct LowPulse {
+  uint64_t start_us;
+  uint32_t duration_us;
+  int source;  // whoever pulled the line low first
+};
+
+// The pulses of a frame on the wire, from its start bit on (also a frame cut short by an arbitration loss)
+struct WireFrame {
+  uint64_t start_us;      // falling edge of the start bit
+  uint64_t last_bit_us;   // falling edge of the last bit
+  int initiator;          // whoever pulled the start bit low
+  size_t bits;            // bits after the start bit
+};
+
+// start bits are long low pulses, 3.7 ms nominal
+constexpr uint32_t START_PULSE_MIN_US = 3500;
+
+/**
+ * Open-drain CEC line with its pull-up: it is low as long as any driver pulls it low.
+ */
+class Wire {
+ public:
+  bool level() const { return low_drivers_ == 0; }
+  // the level as the inputs see it, see Timing::propagation_us
+  bool input_level() const;
+  // pull the line low (or release it) on behalf of 'source', e.g. to inject a glitch
+  void drive(int source, bool low);
+  void attach(SimPin *pin) { pins_.push_back(pin); }
+
+  void set_recording(bool recording) { recording_ = recording; }
+  const std::vector<Edge> &edges() const { return edges_; }
+  std::vector<LowPulse> low_pulses() const;
+  std::vector<WireFrame> frames() const;
+  void clear_edges() { edges_.clear(); }
+
+ protected:
+  uint64_t low_drivers_{0};  // bit N: source N pulls the line low
+  int first_low_source_{-1};
+  std::vector<SimPin *> pins_;
+  bool recording_{true};
+  std::vector<Edge> edges_;
+  // the last level changes, most recent first (the line starts high)
+  std::array<Edge, 4> recent_edges_{{{0, true, -1}, {0, true, -1}, {0, true, -1}, {0, true, -1}}};
+
+};
+
+/**
+ * GPIO pin of a node, connected to the wire: in output mode with a '0' written, it pulls the line low.
+ * Each level change of the line runs the attached interrupt handler, after the interrupt latency.
+ */
+class SimPin : public InternalGPIOPin {
+ public:
+  SimPin(Wire *wire, uint8_t pin) : wire_(wire), pin_(pin) { wire->attach(this); }
+
+  void setup() override {}
+  void pin_mode(gpio::Flags flags) override;
+  bool digital_read() override { return wire_->input_level(); }
+  void digital_write(bool value) override;
+  uint8_t get_pin() const override { return pin_; }
+  void detach_interrupt() const override { isr_ = nullptr; }
+  ISRInternalGPIOPin to_isr() const override { return ISRInternalGPIOPin(const_cast<SimPin *>(this)); }
+
+  // called by the wire on every level change
+  void on_level_change();
+
+ protected:
+  void attach_interrupt(void (*func)(void *), void *arg, gpio::InterruptType type) const override;
+  void update_();
+
+  Wire *wire_;
+  uint8_t pin_;
+  bool output_{false};
+  bool value_{true};
+  mutable void (*isr_)(void *){nullptr};
+  mutable void *isr_arg_{nullptr};
+};
+
+/**
+ * A CEC bus with its nodes: the wire, the pins, and the main loop of each node, run every 'loop_interval_us'
+ * (the components disable their loop while idle, like on a device).
+ */
+class Bus {
+ public:
+  explicit Bus(uint32_t loop_interval_us = 1000);
+
+  Wire &wire() { return wire_; }
+  SimPin *add_pin();
+  // run 'component' from the main loop; its setup() runs on the first iteration
+  void add_component(Component *component);
+  // hold the main loop of 'component', e.g. to let its receive queue fill up
+  void pause_loop(Component *component, bool paused);
+
+  void run_for(uint64_t duration_us) { Scheduler::get().run_until(Scheduler::get().now() + duration_us); }
+  bool run_until(const std::function<bool()> &done, uint64_t timeout_us) {
+    return Scheduler::get().run_until(done, timeout_us);
+  }
+
+ protected:
+  void loop_();
+
+  uint32_t loop_interval_us_;
+  Wire wire_;
+  std::vector<std::unique_ptr<SimPin>> pins_;
+  std::vector<std::pair<Component *, bool>> components_;  // with 'paused'
+};
+
+}  // namespace sim
+}  // namespace hdmi_cec
+}  // namespace esphome
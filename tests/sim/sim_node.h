@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "hdmi_cec.h"
+#include "sim_bus.h"
+
+namespace esphome {
+namespace hdmi_cec {
+namespace sim {
+
+struct ReceivedFrame {
+  uint64_t time_us;
+  Frame frame;
+};
+
+/**
+ * A device on the simulated bus: an HDMICEC instance on a pin of its own, with an on_message trigger that
+ * takes every message (so the built-in handlers stay quiet) and records it.
+ */
+class Node {
+ public:
+  Node(Bus &bus, uint8_t address) : trigger_(&cec) {
+    cec.set_pin(bus.add_pin());
+    cec.set_address(address);
+    cec.set_physical_address(0x1000 * (address + 1));
+    cec.set_promiscuous_mode(false);
+    cec.set_monitor_mode(false);
+    trigger_.add_listener([this](const uint8_t &source, const uint8_t &destination, const Payload &data) {
+      received.push_back({Scheduler::get().now(), Frame(source, destination, data)});
+    });
+    bus.add_component(&cec);
+  }
+
+  HDMICEC cec;
+  std::vector<ReceivedFrame> received;
+
+ protected:
+  MessageTrigger trigger_;
+};
+
+}  // namespace sim
+}  // namespace hdmi_cec
+}  // namespace esphome
@@ -0,0 +1,38 @@
+#pragma once
+
+// Minimal test harness: a test program registers its cases with TEST_CASE, and runs the case named on its
+// command line (ctest runs every case as a test of its own, see CMakeLists.txt), or all of them.
+
+#include <cstdio>
+
+namespace test {
+
+using case_t = void (*)();
+
+struct Registrar {
+  Registrar(const char *name, case_t run);
+};
+
+void fail(const char *file, int line, const char *expression);
+void fail_values(const char *file, int line, const char *expression, long long actual, long long expected);
+
+}  // namespace test
+
+#define TEST_CASE(name) \
+  static void test_##name(); \
+  static const ::test::Registrar test_registrar_##name(#name, test_##name); \
+  static void test_##name()
+
+#define CHECK(condition) \
+  do { \
+    if (!(condition)) \
+      ::test::fail(__FILE__, __LINE__, #condition); \
+  } while (0)
+
+#define CHECK_EQ(actual, expected) \
+  do { \
+    const long long check_actual_ = (long long) (actual); \
+    const long long check_expected_ = (long long) (expected); \
+    if (check_actual_ != check_expected_) \
+      ::test::fail_values(__FILE__, __LINE__, #actual " == " #expected, check_actual_, check_expected_); \
+  } while (0)
@@ -0,0 +1,539 @@
+// Several HDMICEC instances on one simulated wire: acknowledge, arbitration and retransmission behavior,
+// checked on the frames delivered and on the wire itself.
+
+#include "alloc_count.h"
+#include "sim_node.h"
+#include "test.h"
+
+using namespace esphome::hdmi_cec;
+using namespace esphome::hdmi_cec::sim;
+
+static constexpr uint64_t SETUP_US = 20000;
+static constexpr uint64_t TIMEOUT_US = 3000000;
+
+struct SendOutcome {
+  bool done = false;
+  SendResult result = SendResult::Success;
+  uint64_t time_us = 0;
+  SendCallback callback() {
+    return [this](SendResult send_result) {
+      done = true;
+      result = send_result;
+      time_us = Scheduler::get().now();
+    };
+  }
+};
+
+TEST_CASE(ack) {
+  Bus bus;
+  Node a(bus, 0x4);
+  Node b(bus, 0x0);
+  bus.run_for(SETUP_US);
+
+  const Frame frame = message::give_device_power_status(0x4, 0x0);
+  SendOutcome outcome;
+  CHECK(a.cec.send(frame, outcome.callback()));
+  CHECK(bus.run_until([&]() { return outcome.done; }, TIMEOUT_US));
+  CHECK(outcome.result == SendResult::Success);
+  CHECK_EQ(b.received.size(), 1);
+  CHECK(!b.received.empty() && b.received[0].frame == frame);
+  CHECK_EQ(a.cec.tx_stats().frames_sent, 1);
+  CHECK_EQ(b.cec.rx_stats().acks_driven, 2);
+  // one attempt
+  CHECK_EQ(bus.wire().frames().size(), 1);
+}
+
+TEST_CASE(nack) {
+  Bus bus;
+  Node a(bus, 0x4);
+  Node b(bus, 0x0);
+  bus.run_for(SETUP_US);
+
+  // nobody has address 0x8
+  SendOutcome outcome;
+  CHECK(a.cec.send(message::standby(0x4, 0x8), outcome.callback()));
+  CHECK(bus.run_until([&]() { return outcome.done; }, TIMEOUT_US));
+  CHECK(outcome.result == SendResult::NoAck);
+  CHECK_EQ(a.cec.tx_stats().frames_failed, 1);
+  CHECK(b.received.empty());
+
+  // every attempt stops after the unacknowledged header block, and the retries keep 3 bit periods apart
+  const auto frames = bus.wire().frames();
+  CHECK_EQ(frames.size(), Transmitter::MAX_ATTEMPTS);
+  for (size_t i = 0; i < frames.size(); i++) {
+    CHECK_EQ(frames[i].bits, 10);
+    if (i > 0) {
+      CHECK(frames[i].start_us - frames[i - 1].last_bit_us >= 4 * TOTAL_BIT_US);
+    }
+  }
+}
+
+TEST_CASE(broadcast) {
+  Bus bus;
+  Node a(bus, 0x4);
+  Node b(bus, 0x0);
+  Node c(bus, 0x5);
+  bus.run_for(SETUP_US);
+
+  const Frame frame = message::active_source(0x4, 0x1000);
+  SendOutcome outcome;
+  CHECK(a.cec.send(frame, outcome.callback()));
+  CHECK(bus.run_until([&]() { return outcome.done; }, TIMEOUT_US));
+  CHECK(outcome.result == SendResult::Success);
+  CHECK_EQ(b.received.size(), 1);
+  CHECK_EQ(c.received.size(), 1);
+  CHECK(!c.received.empty() && c.received[0].frame == frame);
+  // nobody acknowledges a broadcast
+  CHECK_EQ(b.cec.rx_stats().acks_driven + c.cec.rx_stats().acks_driven, 0);
+}
+
+TEST_CASE(arbitration) {
+  Bus bus;
+  Node a(bus, 0x4);
+  Node b(bus, 0x1);
+  Node c(bus, 0x0);
+  bus.run_for(SETUP_US);
+
+  // both start their start bit at the same time; the lower initiator address wins (0x1: 0001 < 0x4: 0100)
+  const Frame from_a = message::give_osd_name(0x4, 0x0);
+  const Frame from_b = message::give_physical_address(0x1, 0x0);
+  SendOutcome outcome_a, outcome_b;
+  CHECK(a.cec.send(from_a, outcome_a.callback()));
+  CHECK(b.cec.send(from_b, outcome_b.callback()));
+  CHECK(bus.run_until([&]() { return outcome_a.done && outcome_b.done; }, TIMEOUT_US));
+  CHECK(outcome_a.result == SendResult::Success);
+  CHECK(outcome_b.result == SendResult::Success);
+  CHECK(outcome_b.time_us < outcome_a.time_us);
+  CHECK_EQ(a.cec.tx_stats().arbitration_lost, 1);
+  CHECK_EQ(b.cec.tx_stats().arbitration_lost, 0);
+
+  // the frame of the loser is not received in part, and the winner's frame is intact
+  CHECK_EQ(c.received.size(), 2);
+  if (c.received.size() == 2) {
+    CHECK(c.received[0].frame == from_b);
+    CHECK(c.received[1].frame == from_a);
+  }
+  CHECK_EQ(c.cec.rx_stats().resyncs, 0);
+}
+
+TEST_CASE(retransmission) {
+  Bus bus;
+  Node a(bus, 0x4);
+  Node b(bus, 0x0);
+  bus.run_for(SETUP_US);
+
+  // b doesn't run its loop meanwhile: once its receive queue is full, it stops acknowledging ('Nak' policy)
+  bus.pause_loop(&b.cec, true);
+  constexpr size_t COUNT = 6;
+  SendOutcome outcomes[COUNT];
+  for (size_t i = 0; i < COUNT; i++) {
+    CHECK(a.cec.send(message::user_control_pressed(0x4, 0x0, (uint8_t) i), outcomes[i].callback()));
+  }
+  CHECK(bus.run_until([&]() { return b.cec.rx_stats().frames_received == 4; }, TIMEOUT_US));
+  // the next frame is refused at least once, then b empties its queue
+  bus.run_for(80000);
+  bus.pause_loop(&b.cec, false);
+  CHECK(bus.run_until([&]() { return outcomes[COUNT - 1].done; }, TIMEOUT_US));
+
+  for (const auto &outcome : outcomes) {
+    CHECK(outcome.result == SendResult::Success);
+  }
+  CHECK_EQ(b.received.size(), COUNT);
+  for (size_t i = 0; i < b.received.size(); i++) {
+    CHECK_EQ(b.received[i].frame.payload().at(1), i);
+  }
+  CHECK(bus.wire().frames().size() > COUNT);
+  CHECK_EQ(b.cec.rx_stats().frames_dropped, 0);
+}
+
+TEST_CASE(signal_free_time) {
+  Bus bus;
+  Node a(bus, 0x4);
+  Node b(bus, 0x0);
+  bus.run_for(SETUP_US);
+
+  // two frames of the same initiator, then a frame of another one
+  SendOutcome first, second, reply;
+  CHECK(a.cec.send(message::standby(0x4, 0x0), first.callback()));
+  CHECK(a.cec.send(message::give_osd_name(0x4, 0x0), second.callback()));
+  CHECK(bus.run_until([&]() { return second.done; }, TIMEOUT_US));
+  CHECK(b.cec.send(message::standby(0x0, 0x4), reply.callback()));
+  CHECK(bus.run_until([&]() { return reply.done; }, TIMEOUT_US));
+
+  const auto frames = bus.wire().frames();
+  CHECK_EQ(frames.size(), 3);
+  if (frames.size() == 3) {
+    // counted from the start of the last bit of the previous frame
+    const uint64_t same_gap_us = frames[1].start_us - frames[0].last_bit_us;
+    const uint64_t new_gap_us = frames[2].start_us - frames[1].last_bit_us;
+    CHECK(same_gap_us >= 7 * TOTAL_BIT_US);
+    CHECK(new_gap_us >= 5 * TOTAL_BIT_US);
+    // and not much more: a frame waiting to go out doesn't idle the bus
+    CHECK(same_gap_us <= 8 * TOTAL_BIT_US + 1000);
+  }
+}
+
+TEST_CASE(sequence) {
+  Bus bus;
+  Node a(bus, 0x4);
+  Node b(bus, 0x0);
+  bus.run_for(SETUP_US);
+
+  const Frame frames[] = {message::image_view_on(0x4, 0x0), message::active_source(0x4, 0x1000)};
+  bool done = false;
+  SendResult result = SendResult::Timeout;
+  size_t index = 99;
+  CHECK(a.cec.send_sequence(frames, 2, [&](SendResult send_result, size_t frame_index) {
+    done = true;
+    result = send_result;
+    index = frame_index;
+  }));
+  CHECK(bus.run_until([&]() { return done; }, TIMEOUT_US));
+  CHECK(result == SendResult::Success);
+  CHECK_EQ(index, 1);
+  CHECK_EQ(b.received.size(), 2);
+  if (b.received.size() == 2) {
+    CHECK(b.received[0].frame == frames[0]);
+    CHECK(b.received[1].frame == frames[1]);
+  }
+
+  // a failing frame ends the sequence, and is the one reported
+  const Frame failing[] = {message::image_view_on(0x4, 0x8), message::active_source(0x4, 0x1000)};
+  done = false;
+  CHECK(a.cec.send_sequence(failing, 2, [&](SendResult send_result, size_t frame_index) {
+    done = true;
+    result = send_result;
+    index = frame_index;
+  }));
+  CHECK(bus.run_until([&]() { return done; }, TIMEOUT_US));
+  CHECK(result == SendResult::NoAck);
+  CHECK_EQ(index, 0);
+  CHECK_EQ(b.received.size(), 2);
+}
+
+// every low pulse on the wire keeps to the bit timing, the acknowledge bits too, with slow and uneven interrupt and
+// timer delays: the follower drives the ACK from its GPIO interrupt and releases it from its timer, 1.5 ms after the
+// interrupt, so the ACK stays within its +/-0.2 ms as long as both delays add up to less than that
+TEST_CASE(ack_window) {
+  const Timing timings[] = {
+      {5, 2, 0, 2, 0},
+      {5, 10, 30, 10, 50},
+      {5, 20, 60, 20, 80},
+  };
+  const Timing saved = timing();
+  for (const Timing &delays : timings) {
+    timing() = delays;
+    set_seed(1);
+    Bus bus;
+    Node a(bus, 0x4);
+    Node b(bus, 0x0);
+    bus.run_for(SETUP_US);
+
+    // '0' and '1' data bits, and three acknowledged blocks
+    const Frame frame = message::user_control_pressed(0x4, 0x0, 0xA5);
+    SendOutcome outcome;
+    CHECK(a.cec.send(frame, outcome.callback()));
+    CHECK(bus.run_until([&]() { return outcome.done; }, TIMEOUT_US));
+    CHECK(outcome.result == SendResult::Success);
+    CHECK_EQ(b.cec.rx_stats().acks_driven, 3);
+
+    const auto pulses = bus.wire().low_pulses();
+    CHECK_EQ(pulses.size(), 1 + 10 * frame.size());
+    for (size_t i = 0; i < pulses.size(); i++) {
+      const uint64_t duration_us = pulses[i].duration_us;
+      if (i == 0) {
+        CHECK(duration_us >= 3500 && duration_us <= 3900);
+        continue;
+      }
+      if (i % 10 == 0) {
+        // acknowledge bit: a '0', the follower holds the line low past the initiator's '1'
+        CHECK(duration_us >= 1300 && duration_us <= 1700);
+      } else {
+        CHECK((duration_us >= 400 && duration_us <= 800) || (duration_us >= 1300 && duration_us <= 1700));
+      }
+      const uint64_t period_us = pulses[i].start_us - pulses[i - 1].start_us;
+      if (i == 1) {
+        CHECK(period_us >= 4300 && period_us <= 4700);
+      } else {
+        CHECK(period_us >= 2050 && period_us <= 2750);
+      }
+    }
+  }
+  timing() = saved;
+}
+
+class RecordingSink : public CaptureSink {
+ public:
+  void write(const uint8_t *data, size_t length) override { bytes.insert(bytes.end(), data, data + length); }
+  const char *name() const override { return "test"; }
+  std::vector<uint8_t> bytes;
+};
+
+// the capture is set up per bus: a bus without a sink records nothing, and its loop goes idle
+TEST_CASE(capture_per_bus) {
+  Bus bus;
+  Node a(bus, 0x4);
+  Node b(bus, 0x0);
+  RecordingSink sink;
+  a.cec.set_capture(&sink, 8);
+  bus.run_for(SETUP_US);
+
+  SendOutcome outcome;
+  CHECK(a.cec.send(message::standby(0x4, 0x0), outcome.callback()));
+  CHECK(bus.run_until([&]() { return outcome.done; }, TIMEOUT_US));
+  bus.run_for(10000);
+
+  // the frame sent by a: one record, with its two bytes
+  CHECK_EQ(sink.bytes.size(), capture::HEADER_SIZE + 2);
+  CHECK(!sink.bytes.empty() && sink.bytes[0] == capture::SYNC);
+  CHECK_EQ(b.received.size(), 1);
+  CHECK(!a.cec.is_loop_enabled());
+  CHECK(!b.cec.is_loop_enabled());
+}
+
+// One Touch Play as a sequence, and as two send() calls with the second one made from the callback of the first,
+// with a main loop that runs every 100 ms (busy with other components): the sequence starts its second frame right
+// after the signal free time of the same initiator (7 bit periods, the spec minimum), the separate calls only once
+// the loop reported the first frame. With a loop faster than the signal free time, both take the same time.
+TEST_CASE(sequence_timing) {
+  const Frame frames[] = {message::image_view_on(0x4, 0x0), message::active_source(0x4, 0x1000)};
+  uint64_t gaps_us[2] = {0, 0};
+  uint64_t durations_us[2] = {0, 0};
+  for (int separate = 0; separate < 2; separate++) {
+    Bus bus(100000);
+    Node a(bus, 0x4);
+    Node b(bus, 0x0);
+    bus.run_for(SETUP_US + 100000);
+
+    const uint64_t start_us = Scheduler::get().now();
+    if (separate) {
+      CHECK(a.cec.send(frames[0], [&](SendResult) { a.cec.send(frames[1]); }));
+    } else {
+      CHECK(a.cec.send_sequence(frames, 2));
+    }
+    CHECK(bus.run_until([&]() { return b.received.size() == 2; }, TIMEOUT_US));
+    const auto wire_frames = bus.wire().frames();
+    CHECK_EQ(wire_frames.size(), 2);
+    if (wire_frames.size() == 2) {
+      gaps_us[separate] = wire_frames[1].start_us - wire_frames[0].last_bit_us;
+      durations_us[separate] = wire_frames[1].last_bit_us + TOTAL_BIT_US - start_us;
+    }
+  }
+  printf("sequence: gap %.1f ms, %.1f ms in all; separate sends: gap %.1f ms, %.1f ms in all\n", gaps_us[0] / 1e3,
+         durations_us[0] / 1e3, gaps_us[1] / 1e3, durations_us[1] / 1e3);
+  // counted from the start of the last bit of the previous frame
+  CHECK(gaps_us[0] >= 8 * TOTAL_BIT_US && gaps_us[0] <= 8 * TOTAL_BIT_US + 1000);
+  CHECK(durations_us[0] < durations_us[1]);
+}
+
+// a query only takes the reply from the queried device to us: not the same reply to another device (seen in
+// promiscuous mode), nor a "Feature Abort" without its reason
+TEST_CASE(query_reply) {
+  Bus bus;
+  Node a(bus, 0x4);
+  Node b(bus, 0x0);
+  Node c(bus, 0x5);
+  a.cec.set_promiscuous_mode(true);
+  bus.run_for(SETUP_US);
+
+  bool done = false;
+  QueryResult result = QueryResult::Timeout;
+  Payload reply;
+  // "Give Device Power Status" -> "Report Power Status"
+  CHECK(a.cec.query(0x0, {0x8F}, 0x90, 2000, [&](QueryResult query_result, const Payload &data) {
+    done = true;
+    result = query_result;
+    reply = data;
+  }));
+  auto send_from_b = [&](uint8_t destination, const Payload &data) {
+    SendOutcome outcome;
+    CHECK(b.cec.send(Frame(0x0, destination, data), outcome.callback()));
+    CHECK(bus.run_until([&]() { return outcome.done; }, TIMEOUT_US));
+    bus.run_for(5000);
+  };
+  send_from_b(0x5, Payload{0x90, 0x01});
+  send_from_b(0x4, Payload{0x00, 0x8F});
+  CHECK(!done);
+  send_from_b(0x4, Payload{0x90, 0x00});
+  CHECK(done);
+  CHECK(result == QueryResult::Reply);
+  CHECK(reply == (Payload{0x90, 0x00}));
+
+  // a complete "Feature Abort" settles the query
+  done = false;
+  CHECK(a.cec.query(0x0, {0x46}, 0x47, 2000, [&](QueryResult query_result, const Payload &data) {
+    done = true;
+    result = query_result;
+    reply = data;
+  }));
+  send_from_b(0x4, Payload{0x00, 0x46, 0x00});
+  CHECK(done);
+  CHECK(result == QueryResult::FeatureAbort);
+}
+
+// the actions after hdmi_cec.query wait for its reply, and read it from the component
+TEST_CASE(query_action) {
+  Bus bus;
+  Node a(bus, 0x4);
+  Node b(bus, 0x0);
+  bus.run_for(SETUP_US);
+
+  QueryAction<int> query(&a.cec);
+  query.set_destination(0x0);
+  query.set_data(std::vector<uint8_t>{0x8F});
+  query.set_reply_opcode(0x90);
+  query.set_timeout(2000);
+  QueryResponseTrigger response;
+  Payload response_data;
+  response.add_listener([&](const Payload &data) { response_data = data; });
+  query.add_response_trigger(&response);
+  std::vector<int> runs;
+  QueryResult result = QueryResult::Timeout;
+  Payload reply;
+  esphome::LambdaAction<int> next([&](int x) {
+    runs.push_back(x);
+    result = a.cec.last_query_result();
+    reply = a.cec.last_query_reply();
+  });
+  esphome::ActionList<int> actions;
+  actions.add_action(&query);
+  actions.add_action(&next);
+
+  auto send_from_b = [&](uint8_t destination, const Payload &data) {
+    SendOutcome outcome;
+    CHECK(b.cec.send(Frame(0x0, destination, data), outcome.callback()));
+    CHECK(bus.run_until([&]() { return outcome.done; }, TIMEOUT_US));
+    bus.run_for(5000);
+  };
+  actions.play(7);
+  bus.run_for(100000);
+  CHECK(runs.empty());
+  CHECK(query.is_running());
+  send_from_b(0x4, Payload{0x90, 0x01});
+  CHECK_EQ(runs.size(), 1);
+  CHECK(!runs.empty() && runs[0] == 7);
+  CHECK(result == QueryResult::Reply);
+  CHECK(reply == (Payload{0x90, 0x01}));
+  CHECK(response_data == reply);
+  CHECK(!query.is_running());
+
+  // a stopped automation doesn't go on when the reply comes
+  actions.play(8);
+  actions.stop();
+  send_from_b(0x4, Payload{0x90, 0x00});
+  CHECK_EQ(runs.size(), 1);
+
+  // nothing to send: the next action runs right away
+  query.set_data(std::vector<uint8_t>{});
+  actions.play(9);
+  CHECK_EQ(runs.size(), 2);
+  CHECK(result == QueryResult::SendFailed);
+  CHECK(reply.empty());
+}
+
+TEST_CASE(lazy_decode) {
+  Bus bus;
+  Node a(bus, 0x4);
+  Node b(bus, 0x0);
+  Node c(bus, 0x5);
+  std::vector<DecodedMessage> messages;
+  DecodedMessageTrigger trigger(&a.cec);
+  trigger.set_opcode(0x90);
+  trigger.add_listener([&](const DecodedMessage &message) { messages.push_back(message); });
+  bus.run_for(SETUP_US);
+
+  auto send_from_b = [&](uint8_t destination, const Payload &data) {
+    SendOutcome outcome;
+    CHECK(b.cec.send(Frame(0x0, destination, data), outcome.callback()));
+    CHECK(bus.run_until([&]() { return outcome.done; }, TIMEOUT_US));
+    bus.run_for(5000);
+  };
+  // the cache learns from frames to other devices too, before they are filtered out
+  send_from_b(0x5, Payload{0x90, 0x01});
+  CHECK(a.cec.device_cache().device(0x0).power_status.known);
+  CHECK(a.cec.device_cache().device(0x0).power_status.value == 0x01);
+  CHECK(messages.empty());
+  // a frame the cache doesn't keep only marks its initiator as seen
+  send_from_b(0xF, Payload{0x36});
+  CHECK(a.cec.device_cache().device(0x0).seen.known);
+  // the decoded trigger gets the operands
+  send_from_b(0x4, Payload{0x90, 0x00});
+  CHECK(messages.size() == 1);
+  CHECK(messages[0].power_status().value_or(0xFF) == 0x00);
+  CHECK(a.cec.device_cache().device(0x0).power_status.value == 0x00);
+}
+
+TEST_CASE(no_allocation) {
+  Bus bus;
+  Node a(bus, 0x4);
+  Node b(bus, 0x0);
+  bus.wire().set_recording(false);
+  a.received.reserve(1000);
+  b.received.reserve(1000);
+  bus.run_for(SETUP_US);
+
+  // sends in both directions, and a broadcast: each one is received and dispatched to the on_message trigger
+  auto exchange = [&](size_t rounds) {
+    for (size_t i = 0; i < rounds; i++) {
+      SendOutcome to_b, to_a, to_all;
+      CHECK(a.cec.send(Frame(0x4, 0x0, Payload{0x90, (uint8_t) (i & 1)}), to_b.callback()));
+      CHECK(bus.run_until([&]() { return to_b.done; }, TIMEOUT_US));
+      CHECK(b.cec.send(Frame(0x0, 0x4, Payload{0x47, 'T', 'V'}), to_a.callback()));
+      CHECK(bus.run_until([&]() { return to_a.done; }, TIMEOUT_US));
+      CHECK(a.cec.send(Frame(0x4, 0xF, Payload{0x82, 0x50, 0x00}), to_all.callback()));
+      CHECK(bus.run_until([&]() { return to_all.done; }, TIMEOUT_US));
+      CHECK(to_b.result == SendResult::Success && to_a.result == SendResult::Success);
+      bus.run_for(5000);
+    }
+  };
+  // the first frames set up what lives as long as the component, e.g. the buffers of the log
+  exchange(2);
+  const size_t received = a.received.size() + b.received.size();
+  const size_t before = alloc_count::allocations();
+  exchange(20);
+  CHECK_EQ(alloc_count::allocations() - before, 0);
+  CHECK_EQ(a.received.size() + b.received.size() - received, 60);
+}
+
+TEST_CASE(edge_trace_replay) {
+  timing() = Timing{5, 5, 20, 5, 20};
+  Bus bus;
+  Node a(bus, 0x4);
+  Node b(bus, 0x0);
+  Node listener(bus, 0x5);
+  listener.cec.set_promiscuous_mode(true);
+  listener.cec.set_edge_trace_size(10000);
+  bus.run_for(SETUP_US);
+
+  // a and b arbitrate, and 0x8 doesn't acknowledge: its frames are retransmitted
+  const uint8_t destinations[] = {0x0, 0xF, 0x8, 0x5};
+  for (uint8_t i = 0; i < 8; i++) {
+    SendOutcome from_a, from_b;
+    CHECK(a.cec.send(Frame(0x4, destinations[i % 4], Payload{0x89, i, 0x55}), from_a.callback()));
+    CHECK(b.cec.send(Frame(0x0, 0x4, Payload{0x90, i}), from_b.callback()));
+    CHECK(bus.run_until([&]() { return from_a.done && from_b.done; }, TIMEOUT_US));
+    bus.run_for(5000);
+  }
+  // all but the two frames to 0x8, which nobody acknowledged
+  CHECK_EQ(listener.received.size(), 14);
+
+  EdgeTrace &trace = listener.cec.edge_trace();
+  std::vector<uint8_t> data(trace.serialized_size());
+  trace.set_paused(true);
+  CHECK_EQ(trace.serialize(0, data.data(), data.size()), data.size());
+  trace.set_paused(false);
+
+  Receiver receiver;
+  std::vector<Frame> replayed;
+  const int edges = replay_edge_trace(data.data(), data.size(), receiver, [&](Receiver::Event event) {
+    if (event == Receiver::Event::FrameComplete && receiver.frame().size() > 1) {
+      replayed.push_back(receiver.frame());
+    }
+  });
+  CHECK_EQ(edges, trace.count());
+  CHECK_EQ(replayed.size(), listener.received.size());
+  for (size_t i = 0; i < replayed.size() && i < listener.received.size(); i++) {
+    CHECK(replayed[i] == listener.received[i].frame);
+  }
+  timing() = Timing();
+}
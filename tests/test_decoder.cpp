@@ -0,0 +1,69 @@
+// The decoder on its corpus (exact texts) and on generated frames (bounds and consistency)
+
+#include <cstring>
+
+#include "alloc_count.h"
+#include "cec_decoder.h"
+#include "corpus.h"
+#include "test.h"
+
+using namespace esphome::hdmi_cec;
+
+static const char *decoded_text(const char *formatted) {
+  const char *arrow = strstr(formatted, " => ");
+  return (arrow != nullptr) ? arrow + 4 : formatted;
+}
+
+TEST_CASE(corpus) {
+  const auto corpus = load_corpus();
+  CHECK(corpus.size() >= 100);
+  for (const auto &entry : corpus) {
+    char text[Frame::MAX_TEXT_LENGTH];
+    entry.frame.format(text, sizeof(text));
+    if (entry.text != decoded_text(text)) {
+      printf("%s\n  expected: %s\n", text, entry.text.c_str());
+      CHECK(entry.text == decoded_text(text));
+    }
+  }
+}
+
+TEST_CASE(generated) {
+  for (const auto &frame : generated_frames()) {
+    const DecodedMessage message(frame);
+    CHECK(message.frame == frame);
+    CHECK(message.num_operands <= DecodedMessage::MAX_OPERANDS);
+    for (size_t i = 0; i < message.num_operands; i++) {
+      const DecodedOperand &operand = message.operands[i];
+      CHECK(operand.offset + operand.size <= frame.size());
+    }
+
+    // the text fits, even in a short buffer, and is the same from a message decoded already
+    char text[Frame::MAX_TEXT_LENGTH];
+    const size_t length = Decoder(frame).decode(text, sizeof(text));
+    CHECK(length < sizeof(text));
+    CHECK_EQ(strlen(text), length);
+    char again[Frame::MAX_TEXT_LENGTH];
+    message.format(again, sizeof(again));
+    CHECK(strcmp(text, again) == 0);
+    char short_text[16];
+    memset(short_text, 'x', sizeof(short_text));
+    const size_t short_length = Decoder(frame).decode(short_text, sizeof(short_text));
+    CHECK(short_length < sizeof(short_text));
+    CHECK(memchr(short_text, '\0', sizeof(short_text)) != nullptr);
+  }
+}
+
+TEST_CASE(no_allocation) {
+  auto frames = generated_frames();
+  for (const auto &entry : load_corpus()) {
+    frames.push_back(entry.frame);
+  }
+  const size_t before = alloc_count::allocations();
+  for (const auto &frame : frames) {
+    const DecodedMessage message(frame);
+    char text[Frame::MAX_TEXT_LENGTH];
+    message.format(text, sizeof(text));
+    frame.format(text, sizeof(text));
+  }
+  CHECK_EQ(alloc_count::allocations() - before, 0);
+}
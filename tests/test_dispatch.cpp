@@ -0,0 +1,100 @@
+// The on_message dispatch through the opcode tables: same triggers, in the same order, as checking them all
+
+#include <memory>
+#include <random>
+
+#include "dispatch.h"
+#include "test.h"
+
+using namespace esphome::hdmi_cec;
+
+struct Triggers {
+  explicit Triggers(DispatchingHDMICEC &cec) : cec_(cec) {}
+
+  // a trigger for 'opcode' (-1: any) that records its position when it runs
+  MessageTrigger *add(int opcode) {
+    auto trigger = std::make_unique<MessageTrigger>(&cec_);
+    if (opcode >= 0) {
+      trigger->set_opcode((uint8_t) opcode);
+    }
+    const size_t position = triggers_.size();
+    trigger->add_listener([this, position](const uint8_t &, const uint8_t &, const Payload &) {
+      fired.push_back(position);
+    });
+    opcodes.push_back(opcode);
+    triggers_.push_back(std::move(trigger));
+    return triggers_.back().get();
+  }
+
+  std::vector<int> opcodes;
+  std::vector<size_t> fired;
+
+ protected:
+  DispatchingHDMICEC &cec_;
+  std::vector<std::unique_ptr<MessageTrigger>> triggers_;
+};
+
+TEST_CASE(declaration_order) {
+  DispatchingHDMICEC cec;
+  Triggers triggers(cec);
+  triggers.add(-1);
+  triggers.add(0x44);
+  triggers.add(-1);
+  triggers.add(0x44);
+  triggers.add(0x45);
+  const DispatchTables tables = build_dispatch_tables(triggers.opcodes);
+  cec.set_tables(tables);
+
+  CHECK(cec.dispatch_message_(0x4, 0x0, Payload{0x44, 0x41}, true));
+  CHECK_EQ(triggers.fired.size(), 4);
+  for (size_t i = 0; i < triggers.fired.size(); i++) {
+    CHECK_EQ(triggers.fired[i], i);
+  }
+  triggers.fired.clear();
+  CHECK(cec.dispatch_message_(0x4, 0x0, Payload{0x45}, true));
+  CHECK(triggers.fired == (std::vector<size_t>{0, 2, 4}));
+}
+
+// triggers added from C++ after the tables are not in them, and still run, after the others
+TEST_CASE(added_triggers) {
+  DispatchingHDMICEC cec;
+  Triggers triggers(cec);
+  triggers.add(0x44);
+  triggers.add(-1);
+  const DispatchTables tables = build_dispatch_tables(triggers.opcodes);
+  cec.set_tables(tables);
+  triggers.add(0x44);
+  triggers.add(-1);
+  triggers.add(0x90);
+
+  CHECK(cec.dispatch_message_(0x4, 0x0, Payload{0x44}, true));
+  CHECK(triggers.fired == (std::vector<size_t>{0, 1, 2, 3}));
+  triggers.fired.clear();
+  CHECK(cec.dispatch_message_(0x4, 0x0, Payload{0x90, 0x00}, true));
+  CHECK(triggers.fired == (std::vector<size_t>{1, 3, 4}));
+}
+
+TEST_CASE(same_as_linear) {
+  std::mt19937 random(1);
+  DispatchingHDMICEC with_tables, without_tables;
+  Triggers triggers(with_tables), linear(without_tables);
+  for (size_t i = 0; i < 64; i++) {
+    const int opcode = (random() % 4 == 0) ? -1 : (int) (random() % 8) + 0x40;
+    const uint8_t source = random() % 4;
+    triggers.add(opcode)->set_source(source);
+    linear.add(opcode)->set_source(source);
+  }
+  const DispatchTables tables = build_dispatch_tables(triggers.opcodes);
+  with_tables.set_tables(tables);
+
+  for (uint8_t source = 0; source < 4; source++) {
+    for (int opcode = 0x3E; opcode < 0x4A; opcode++) {
+      triggers.fired.clear();
+      linear.fired.clear();
+      const Payload data{(uint8_t) opcode};
+      CHECK_EQ(with_tables.dispatch_message_(source, 0x0, data, true),
+               without_tables.dispatch_message_(source, 0x0, data, true));
+      CHECK(triggers.fired == linear.fired);
+    }
+  }
+}
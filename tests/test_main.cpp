@@ -0,0 +1,53 @@
+#include "test.h"
+
+#include <cstring>
+#include <vector>
+
+namespace test {
+
+struct Case {
+  const char *name;
+  case_t run;
+};
+
+static std::vector<Case> &cases() {
+  static std::vector<Case> cases;
+  return cases;
+}
+
+static int failures = 0;
+
+Registrar::Registrar(const char *name, case_t run) { cases().push_back({name, run}); }
+
+void fail(const char *file, int line, const char *expression) {
+  printf("%s:%d: check failed: %s\n", file, line, expression);
+  failures++;
+}
+
+void fail_values(const char *file, int line, const char *expression, long long actual, long long expected) {
+  printf("%s:%d: check failed: %s (%lld, expected %lld)\n", file, line, expression, actual, expected);
+  failures++;
+}
+
+}  // namespace test
+
+int main(int argc, char **argv) {
+  bool found = false;
+  for (const auto &test_case : test::cases()) {
+    if (argc > 1 && strcmp(argv[1], test_case.name) != 0) {
+      continue;
+    }
+    found = true;
+    printf("--- %s\n", test_case.name);
+    test_case.run();
+  }
+  if (!found) {
+    printf("no test case '%s'\n", argv[1]);
+    return 2;
+  }
+  if (test::failures > 0) {
+    printf("%d checks failed\n", test::failures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,120 @@
+// send() from several threads at once, with the protocol on the CEC task (std::thread backend): every accepted
+// frame gets its callback exactly once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "esphome/core/log.h"
+#include "hdmi_cec.h"
+#include "host_hal.h"
+#include "test.h"
+
+using namespace esphome;
+using namespace esphome::hdmi_cec;
+
+// A node alone on its line: it reads back what it drives
+class LoopbackPin : public InternalGPIOPin {
+ public:
+  void setup() override {}
+  void pin_mode(gpio::Flags flags) override {
+    output_ = (flags & gpio::FLAG_OUTPUT) != 0;
+    low_ = output_ && !value_;
+  }
+  bool digital_read() override { return !low_; }
+  void digital_write(bool value) override {
+    value_ = value;
+    low_ = output_ && !value;
+  }
+  uint8_t get_pin() const override { return 0; }
+  void detach_interrupt() const override {}
+  ISRInternalGPIOPin to_isr() const override { return ISRInternalGPIOPin(const_cast<LoopbackPin *>(this)); }
+
+ protected:
+  void attach_interrupt(void (*func)(void *), void *arg, gpio::InterruptType type) const override {}
+
+  std::atomic<bool> output_{false};
+  std::atomic<bool> value_{true};
+  std::atomic<bool> low_{false};
+};
+
+TEST_CASE(concurrent_send) {
+  constexpr size_t ROUNDS = 50;
+  constexpr size_t THREADS = 4;
+  // as many frames as the queues hold, so the CEC task doesn't refuse any
+  constexpr size_t FRAMES_PER_THREAD = 4;
+  constexpr uint32_t MAX_DELAY_MS = 1000;
+
+  // the frames that don't fit in the queues are refused, with a warning
+  host::set_log_level(ESPHOME_LOG_LEVEL_ERROR);
+  // the CEC task keeps running until the end of the program: so do the bus and its pin
+  auto *pin = new LoopbackPin();
+  auto *cec = new HDMICEC();
+  cec->set_pin(pin);
+  cec->set_address(0x4);
+  cec->set_physical_address(0x1000);
+  cec->set_promiscuous_mode(false);
+  cec->set_monitor_mode(false);
+  cec->call();
+
+  std::mutex mutex;
+  std::vector<int> callbacks(THREADS * FRAMES_PER_THREAD);
+  for (size_t round = 0; round < ROUNDS; round++) {
+    // the virtual clock stands still while the threads send: the first frame waits for its first bit, the others
+    // wait in the queues
+    std::fill(callbacks.begin(), callbacks.end(), 0);
+    std::atomic<size_t> accepted{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < THREADS; t++) {
+      threads.emplace_back([&, t]() {
+        while (!go) {
+        }
+        for (size_t i = 0; i < FRAMES_PER_THREAD; i++) {
+          const size_t id = t * FRAMES_PER_THREAD + i;
+          // distinct frames, so none is merged with another
+          const Frame frame(0x4, 0xF, Payload{0x89, (uint8_t) round, (uint8_t) id});
+          if (cec->send(frame, [&, id](SendResult) {
+                std::lock_guard<std::mutex> lock(mutex);
+                callbacks[id]++;
+              }, TxPriority::Normal, MAX_DELAY_MS)) {
+            accepted++;
+          }
+        }
+      });
+    }
+    go = true;
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    CHECK(accepted > 0);
+
+    // let the time run: the first frame goes out, the deadline of the others passes
+    const auto start = std::chrono::steady_clock::now();
+    size_t reported = 0;
+    while (std::chrono::steady_clock::now() - start < std::chrono::seconds(5)) {
+      host::advance_time_us(2 * MAX_DELAY_MS * 1000);
+      ProtocolTask::get()->notify();
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+      cec->call();
+      std::lock_guard<std::mutex> lock(mutex);
+      reported = 0;
+      for (int count : callbacks) {
+        reported += count;
+      }
+      if (reported >= accepted) {
+        break;
+      }
+    }
+    // a result that comes late would count for the next round
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    cec->call();
+    std::lock_guard<std::mutex> lock(mutex);
+    CHECK_EQ(reported, accepted.load());
+    for (int count : callbacks) {
+      CHECK(count <= 1);
+    }
+  }
+}
@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+"""
+Print the frames of an HDMI-CEC capture (see 'capture:' in the README) as text, one line per frame.
+
+Usage: cec_capture.py <capture file or log file>
+
+The input is either the raw record stream written by the uart and tcp sinks, or a log holding the
+"capture: <hex>" lines of the logger sink. Output columns: time since the first frame in seconds,
+time since the previous frame in milliseconds, direction, frame bytes, ACK bits (one per byte,
+0: line held low) and, for sent frames, the send result.
+"""
+import re
+import struct
+import sys
+
+SYNC = 0xCE
+FLAG_TX = 0x01
+HEADER = struct.Struct("<BBBBIH")
+SEND_RESULTS = ["Success", "BusCollision", "NoAck", "Timeout", "Expired", "Dropped"]
+LOG_LINE = re.compile(r"capture: ([0-9A-F]+)")
+
+
+def from_log(text):
+    """Concatenate the hex data of all 'capture:' log lines"""
+    return b"".join(bytes.fromhex(match.group(1)) for match in LOG_LINE.finditer(text))
+
+
+def records(data):
+    """Yield (time_us, flags, result, ack_bits, frame) for each record, skipping damaged ones"""
+    position = 0
+    while position + HEADER.size <= len(data):
+        sync, flags, result, length, time_us, ack_bits = HEADER.unpack_from(data, position)
+        end = position + HEADER.size + length
+        if sync != SYNC or not 1 <= length <= 16 or end > len(data):
+            # lost bytes: look for the next sync byte
+            position += 1
+            continue
+        yield time_us, flags, result, ack_bits, data[position + HEADER.size:end]
+        position = end
+
+
+def format_record(elapsed_us, delta_us, flags, result, ack_bits, frame):
+    direction = "TX" if flags & FLAG_TX else "RX"
+    text = ":".join(f"{byte:02X}" for byte in frame)
+    acks = "".join("0" if ack_bits & (1 << i) else "1" for i in range(len(frame)))
+    line = f"{elapsed_us / 1e6:12.6f} {delta_us / 1e3:+10.3f}  {direction}  {text:<47}  ack {acks:<16}"
+    if flags & FLAG_TX:
+        line += f"  {SEND_RESULTS[result] if result < len(SEND_RESULTS) else result}"
+    return line.rstrip()
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit(__doc__)
+    with open(sys.argv[1], "rb") as capture:
+        data = capture.read()
+    if data[:1] != bytes([SYNC]):
+        data = from_log(data.decode("utf-8", errors="replace"))
+    elapsed_us = 0
+    last_us = None
+    for time_us, flags, result, ack_bits, frame in records(data):
+        # the device clock is 32 bits of microseconds: it wraps about every 71 minutes
+        delta_us = 0 if last_us is None else (time_us - last_us) & 0xFFFFFFFF
+        elapsed_us += delta_us
+        last_us = time_us
+        print(format_record(elapsed_us, delta_us, flags, result, ack_bits, frame))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,48 @@
+#!/usr/bin/env python3
+"""
+Extract the binary edge trace written to the log by the 'hdmi_cec.dump_edge_trace' action.
+
+Usage: edge_trace_from_log.py <log file> <trace file>
+
+The trace can be replayed through the receiver with replay_edge_trace() (see cec_edge_trace.h).
+"""
+import re
+import sys
+
+LINE = re.compile(r"edge trace ([0-9A-F]{6}): ([0-9A-F]*)")
+
+
+def extract(lines):
+    """Return the bytes of the last complete dump in 'lines'"""
+    chunks = {}
+    for line in lines:
+        match = LINE.search(line)
+        if not match:
+            continue
+        offset = int(match.group(1), 16)
+        if offset == 0:
+            # a new dump starts
+            chunks = {}
+        chunks[offset] = bytes.fromhex(match.group(2))
+    data = b""
+    for offset in sorted(chunks):
+        if offset != len(data):
+            raise ValueError(f"missing log lines before offset {offset:06X}")
+        data += chunks[offset]
+    return data
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    with open(sys.argv[1], encoding="utf-8", errors="replace") as log:
+        data = extract(log)
+    if not data.startswith(b"CET1"):
+        sys.exit("no edge trace found")
+    with open(sys.argv[2], "wb") as trace:
+        trace.write(data)
+    print(f"{(len(data) - 8) // 4} edges written to {sys.argv[2]}")
+
+
+if __name__ == "__main__":
+    main()